@@ -0,0 +1,146 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "xcoro/awaitable.hpp"
+#include "xcoro/cancellation_source.hpp"
+#include "xcoro/cancellation_token.hpp"
+#include "xcoro/semaphore.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/wait_group.hpp"
+
+namespace xcoro {
+
+namespace detail {
+
+// async_scope 启动的子协程：立即开始执行，结束时自行销毁。
+// 子任务的异常已经在协程体内被捕获并交给 async_scope，这里不会再有异常
+struct scope_task {
+  struct promise_type {
+    scope_task get_return_object() noexcept { return {}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() noexcept {}
+    void unhandled_exception() noexcept { std::terminate(); }
+  };
+};
+
+}  // namespace detail
+
+// 结构化地启动后台协程：scope 记录所有还在运行的子任务，co_await scope.join() 等待它们全部结束，
+// 并重新抛出第一个子任务异常（之后的异常被丢弃）。
+// scope 持有一个取消源，request_stop() 之后 token() 进入取消状态，子任务自行决定如何响应。
+// 计数只是一次原子加减；销毁 scope 之前必须 join，保证没有子任务还在引用它。
+// 构造时给出 max_active 可以限制同时运行的子任务数：async_spawn 在达到上限时挂起，
+// 直到有子任务结束；spawn 不等待，也不占用名额
+class async_scope {
+ public:
+  async_scope() = default;
+
+  explicit async_scope(size_t max_active)
+      : limit_(max_active), slots_(static_cast<std::ptrdiff_t>(max_active)) {
+    if (max_active == 0) {
+      throw std::invalid_argument("async_scope max_active must be positive");
+    }
+  }
+  async_scope(const async_scope&) = delete;
+  async_scope& operator=(const async_scope&) = delete;
+
+  ~async_scope() { assert(active() == 0 && "async_scope destroyed with running tasks"); }
+
+  // 在当前线程立即开始执行 awaitable，直到它第一次挂起。需要在别的调度器上运行时，
+  // 让子任务先 co_await pool.schedule()
+  template <concepts::Awaitable Awaitable>
+  void spawn(Awaitable&& awaitable) {
+    start(std::forward<Awaitable>(awaitable), false);
+  }
+
+  // 有名额时立即 spawn；没有名额时先挂起等待某个子任务结束。
+  // 没有设置上限的 scope 上等价于 spawn。等待名额期间 token 被取消时抛出 operation_cancelled，
+  // awaitable 不会被启动
+  template <concepts::Awaitable Awaitable>
+  task<> async_spawn(Awaitable awaitable, cancellation_token token = {}) {
+    if (limit_ == 0) {
+      spawn(std::move(awaitable));
+      co_return;
+    }
+    co_await slots_.acquire(std::move(token));
+    start(std::move(awaitable), true);
+  }
+
+  // 构造时给出的上限，0 表示不限制
+  size_t max_active() const noexcept { return limit_; }
+
+  // 仍在运行的子任务数
+  size_t active() const noexcept { return static_cast<size_t>(children_.count()); }
+
+  cancellation_token token() const noexcept { return source_.token(); }
+
+  void request_stop() noexcept { source_.request_cancellation(); }
+
+  bool stop_requested() const noexcept { return source_.is_cancellation_requested(); }
+
+  // 等待所有子任务结束；有子任务抛出过异常时重新抛出第一个，并清除它
+  task<> join() {
+    co_await children_.wait();
+    // 子任务在 done() 之前写入 error_，等到计数归零之后读取是安全的
+    if (error_) {
+      claimed_error_.store(false, std::memory_order_relaxed);
+      std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+  }
+
+ private:
+  template <typename Awaitable>
+  void start(Awaitable&& awaitable, bool holds_slot) {
+    children_.add();
+    try {
+      (void)run<std::decay_t<Awaitable>>(std::forward<Awaitable>(awaitable), holds_slot);
+    } catch (...) {
+      // 协程帧分配失败或者拷贝 awaitable 时抛出：子任务没有开始，撤销计数和名额
+      if (holds_slot) {
+        slots_.release();
+      }
+      children_.done();
+      throw;
+    }
+  }
+
+  template <typename Awaitable>
+  detail::scope_task run(Awaitable awaitable, bool holds_slot) {
+    try {
+      co_await std::move(awaitable);
+    } catch (...) {
+      record_error(std::current_exception());
+    }
+    if (holds_slot) {
+      slots_.release();
+    }
+    // done 可能直接恢复 join 的等待者并销毁 scope，之后不能再访问成员
+    children_.done();
+  }
+
+  void record_error(std::exception_ptr error) noexcept {
+    bool expected = false;
+    if (claimed_error_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+      error_ = std::move(error);
+    }
+  }
+
+  wait_group children_;
+  size_t limit_ = 0;
+  semaphore slots_;
+  cancellation_source source_;
+  // 只保存第一个异常，join 取走之后重新开始记录
+  std::atomic<bool> claimed_error_{false};
+  std::exception_ptr error_;
+};
+
+}  // namespace xcoro
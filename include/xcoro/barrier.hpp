@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <utility>
+
+namespace xcoro {
+
+// 可重复使用的协程屏障：每一轮 count 个参与者都 co_await arrive_and_wait() 之后，
+// 由最后一个到达者执行完成回调，然后放行这一轮的所有参与者并开始下一轮。
+// 到达只是一次入栈 CAS 加一次原子减法，不加锁。
+// 完成回调在放行之前执行，不能抛出异常
+class async_barrier {
+ public:
+  explicit async_barrier(size_t count, std::function<void()> completion = {})
+      : count_(count), remaining_(count), completion_(std::move(completion)) {
+    assert(count > 0);
+  }
+
+  async_barrier(const async_barrier&) = delete;
+  async_barrier& operator=(const async_barrier&) = delete;
+
+  class awaiter {
+   public:
+    explicit awaiter(async_barrier& barrier) noexcept : barrier_(barrier) {}
+
+    // 只能在开始等待之前移动，此时节点还没有入栈
+    awaiter(awaiter&& other) noexcept : barrier_(other.barrier_) {}
+    awaiter& operator=(awaiter&&) = delete;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+      async_barrier& barrier = barrier_;
+      awaiter* head = barrier.waiters_.load(std::memory_order_relaxed);
+      do {
+        next_ = head;
+      } while (!barrier.waiters_.compare_exchange_weak(head, this, std::memory_order_release,
+                                                       std::memory_order_relaxed));
+
+      if (barrier.remaining_.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        // 最后一个到达者不会在 await_suspend 返回之前恢复本协程，失败说明这一轮已经完成
+        return try_mark_suspended();
+      }
+      barrier.complete_phase(this);
+      return false;
+    }
+
+    // 返回刚刚完成的轮次，从 0 开始
+    uint64_t await_resume() const noexcept { return phase_; }
+
+   private:
+    enum class suspend_state : std::uint8_t {
+      waiting_await_suspend,
+      suspended,
+      wake_requested,
+    };
+
+    bool try_mark_suspended() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      return suspend_phase_.compare_exchange_strong(expected, suspend_state::suspended,
+                                                    std::memory_order_acq_rel,
+                                                    std::memory_order_acquire);
+    }
+
+    bool should_resume_now() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      if (suspend_phase_.compare_exchange_strong(expected, suspend_state::wake_requested,
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_acquire)) {
+        return false;
+      }
+      return expected == suspend_state::suspended;
+    }
+
+    async_barrier& barrier_;
+    std::coroutine_handle<> handle_{};
+    awaiter* next_ = nullptr;
+    uint64_t phase_ = 0;
+    std::atomic<suspend_state> suspend_phase_{suspend_state::waiting_await_suspend};
+
+    friend class async_barrier;
+  };
+
+  awaiter arrive_and_wait() noexcept { return awaiter{*this}; }
+
+ private:
+  // 只由这一轮最后到达的参与者调用。先取下等待链表并重置计数，再放行其他参与者，
+  // 这样被放行的协程进入下一轮时看到的是新的计数和空链表
+  void complete_phase(awaiter* self) noexcept {
+    awaiter* waiter = waiters_.exchange(nullptr, std::memory_order_acquire);
+    const uint64_t phase = phase_++;
+    if (completion_) {
+      completion_();
+    }
+    remaining_.store(count_, std::memory_order_release);
+
+    while (waiter != nullptr) {
+      awaiter* next = waiter->next_;
+      waiter->phase_ = phase;
+      if (waiter != self && waiter->should_resume_now()) {
+        waiter->handle_.resume();
+      }
+      waiter = next;
+    }
+  }
+
+  const size_t count_;
+  std::atomic<size_t> remaining_;
+  std::atomic<awaiter*> waiters_{nullptr};
+  // 只由每一轮最后到达的参与者访问
+  uint64_t phase_ = 0;
+  std::function<void()> completion_;
+};
+
+}  // namespace xcoro
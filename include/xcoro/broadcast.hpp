@@ -0,0 +1,494 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "xcoro/cancellation_registration.hpp"
+#include "xcoro/cancellation_token.hpp"
+#include "xcoro/channel.hpp"
+#include "xcoro/executor.hpp"
+
+namespace xcoro {
+
+// 接收者落后太多、没读到的消息已经被覆盖。接收者随后从最旧的仍保留的消息继续
+class broadcast_lagged : public std::runtime_error {
+ public:
+  explicit broadcast_lagged(uint64_t skipped)
+      : std::runtime_error("broadcast receiver lagged by " + std::to_string(skipped) +
+                           " messages"),
+        skipped_(skipped) {}
+
+  uint64_t skipped() const noexcept { return skipped_; }
+
+ private:
+  uint64_t skipped_;
+};
+
+namespace detail {
+
+// watch 和 broadcast 共用的“等待版本号变化”的队列。
+// 发布者在锁内把版本号加一，并把整条等待链表摘下来（O(1)，与接收者数量无关），
+// 解锁后沿链表把每个接收者投递回它挂起时所在的调度器，不在发布者的线程上依次执行它们；
+// 没有在等待的接收者不产生任何开销。
+// 节点入队时记录当时的版本号：版本号仍然相等说明节点还在链表里，取消时可以摘除；
+// 否则节点已经被某次发布摘走，由发布者负责恢复
+class version_notifier {
+ public:
+  struct waiter_state {
+    enum class suspend_state : std::uint8_t {
+      waiting_await_suspend,
+      suspended,
+      wake_requested,
+    };
+
+    std::coroutine_handle<> handle{};
+    executor_ref executor{};
+    // 以下字段受 version_notifier::mutex_ 保护
+    waiter_state* prev = nullptr;
+    waiter_state* next = nullptr;
+    uint64_t version = 0;
+    std::atomic<bool> cancelled{false};
+    std::atomic<suspend_state> suspend_phase{suspend_state::waiting_await_suspend};
+
+    bool try_mark_suspended() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      return suspend_phase.compare_exchange_strong(expected, suspend_state::suspended,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_acquire);
+    }
+
+    bool should_resume_now() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      if (suspend_phase.compare_exchange_strong(expected, suspend_state::wake_requested,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+        return false;
+      }
+      return expected == suspend_state::suspended;
+    }
+  };
+
+  // 调用方持有 mutex_。版本号加一并摘下全部等待者，返回值交给 resume_all
+  waiter_state* advance_locked() noexcept {
+    ++version_;
+    return std::exchange(head_, nullptr);
+  }
+
+  waiter_state* close_locked() noexcept {
+    closed_ = true;
+    return std::exchange(head_, nullptr);
+  }
+
+  // 节点一旦交出就可能被销毁，先读出 next
+  static void resume_all(waiter_state* waiter) noexcept {
+    while (waiter != nullptr) {
+      waiter_state* next = waiter->next;
+      if (waiter->should_resume_now()) {
+        resume(*waiter);
+      }
+      waiter = next;
+    }
+  }
+
+  // 挂起等待版本号离开 seen。入队前再检查一次，期间已经有新版本或已关闭时直接继续执行。
+  // 等待节点就在 awaiter 里，取消回调只引用 awaiter：awaiter 析构时先注销回调
+  // （正在别的线程上执行的回调会被等待），再把仍在链表里的节点摘掉
+  class awaiter_base {
+   public:
+    awaiter_base(version_notifier& notifier, cancellation_token token) noexcept
+        : notifier_(notifier), token_(std::move(token)) {}
+
+    // 只能在开始等待之前移动，此时节点还没有被使用
+    awaiter_base(awaiter_base&& other) noexcept
+        : notifier_(other.notifier_), token_(std::move(other.token_)) {}
+    awaiter_base& operator=(awaiter_base&&) = delete;
+
+    ~awaiter_base() {
+      registration_.deregister();
+      // 协程在等待期间被销毁，节点可能还在等待链表里
+      if (waiting_) {
+        notifier_.abandon(node_);
+      }
+    }
+
+   protected:
+    bool cancelled_before_start() noexcept {
+      if (token_.can_be_cancelled() && token_.is_cancellation_requested()) {
+        cancelled_immediate_ = true;
+        return true;
+      }
+      return false;
+    }
+
+    bool suspend_until_changed(std::coroutine_handle<> handle, uint64_t seen) {
+      if (cancelled_before_start()) {
+        return false;
+      }
+
+      node_.handle = handle;
+      node_.executor = current_executor();
+      if (!notifier_.enqueue(node_, seen)) {
+        return false;
+      }
+      // 在锁外注册：令牌可能已经被取消，回调会立即执行并需要加锁
+      waiting_ = true;
+      if (token_.can_be_cancelled()) {
+        registration_ = cancellation_registration(
+            token_, [this]() noexcept { notifier_.cancel(node_); });
+      }
+      return node_.try_mark_suspended();
+    }
+
+    // 恢复之后先注销取消回调，再检查是否因取消而结束
+    void finish_wait() {
+      waiting_ = false;
+      registration_.deregister();
+      if (cancelled_immediate_ || node_.cancelled.load(std::memory_order_acquire)) {
+        throw operation_cancelled{};
+      }
+    }
+
+    version_notifier& notifier_;
+    cancellation_token token_;
+    cancellation_registration registration_;
+    waiter_state node_;
+    bool waiting_ = false;
+    bool cancelled_immediate_ = false;
+  };
+
+  mutable std::mutex mutex_;
+  uint64_t version_ = 0;
+  bool closed_ = false;
+
+ private:
+  bool enqueue(waiter_state& state, uint64_t seen) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (closed_ || version_ != seen) {
+      return false;
+    }
+    state.version = version_;
+    state.prev = nullptr;
+    state.next = head_;
+    if (head_ != nullptr) {
+      head_->prev = &state;
+    }
+    head_ = &state;
+    return true;
+  }
+
+  void cancel(waiter_state& state) noexcept {
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      // 已经被发布或关闭摘走的节点由发布者恢复，这次取消不再生效
+      if (!unlink_locked(state)) {
+        return;
+      }
+      state.cancelled.store(true, std::memory_order_release);
+    }
+    if (state.should_resume_now()) {
+      resume(state);
+    }
+  }
+
+  void abandon(waiter_state& state) noexcept {
+    std::lock_guard<std::mutex> guard(mutex_);
+    (void)unlink_locked(state);
+  }
+
+  // 调用方持有 mutex_。节点还在链表里时摘下并返回 true
+  bool unlink_locked(waiter_state& state) noexcept {
+    if (closed_ || state.version != version_) {
+      return false;
+    }
+    if (state.prev == nullptr) {
+      head_ = state.next;
+    } else {
+      state.prev->next = state.next;
+    }
+    if (state.next != nullptr) {
+      state.next->prev = state.prev;
+    }
+    return true;
+  }
+
+  // 有调度器时投递回等待者挂起时所在的调度器；没有调度器（例如 sync_wait 线程）
+  // 或调度器已停止时才在当前线程直接恢复
+  static void resume(waiter_state& waiter) noexcept {
+    const auto handle = waiter.handle;
+    const executor_ref executor = waiter.executor;
+    if (!executor.post(handle)) {
+      handle.resume();
+    }
+  }
+
+  waiter_state* head_ = nullptr;
+};
+
+}  // namespace detail
+
+// 只保留最新值的广播：每次 publish 替换当前值并把版本号加一，接收者只关心“有没有比上次看到的更新”，
+// 中间的版本可能被跳过。适合配置、路由表这类状态的下发。
+// 值以 std::shared_ptr<const T> 共享，接收者读取只复制指针
+template <typename T>
+class watch {
+ public:
+  class receiver;
+
+  explicit watch(T initial = T{}) : value_(std::make_shared<const T>(std::move(initial))) {}
+
+  watch(const watch&) = delete;
+  watch& operator=(const watch&) = delete;
+
+  // 替换当前值并唤醒所有等待中的接收者。关闭后抛出 channel_closed
+  void publish(T value) {
+    auto next = std::make_shared<const T>(std::move(value));
+    detail::version_notifier::waiter_state* ready;
+    {
+      std::lock_guard<std::mutex> guard(notifier_.mutex_);
+      if (notifier_.closed_) {
+        throw channel_closed{};
+      }
+      value_.swap(next);
+      ready = notifier_.advance_locked();
+    }
+    // 旧值在锁外释放
+    next.reset();
+    detail::version_notifier::resume_all(ready);
+  }
+
+  std::shared_ptr<const T> load() const {
+    std::lock_guard<std::mutex> guard(notifier_.mutex_);
+    return value_;
+  }
+
+  uint64_t version() const {
+    std::lock_guard<std::mutex> guard(notifier_.mutex_);
+    return notifier_.version_;
+  }
+
+  // 关闭后等待中的接收者被唤醒，没有新版本可读时 changed() 返回 nullptr
+  void close() noexcept {
+    detail::version_notifier::waiter_state* ready;
+    {
+      std::lock_guard<std::mutex> guard(notifier_.mutex_);
+      ready = notifier_.close_locked();
+    }
+    detail::version_notifier::resume_all(ready);
+  }
+
+  bool is_closed() const {
+    std::lock_guard<std::mutex> guard(notifier_.mutex_);
+    return notifier_.closed_;
+  }
+
+  // 新的接收者把当前版本视为已读，第一次 changed() 等待下一次 publish
+  receiver subscribe() { return receiver{*this, version()}; }
+
+  class changed_awaiter : detail::version_notifier::awaiter_base {
+   public:
+    changed_awaiter(receiver& rx, cancellation_token token) noexcept
+        : awaiter_base(rx.watch_->notifier_, std::move(token)), receiver_(rx) {}
+
+    bool await_ready() {
+      return cancelled_before_start() || receiver_.take_if_changed(value_);
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      return suspend_until_changed(handle, receiver_.seen_);
+    }
+
+    std::shared_ptr<const T> await_resume() {
+      finish_wait();
+      if (!value_) {
+        receiver_.take_if_changed(value_);
+      }
+      return std::move(value_);
+    }
+
+   private:
+    receiver& receiver_;
+    std::shared_ptr<const T> value_;
+  };
+
+  // 接收者只记录上次看到的版本号，可以复制；不能比 watch 活得更久
+  class receiver {
+   public:
+    // 读取当前值并标记为已读
+    std::shared_ptr<const T> borrow() {
+      std::lock_guard<std::mutex> guard(watch_->notifier_.mutex_);
+      seen_ = watch_->notifier_.version_;
+      return watch_->value_;
+    }
+
+    bool has_changed() const { return watch_->version() != seen_; }
+
+    // 等待比上次看到的更新的值并返回它；watch 关闭并且没有新值时返回 nullptr
+    changed_awaiter changed(cancellation_token token = {}) noexcept {
+      return changed_awaiter{*this, std::move(token)};
+    }
+
+   private:
+    receiver(watch& w, uint64_t seen) noexcept : watch_(&w), seen_(seen) {}
+
+    // 有新版本时取出并返回 true；已关闭也返回 true，此时 out 保持为空
+    bool take_if_changed(std::shared_ptr<const T>& out) {
+      std::lock_guard<std::mutex> guard(watch_->notifier_.mutex_);
+      if (watch_->notifier_.version_ != seen_) {
+        seen_ = watch_->notifier_.version_;
+        out = watch_->value_;
+        return true;
+      }
+      return watch_->notifier_.closed_;
+    }
+
+    watch* watch_;
+    uint64_t seen_;
+
+    friend class watch;
+  };
+
+ private:
+  detail::version_notifier notifier_;
+  std::shared_ptr<const T> value_;
+};
+
+// 有界的多接收者广播：每条消息都会被每个接收者看到一次。
+// 消息存放在容量固定的环形缓冲区里，发送从不等待接收者，只覆盖最旧的消息；
+// 落后超过容量的接收者在下一次接收时得到 broadcast_lagged，并跳到仍保留的最旧消息继续。
+// 发送的开销与接收者数量无关；接收时在锁内复制一份消息
+template <typename T>
+class broadcast {
+ public:
+  class receiver;
+
+  explicit broadcast(size_t capacity) : slots_(capacity < 1 ? 1 : capacity) {}
+
+  broadcast(const broadcast&) = delete;
+  broadcast& operator=(const broadcast&) = delete;
+
+  size_t capacity() const noexcept { return slots_.size(); }
+
+  // 关闭后抛出 channel_closed
+  void send(T value) {
+    detail::version_notifier::waiter_state* ready;
+    {
+      std::lock_guard<std::mutex> guard(notifier_.mutex_);
+      if (notifier_.closed_) {
+        throw channel_closed{};
+      }
+      slots_[notifier_.version_ % slots_.size()] = std::move(value);
+      ready = notifier_.advance_locked();
+    }
+    detail::version_notifier::resume_all(ready);
+  }
+
+  // 关闭后接收者读完还保留的消息，之后得到 std::nullopt
+  void close() noexcept {
+    detail::version_notifier::waiter_state* ready;
+    {
+      std::lock_guard<std::mutex> guard(notifier_.mutex_);
+      ready = notifier_.close_locked();
+    }
+    detail::version_notifier::resume_all(ready);
+  }
+
+  bool is_closed() const {
+    std::lock_guard<std::mutex> guard(notifier_.mutex_);
+    return notifier_.closed_;
+  }
+
+  // 新的接收者只收到订阅之后发送的消息
+  receiver subscribe() {
+    std::lock_guard<std::mutex> guard(notifier_.mutex_);
+    return receiver{*this, notifier_.version_};
+  }
+
+  class recv_awaiter : detail::version_notifier::awaiter_base {
+   public:
+    recv_awaiter(receiver& rx, cancellation_token token) noexcept
+        : awaiter_base(rx.broadcast_->notifier_, std::move(token)), receiver_(rx) {}
+
+    bool await_ready() {
+      if (cancelled_before_start()) {
+        return true;
+      }
+      done_ = receiver_.poll(value_);
+      return done_;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      return suspend_until_changed(handle, receiver_.next_);
+    }
+
+    std::optional<T> await_resume() {
+      finish_wait();
+      if (!done_) {
+        receiver_.poll(value_);
+      }
+      return std::move(value_);
+    }
+
+   private:
+    receiver& receiver_;
+    std::optional<T> value_;
+    bool done_ = false;
+  };
+
+  // 接收者只记录下一条要读的消息序号，可以复制；不能比 broadcast 活得更久
+  class receiver {
+   public:
+    // 不挂起；没有新消息时返回 std::nullopt。落后太多时抛出 broadcast_lagged
+    std::optional<T> try_recv() {
+      std::optional<T> value;
+      poll(value);
+      return value;
+    }
+
+    // 等待下一条消息；broadcast 关闭并且读完后返回 std::nullopt。落后太多时抛出 broadcast_lagged
+    recv_awaiter recv(cancellation_token token = {}) noexcept {
+      return recv_awaiter{*this, std::move(token)};
+    }
+
+   private:
+    receiver(broadcast& b, uint64_t next) noexcept : broadcast_(&b), next_(next) {}
+
+    // 取到消息或已经关闭并读完时返回 true
+    bool poll(std::optional<T>& out) {
+      auto& notifier = broadcast_->notifier_;
+      std::lock_guard<std::mutex> guard(notifier.mutex_);
+      const uint64_t capacity = broadcast_->slots_.size();
+      if (notifier.version_ - next_ > capacity) {
+        const uint64_t oldest = notifier.version_ - capacity;
+        const uint64_t skipped = oldest - next_;
+        next_ = oldest;
+        throw broadcast_lagged{skipped};
+      }
+      if (next_ != notifier.version_) {
+        out = broadcast_->slots_[next_ % capacity];
+        ++next_;
+        return true;
+      }
+      return notifier.closed_;
+    }
+
+    broadcast* broadcast_;
+    uint64_t next_;
+
+    friend class broadcast;
+  };
+
+ private:
+  detail::version_notifier notifier_;
+  std::vector<std::optional<T>> slots_;
+};
+
+}  // namespace xcoro
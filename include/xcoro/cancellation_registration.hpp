@@ -9,35 +9,38 @@ namespace xcoro {
 
 class cancellation_token;
 
+// 回调节点就在注册对象内部，注册时不分配内存，注销是一次 O(1) 的摘链。
+// 注销（包括析构）返回之后回调不会再执行；如果回调正在别的线程上执行，会等它返回。
+// 回调里可以注销自己（例如恢复的协程销毁了持有注册对象的 awaiter），
+// 此时回调对象随之销毁，回调在这之后不能再访问自己捕获的变量
 class cancellation_registration {
  public:
   cancellation_registration() noexcept = default;
   template <typename Callback>
   cancellation_registration(const cancellation_token& token, Callback&& callback) {
-    register_callback(token, callback);
+    register_callback(token, std::forward<Callback>(callback));
   }
 
   cancellation_registration(const cancellation_registration&) = delete;
   cancellation_registration& operator=(const cancellation_registration&) = delete;
 
-  cancellation_registration(cancellation_registration&& other) noexcept
-      : state_(std::move(other.state_)),
-        callback_(std::move(other.callback_)) {}
+  // 还没有被取消的回调连同它在链表中的位置一起转移过来；
+  // 已经开始执行的回调不会转移，移动完成时它已经执行完
+  cancellation_registration(cancellation_registration&& other) noexcept { take(other); }
 
   cancellation_registration& operator=(cancellation_registration&& other) noexcept {
     if (this != &other) {
       deregister();
-      state_ = std::move(other.state_);
-      callback_ = std::move(other.callback_);
+      take(other);
     }
     return *this;
   }
 
   void deregister() noexcept {
     if (state_) {
-      state_->remove_callback(callback_);
+      state_->remove_callback(node_);
+      node_.reset();
       state_.reset();
-      callback_.reset();
     }
   }
 
@@ -49,8 +52,19 @@ class cancellation_registration {
   template <typename Callback>
   void register_callback(const cancellation_token& token, Callback&& callback);
 
+  void take(cancellation_registration& other) noexcept {
+    if (!other.state_) {
+      return;
+    }
+    if (other.state_->try_replace_callback(other.node_, node_)) {
+      state_ = std::move(other.state_);
+    } else {
+      other.deregister();
+    }
+  }
+
   std::shared_ptr<detail::cancellation_state> state_;
-  std::shared_ptr<detail::callback_state> callback_;
+  detail::callback_node node_;
 };
 
-}  // namespace xcoro
\ No newline at end of file
+}  // namespace xcoro
@@ -1,10 +1,10 @@
 #pragma once
 #include <atomic>
-#include <exception>
-#include <functional>
-#include <memory>
-#include <mutex>
-#include <vector>
+#include <cstddef>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
 namespace xcoro {
 
 class cancellation_token;
@@ -12,48 +12,188 @@ class cancellation_token;
 namespace detail {
 class cancellation_state;
 
-class callback_state {
+// 取消回调节点，直接嵌在 cancellation_registration 里，注册和注销都不分配内存。
+// 不超过 kInlineSize 且可以无异常移动的回调放在节点内部，更大的回调才退回到堆上
+class callback_node {
  public:
-  explicit callback_state(std::function<void()>&& cb) : callback_(std::move(cb)) {}
-  void invoke() noexcept {
-    if (!invoked_.exchange(true, std::memory_order_acq_rel)) {
-      try {
-        callback_();
-      } catch (...) {
-        std::terminate();
-      }
+  static constexpr std::size_t kInlineSize = 4 * sizeof(void*);
+
+  callback_node() noexcept = default;
+  callback_node(const callback_node&) = delete;
+  callback_node& operator=(const callback_node&) = delete;
+
+  ~callback_node() { reset(); }
+
+  template <typename Callback>
+  void emplace(Callback&& callback) {
+    using F = std::decay_t<Callback>;
+    reset();
+    if constexpr (stored_inline<F>) {
+      ::new (static_cast<void*>(storage_)) F(std::forward<Callback>(callback));
+    } else {
+      ::new (static_cast<void*>(storage_)) F*(new F(std::forward<Callback>(callback)));
+    }
+    ops_ = &callback_ops_for<F>::value;
+  }
+
+  // 回调抛出异常时直接 terminate，与 noexcept 的取消路径保持一致
+  void invoke() noexcept { ops_->invoke(storage_); }
+
+  void reset() noexcept {
+    if (ops_ != nullptr) {
+      ops_->destroy(storage_);
+      ops_ = nullptr;
     }
   }
 
  private:
-  std::function<void()> callback_;
-  std::atomic<bool> invoked_{false};
+  struct callback_ops {
+    void (*invoke)(void* storage) noexcept;
+    void (*move)(void* to, void* from) noexcept;
+    void (*destroy)(void* storage) noexcept;
+  };
+
+  template <typename F>
+  static constexpr bool stored_inline = sizeof(F) <= kInlineSize &&
+                                        alignof(F) <= alignof(std::max_align_t) &&
+                                        std::is_nothrow_move_constructible_v<F>;
+
+  template <typename F>
+  struct callback_ops_for {
+    static F& get(void* storage) noexcept {
+      if constexpr (stored_inline<F>) {
+        return *std::launder(reinterpret_cast<F*>(storage));
+      } else {
+        return **std::launder(reinterpret_cast<F**>(storage));
+      }
+    }
+
+    static constexpr callback_ops value{
+        [](void* storage) noexcept { get(storage)(); },
+        [](void* to, void* from) noexcept {
+          if constexpr (stored_inline<F>) {
+            ::new (to) F(std::move(get(from)));
+            get(from).~F();
+          } else {
+            ::new (to) F*(&get(from));
+          }
+        },
+        [](void* storage) noexcept {
+          if constexpr (stored_inline<F>) {
+            get(storage).~F();
+          } else {
+            delete &get(storage);
+          }
+        },
+    };
+  };
+
+  // 只在持有 cancellation_state 的锁、from 还在链表里时调用，此时回调不可能在执行
+  void move_callback_from(callback_node& from) noexcept {
+    reset();
+    if (from.ops_ != nullptr) {
+      from.ops_->move(storage_, from.storage_);
+      ops_ = std::exchange(from.ops_, nullptr);
+    }
+  }
+
+  // 以下字段都由 cancellation_state 在锁内维护
+  callback_node* prev_ = nullptr;
+  callback_node* next_ = nullptr;
+  bool linked_ = false;
+  // 回调执行期间指向执行方栈上的标志，回调里注销自己时置位，执行方之后不再访问节点
+  bool* destroyed_ = nullptr;
+  // 回调执行完后置位，在别的线程注销正在执行的节点时等它
+  std::atomic<bool> done_{false};
+
+  const callback_ops* ops_ = nullptr;
+  alignas(std::max_align_t) unsigned char storage_[kInlineSize];
+
+  friend class cancellation_state;
 };
 
-class cancellation_state : public std::enable_shared_from_this<cancellation_state> {
+// 回调节点组成侵入式双向链表，由一个自旋锁保护：临界区只有几次指针操作，
+// 回调本身总是在锁外执行
+class cancellation_state {
  public:
   bool is_cancellation_requested() const noexcept {
     return cancelled_.load(std::memory_order_acquire);
   }
-  bool try_add_callback(const std::shared_ptr<callback_state>& cb) {
+
+  // 已经请求取消时返回 false，由调用方直接执行回调
+  bool try_add_callback(callback_node& node) noexcept {
     if (is_cancellation_requested()) {
       return false;
     }
-    std::lock_guard<std::mutex> guard(mutex_);
+    lock();
     if (cancelled_.load(std::memory_order_relaxed)) {
+      unlock();
       return false;
     }
-    callbacks_.push_back(cb);
+    // 追加到链表尾部，回调按注册顺序执行
+    node.prev_ = tail_;
+    node.next_ = nullptr;
+    if (tail_ != nullptr) {
+      tail_->next_ = &node;
+    } else {
+      head_ = &node;
+    }
+    tail_ = &node;
+    node.done_.store(false, std::memory_order_relaxed);
+    node.linked_ = true;
+    unlock();
     return true;
   }
 
-  void remove_callback(const std::shared_ptr<callback_state>& cb) noexcept {
-    std::lock_guard<std::mutex> guard(mutex_);
-    for (auto it = callbacks_.begin(); it != callbacks_.end(); ++it) {
-      if (*it == cb) {
-        callbacks_.erase(it);
-        break;
-      }
+  // 用 to 原地替换链表里的 from，并把回调移过去；from 已经被取出执行时返回 false
+  bool try_replace_callback(callback_node& from, callback_node& to) noexcept {
+    lock();
+    if (!from.linked_) {
+      unlock();
+      return false;
+    }
+    to.prev_ = from.prev_;
+    to.next_ = from.next_;
+    if (to.prev_ != nullptr) {
+      to.prev_->next_ = &to;
+    } else {
+      head_ = &to;
+    }
+    if (to.next_ != nullptr) {
+      to.next_->prev_ = &to;
+    } else {
+      tail_ = &to;
+    }
+    to.linked_ = true;
+    to.done_.store(false, std::memory_order_relaxed);
+    from.linked_ = false;
+    to.move_callback_from(from);
+    unlock();
+    return true;
+  }
+
+  // 返回之后回调不会再被执行，也没有在别的线程上执行。
+  // 在回调内部注销自己时不等待（否则会自己等自己），回调返回后执行方也不再访问节点
+  void remove_callback(callback_node& node) noexcept {
+    lock();
+    if (node.linked_) {
+      unlink(node);
+      unlock();
+      return;
+    }
+    if (running_ != &node) {
+      // 从未入链或者已经执行完
+      unlock();
+      return;
+    }
+    if (invoking_thread_ == std::this_thread::get_id()) {
+      *node.destroyed_ = true;
+      unlock();
+      return;
+    }
+    unlock();
+    while (!node.done_.load(std::memory_order_acquire)) {
+      std::this_thread::yield();
     }
   }
 
@@ -62,27 +202,69 @@ class cancellation_state : public std::enable_shared_from_this<cancellation_stat
     if (!cancelled_.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
       return false;
     }
-    std::vector<std::shared_ptr<callback_state>> callbacks;
-    {
-      std::lock_guard<std::mutex> guard(mutex_);
-      callbacks.swap(callbacks_);  // 把callbacks_置空
-    }
-    // 把回调列表在持锁期间“搬出去”，然后释放锁后再逐个调用
-    // - 保证回调只执行一次：callbacks_被清空（swap后为空），后续不会再被执行
-    // - 异常/noexcept友好：swap是noexcept，不会在request_cancellation()里抛异常
-    // - 降低临界区事件：只在swap时持锁，减少锁竞争
-    for (auto& cb : callbacks) {
-      cb->invoke();
+    // cancelled_ 置位之后不会再有新节点入链，逐个取出链表头在锁外执行，
+    // 执行期间其它节点仍然可以 O(1) 地注销
+    lock();
+    invoking_thread_ = std::this_thread::get_id();
+    for (;;) {
+      callback_node* node = head_;
+      if (node == nullptr) {
+        running_ = nullptr;
+        unlock();
+        break;
+      }
+      unlink(*node);
+      running_ = node;
+      bool destroyed = false;
+      node->destroyed_ = &destroyed;
+      unlock();
+
+      node->invoke();
+      if (!destroyed) {
+        // 置位之后注销方可能立刻释放节点
+        node->done_.store(true, std::memory_order_release);
+      }
+      lock();
     }
     return true;
   }
 
  private:
+  void lock() noexcept {
+    while (locked_.exchange(true, std::memory_order_acquire)) {
+      while (locked_.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void unlock() noexcept { locked_.store(false, std::memory_order_release); }
+
+  void unlink(callback_node& node) noexcept {
+    if (node.prev_ != nullptr) {
+      node.prev_->next_ = node.next_;
+    } else {
+      head_ = node.next_;
+    }
+    if (node.next_ != nullptr) {
+      node.next_->prev_ = node.prev_;
+    } else {
+      tail_ = node.prev_;
+    }
+    node.prev_ = nullptr;
+    node.next_ = nullptr;
+    node.linked_ = false;
+  }
+
   std::atomic<bool> cancelled_{false};
-  std::mutex mutex_;
-  std::vector<std::shared_ptr<callback_state>> callbacks_;
+  std::atomic<bool> locked_{false};
+  callback_node* head_ = nullptr;
+  callback_node* tail_ = nullptr;
+  // 正在执行的节点和执行它的线程，只在锁内访问
+  callback_node* running_ = nullptr;
+  std::thread::id invoking_thread_{};
 };
 
 }  // namespace detail
 
-}  // namespace xcoro
\ No newline at end of file
+}  // namespace xcoro
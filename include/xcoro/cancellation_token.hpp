@@ -1,6 +1,8 @@
 #pragma once
 
+#include <atomic>
 #include <coroutine>
+#include <cstdint>
 #include <memory>
 #include <utility>
 
@@ -52,16 +54,45 @@ class cancellation_token::awaiter {
 
   bool await_suspend(std::coroutine_handle<> awaiting) noexcept {
     awaiting_ = awaiting;  // 保存待恢复协程
-    registration_ = cancellation_registration(token_, [this]() noexcept { awaiting_.resume(); });
-    return true;  // 挂起协程，将来会在注册的回调函数中恢复
+    // 回调可能在另一个线程上立即执行，await_suspend 返回之前不能恢复本协程，交给下面的 CAS 决定
+    registration_ = cancellation_registration(token_, [this]() noexcept {
+      if (should_resume_now()) {
+        awaiting_.resume();
+      }
+    });
+    return try_mark_suspended();  // 失败说明回调已经执行过，直接继续执行
   }
 
   void await_resume() noexcept {}
 
  private:
+  enum class suspend_state : std::uint8_t {
+    waiting_await_suspend,
+    suspended,
+    wake_requested,
+  };
+
+  bool try_mark_suspended() noexcept {
+    auto expected = suspend_state::waiting_await_suspend;
+    return suspend_phase_.compare_exchange_strong(expected, suspend_state::suspended,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire);
+  }
+
+  bool should_resume_now() noexcept {
+    auto expected = suspend_state::waiting_await_suspend;
+    if (suspend_phase_.compare_exchange_strong(expected, suspend_state::wake_requested,
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_acquire)) {
+      return false;
+    }
+    return expected == suspend_state::suspended;
+  }
+
   std::coroutine_handle<> awaiting_;
   cancellation_token token_;
-  cancellation_registration registration_;  // 该awaiter对象的销毁，会导致registration_的析构，cancellation_registration对象析构，会自动从绑定的state对象中的回调数组中退出
+  cancellation_registration registration_;  // 该awaiter对象的销毁，会导致registration_的析构，cancellation_registration对象析构，会自动从绑定的state对象中的回调链表中退出
+  std::atomic<suspend_state> suspend_phase_{suspend_state::waiting_await_suspend};
 };
 
 inline auto cancellation_token::operator co_await() const noexcept {
@@ -73,15 +104,13 @@ inline void cancellation_registration::register_callback(const cancellation_toke
   if (!token.can_be_cancelled()) {
     return;
   }
-  auto state = token.state_;
-  auto cb_state = std::make_shared<detail::callback_state>(
-      std::function<void()>(std::forward<Callback>(callback)));
-  if (state->try_add_callback(cb_state)) {
-    state_ = std::move(state);
-    callback_ = std::move(cb_state);
+  node_.emplace(std::forward<Callback>(callback));
+  if (token.state_->try_add_callback(node_)) {
+    state_ = token.state_;
   } else {
     // try_add_callback失败，表示已经request cancellation了，所以直接调用回调
-    cb_state->invoke();
+    node_.invoke();
+    node_.reset();
   }
 }
 
@@ -0,0 +1,611 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "xcoro/cancellation_registration.hpp"
+#include "xcoro/cancellation_token.hpp"
+#include "xcoro/executor.hpp"
+
+namespace xcoro {
+
+class channel_closed : public std::exception {
+ public:
+  const char* what() const noexcept override { return "channel closed"; }
+};
+
+// 多生产者多消费者的协程通道。
+// 有界通道使用固定大小的环形缓冲区，缓冲区满时 send 挂起；容量为 0 时没有缓冲，
+// 发送者要等接收者直接取走值才返回；unbounded 通道的缓冲区按需倍增，send 从不挂起。
+// 接收者在等待时，send 把值直接交给它，不经过缓冲区。
+// 等待节点放在 awaiter 里，等待不分配内存；被唤醒的协程投递回它挂起时所在的调度器，
+// 不会在发送方、接收方或关闭方的线程上继续执行。
+// close() 之后 send 抛出 channel_closed，接收者取完缓冲区里剩余的值后得到 std::nullopt
+template <typename T>
+class channel {
+ public:
+  static constexpr size_t unbounded = std::numeric_limits<size_t>::max();
+
+  explicit channel(size_t capacity = unbounded) : capacity_(capacity) {
+    if (capacity_ != unbounded) {
+      slots_.resize(capacity_);
+    }
+  }
+
+  channel(const channel&) = delete;
+  channel& operator=(const channel&) = delete;
+
+  size_t capacity() const noexcept { return capacity_; }
+
+  size_t size() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return size_;
+  }
+
+  bool is_closed() const {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return closed_;
+  }
+
+  // 缓冲区已满或通道已关闭时返回 false，此时 value 不会被移走
+  bool try_send(T&& value) {
+    ready_list ready;
+    bool sent = false;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      sent = !closed_ && offer_locked(value, ready);
+    }
+    wake(ready);
+    return sent;
+  }
+
+  bool try_send(const T& value) {
+    T copy(value);
+    return try_send(std::move(copy));
+  }
+
+  std::optional<T> try_recv() {
+    std::optional<T> result;
+    ready_list ready;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      take_locked([&](T&& value) { result.emplace(std::move(value)); }, 1, ready);
+    }
+    wake(ready);
+    return result;
+  }
+
+  // 关闭通道：唤醒所有等待者，等待中的发送者抛出 channel_closed，其值不会进入通道
+  void close() noexcept {
+    ready_list ready;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (closed_) {
+        return;
+      }
+      closed_ = true;
+      for (auto* list : {&receivers_, &senders_}) {
+        while (waiter_state* waiter = list->pop_front()) {
+          if (waiter->try_mark_resumed()) {
+            waiter->closed = true;
+            ready.push_back(waiter);
+          }
+        }
+      }
+    }
+    wake(ready);
+  }
+
+ private:
+  struct waiter_state {
+    enum class suspend_state : std::uint8_t {
+      waiting_await_suspend,
+      suspended,
+      wake_requested,
+    };
+
+    std::coroutine_handle<> handle{};
+    executor_ref executor{};
+    // 等待队列的链接，受 channel::mutex_ 保护；出队后 next 用来串起待恢复的等待者
+    waiter_state* prev = nullptr;
+    waiter_state* next = nullptr;
+    bool queued = false;
+    bool sender = false;
+    // 以下字段由赢得 resumed 的一方写入，等待者恢复后读取
+    bool closed = false;
+    T* value = nullptr;
+    std::optional<T>* slot = nullptr;
+    std::vector<T>* batch = nullptr;
+    std::atomic<bool> resumed{false};
+    std::atomic<bool> cancelled{false};
+    std::atomic<suspend_state> suspend_phase{suspend_state::waiting_await_suspend};
+
+    bool try_mark_resumed() noexcept {
+      return !resumed.exchange(true, std::memory_order_acq_rel);
+    }
+
+    bool try_mark_suspended() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      return suspend_phase.compare_exchange_strong(expected, suspend_state::suspended,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_acquire);
+    }
+
+    bool should_resume_now() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      if (suspend_phase.compare_exchange_strong(expected, suspend_state::wake_requested,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+        return false;
+      }
+      return expected == suspend_state::suspended;
+    }
+  };
+
+  class waiter_list {
+   public:
+    void push_back(waiter_state& waiter) noexcept {
+      waiter.prev = tail_;
+      waiter.next = nullptr;
+      if (tail_ == nullptr) {
+        head_ = &waiter;
+      } else {
+        tail_->next = &waiter;
+      }
+      tail_ = &waiter;
+      waiter.queued = true;
+    }
+
+    waiter_state* pop_front() noexcept {
+      waiter_state* waiter = head_;
+      if (waiter != nullptr) {
+        unlink(*waiter);
+      }
+      return waiter;
+    }
+
+    void unlink(waiter_state& waiter) noexcept {
+      if (waiter.prev == nullptr) {
+        head_ = waiter.next;
+      } else {
+        waiter.prev->next = waiter.next;
+      }
+      if (waiter.next == nullptr) {
+        tail_ = waiter.prev;
+      } else {
+        waiter.next->prev = waiter.prev;
+      }
+      waiter.prev = waiter.next = nullptr;
+      waiter.queued = false;
+    }
+
+   private:
+    waiter_state* head_ = nullptr;
+    waiter_state* tail_ = nullptr;
+  };
+
+  // 在锁内收集、锁外恢复的等待者，按加入的顺序恢复
+  struct ready_list {
+    waiter_state* head = nullptr;
+    waiter_state* tail = nullptr;
+
+    void push_back(waiter_state* waiter) noexcept {
+      waiter->next = nullptr;
+      if (tail == nullptr) {
+        head = waiter;
+      } else {
+        tail->next = waiter;
+      }
+      tail = waiter;
+    }
+  };
+
+  // 三种 awaiter 共用的挂起流程：先在锁内重试一次，仍然不能完成才入队。
+  // 等待节点就在 awaiter 里，取消回调只引用 awaiter：awaiter 析构时先注销回调
+  // （正在别的线程上执行的回调会被等待），再把仍在队列里的节点摘掉
+  class awaiter_base {
+   public:
+    explicit awaiter_base(channel& ch, cancellation_token token) noexcept
+        : channel_(ch), token_(std::move(token)) {}
+
+    // 只能在开始等待之前移动（例如把 awaiter 交给 sync_wait / when_all），此时节点还没有被使用
+    awaiter_base(awaiter_base&& other) noexcept
+        : channel_(other.channel_), token_(std::move(other.token_)) {}
+    awaiter_base& operator=(awaiter_base&&) = delete;
+
+    ~awaiter_base() {
+      registration_.deregister();
+      // 协程在等待期间被销毁，节点可能还在等待队列里
+      if (waiting_) {
+        channel_.abandon_waiter(node_);
+      }
+    }
+
+   protected:
+    bool cancelled_before_start() noexcept {
+      if (token_.can_be_cancelled() && token_.is_cancellation_requested()) {
+        cancelled_immediate_ = true;
+        return true;
+      }
+      return false;
+    }
+
+    waiter_state& prepare(std::coroutine_handle<> handle) noexcept {
+      node_.handle = handle;
+      node_.executor = current_executor();
+      return node_;
+    }
+
+    // 节点已经入队，在锁外注册取消回调（回调可能立即执行并需要加锁），然后尝试挂起
+    bool suspend_queued() noexcept {
+      waiting_ = true;
+      if (token_.can_be_cancelled()) {
+        registration_ = cancellation_registration(
+            token_, [this]() noexcept { channel_.cancel_waiter(node_); });
+      }
+      return node_.try_mark_suspended();
+    }
+
+    // 恢复之后先注销取消回调，再检查是否因取消而结束
+    void finish_wait() {
+      waiting_ = false;
+      registration_.deregister();
+      if (cancelled_immediate_ || node_.cancelled.load(std::memory_order_acquire)) {
+        throw operation_cancelled{};
+      }
+    }
+
+    bool closed_while_waiting() const noexcept { return node_.closed; }
+
+    channel& channel_;
+    cancellation_token token_;
+    cancellation_registration registration_;
+    waiter_state node_;
+    bool waiting_ = false;
+    bool cancelled_immediate_ = false;
+  };
+
+ public:
+  class send_awaiter : awaiter_base {
+   public:
+    send_awaiter(channel& ch, T value, cancellation_token token)
+        : awaiter_base(ch, std::move(token)), value_(std::move(value)) {}
+
+    bool await_ready() {
+      if (this->cancelled_before_start()) {
+        return true;
+      }
+      return try_complete();
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      waiter_state& state = this->prepare(handle);
+      state.sender = true;
+      state.value = &value_;
+
+      ready_list ready;
+      bool queued = false;
+      {
+        std::lock_guard<std::mutex> guard(this->channel_.mutex_);
+        if (this->channel_.closed_) {
+          closed_immediate_ = true;
+          return false;
+        }
+        if (!this->channel_.offer_locked(value_, ready)) {
+          this->channel_.senders_.push_back(state);
+          queued = true;
+        }
+      }
+      wake(ready);
+      return queued && this->suspend_queued();
+    }
+
+    void await_resume() {
+      this->finish_wait();
+      if (closed_immediate_ || this->closed_while_waiting()) {
+        throw channel_closed{};
+      }
+    }
+
+   private:
+    bool try_complete() {
+      ready_list ready;
+      {
+        std::lock_guard<std::mutex> guard(this->channel_.mutex_);
+        if (this->channel_.closed_) {
+          closed_immediate_ = true;
+          return true;
+        }
+        if (!this->channel_.offer_locked(value_, ready)) {
+          return false;
+        }
+      }
+      wake(ready);
+      return true;
+    }
+
+    T value_;
+    bool closed_immediate_ = false;
+  };
+
+  class recv_awaiter : awaiter_base {
+   public:
+    recv_awaiter(channel& ch, cancellation_token token) : awaiter_base(ch, std::move(token)) {}
+
+    bool await_ready() {
+      if (this->cancelled_before_start()) {
+        return true;
+      }
+      ready_list ready;
+      bool done = false;
+      {
+        std::lock_guard<std::mutex> guard(this->channel_.mutex_);
+        done = take_one(ready) || this->channel_.closed_;
+      }
+      wake(ready);
+      return done;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      waiter_state& state = this->prepare(handle);
+      state.slot = &result_;
+
+      ready_list ready;
+      bool queued = false;
+      {
+        std::lock_guard<std::mutex> guard(this->channel_.mutex_);
+        if (!take_one(ready) && !this->channel_.closed_) {
+          this->channel_.receivers_.push_back(state);
+          queued = true;
+        }
+      }
+      wake(ready);
+      return queued && this->suspend_queued();
+    }
+
+    // 通道已关闭并且没有剩余的值时返回 std::nullopt
+    std::optional<T> await_resume() {
+      this->finish_wait();
+      return std::move(result_);
+    }
+
+   private:
+    bool take_one(ready_list& ready) {
+      return this->channel_.take_locked([&](T&& value) { result_.emplace(std::move(value)); }, 1,
+                                        ready) != 0;
+    }
+
+    std::optional<T> result_;
+  };
+
+  class recv_many_awaiter : awaiter_base {
+   public:
+    recv_many_awaiter(channel& ch, std::vector<T>& out, size_t limit, cancellation_token token)
+        : awaiter_base(ch, std::move(token)), out_(out), limit_(limit), initial_size_(out.size()) {}
+
+    bool await_ready() {
+      if (this->cancelled_before_start()) {
+        return true;
+      }
+      ready_list ready;
+      bool done = false;
+      {
+        std::lock_guard<std::mutex> guard(this->channel_.mutex_);
+        done = take_batch(ready) || this->channel_.closed_;
+      }
+      wake(ready);
+      return done;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) {
+      // 等待中的接收者只会被直接交付一个值，先预留这一个位置，
+      // 交付时 push_back 不会分配内存，也就不会在发送方那里抛出异常
+      out_.reserve(out_.size() + 1);
+      waiter_state& state = this->prepare(handle);
+      state.batch = &out_;
+
+      ready_list ready;
+      bool queued = false;
+      {
+        std::lock_guard<std::mutex> guard(this->channel_.mutex_);
+        if (!take_batch(ready) && !this->channel_.closed_) {
+          this->channel_.receivers_.push_back(state);
+          queued = true;
+        }
+      }
+      wake(ready);
+      return queued && this->suspend_queued();
+    }
+
+    // 返回追加到 out 的值的个数，0 表示通道已关闭并且没有剩余的值
+    size_t await_resume() {
+      this->finish_wait();
+      return out_.size() - initial_size_;
+    }
+
+   private:
+    bool take_batch(ready_list& ready) {
+      return this->channel_.take_locked([&](T&& value) { out_.push_back(std::move(value)); },
+                                        limit_, ready) != 0;
+    }
+
+    std::vector<T>& out_;
+    size_t limit_;
+    size_t initial_size_;
+  };
+
+  // 缓冲区满（或无缓冲且没有接收者）时挂起，通道关闭时抛出 channel_closed
+  send_awaiter send(T value, cancellation_token token = {}) {
+    return send_awaiter{*this, std::move(value), std::move(token)};
+  }
+
+  recv_awaiter recv(cancellation_token token = {}) { return recv_awaiter{*this, std::move(token)}; }
+
+  // 至少取到一个值才返回，一次最多取 limit 个追加到 out 末尾，减少逐个接收的加锁和唤醒次数。
+  // 返回 0 表示通道已关闭，所以 limit 必须为正数，否则抛出 invalid_argument
+  recv_many_awaiter recv_many(std::vector<T>& out, size_t limit, cancellation_token token = {}) {
+    if (limit == 0) {
+      throw std::invalid_argument("channel::recv_many limit must be positive");
+    }
+    return recv_many_awaiter{*this, out, limit, std::move(token)};
+  }
+
+ private:
+  // 有调度器时投递回等待者挂起时所在的调度器；没有调度器（例如 sync_wait 线程）
+  // 或调度器已停止时才在当前线程直接恢复
+  static void resume(waiter_state& waiter) noexcept {
+    const auto handle = waiter.handle;
+    const executor_ref executor = waiter.executor;
+    if (!executor.post(handle)) {
+      handle.resume();
+    }
+  }
+
+  // 在锁外恢复一串等待者。节点一旦交出就可能被销毁，先读出 next
+  static void wake(const ready_list& ready) noexcept {
+    for (waiter_state* waiter = ready.head; waiter != nullptr;) {
+      waiter_state* next = waiter->next;
+      if (waiter->should_resume_now()) {
+        resume(*waiter);
+      }
+      waiter = next;
+    }
+  }
+
+  // 调用方持有 mutex_。跳过正在被取消的节点，返回下一个可以处理的等待者
+  static waiter_state* next_waiter(waiter_list& list) noexcept {
+    while (waiter_state* waiter = list.pop_front()) {
+      if (waiter->try_mark_resumed()) {
+        return waiter;
+      }
+    }
+    return nullptr;
+  }
+
+  // 调用方持有 mutex_。把 value 交给等待中的接收者或放进缓冲区，成功返回 true；
+  // 失败时 value 保持不变
+  bool offer_locked(T& value, ready_list& ready) {
+    // 有接收者在等说明缓冲区是空的，直接交给它
+    if (waiter_state* receiver = next_waiter(receivers_)) {
+      if (receiver->batch != nullptr) {
+        receiver->batch->push_back(std::move(value));
+      } else {
+        receiver->slot->emplace(std::move(value));
+      }
+      ready.push_back(receiver);
+      return true;
+    }
+    if (size_ < capacity_) {
+      push(std::move(value));
+      return true;
+    }
+    return false;
+  }
+
+  // 调用方持有 mutex_。按 FIFO 顺序取最多 limit 个值交给 sink，返回取到的个数。
+  // 缓冲区腾出空间后立即用挂起的发送者补上；无缓冲时直接从发送者手里取
+  template <typename Sink>
+  size_t take_locked(Sink&& sink, size_t limit, ready_list& ready) {
+    size_t taken = 0;
+    for (;;) {
+      for (; taken < limit && size_ > 0; ++taken) {
+        sink(pop());
+      }
+      bool refilled = false;
+      while (size_ < capacity_) {
+        waiter_state* sender = next_waiter(senders_);
+        if (sender == nullptr) {
+          break;
+        }
+        push(std::move(*sender->value));
+        ready.push_back(sender);
+        refilled = true;
+      }
+      if (taken == limit || !refilled) {
+        break;
+      }
+    }
+
+    while (taken < limit) {
+      waiter_state* sender = next_waiter(senders_);
+      if (sender == nullptr) {
+        break;
+      }
+      sink(std::move(*sender->value));
+      ready.push_back(sender);
+      ++taken;
+    }
+    return taken;
+  }
+
+  void push(T&& value) {
+    if (size_ == slots_.size()) {
+      grow();
+    }
+    slots_[(head_ + size_) % slots_.size()].emplace(std::move(value));
+    ++size_;
+  }
+
+  T pop() {
+    auto& slot = slots_[head_];
+    T value = std::move(*slot);
+    slot.reset();
+    head_ = (head_ + 1) % slots_.size();
+    --size_;
+    return value;
+  }
+
+  // 只有 unbounded 通道会扩容，按顺序搬到新的环形缓冲区
+  void grow() {
+    std::vector<std::optional<T>> next(std::max<size_t>(16, slots_.size() * 2));
+    for (size_t i = 0; i < size_; ++i) {
+      next[i] = std::move(slots_[(head_ + i) % slots_.size()]);
+    }
+    slots_ = std::move(next);
+    head_ = 0;
+  }
+
+  void cancel_waiter(waiter_state& state) noexcept {
+    if (!state.try_mark_resumed()) {
+      return;
+    }
+    state.cancelled.store(true, std::memory_order_release);
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (state.queued) {
+        (state.sender ? senders_ : receivers_).unlink(state);
+      }
+    }
+    if (state.should_resume_now()) {
+      resume(state);
+    }
+  }
+
+  void abandon_waiter(waiter_state& state) noexcept {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (state.queued) {
+      (state.sender ? senders_ : receivers_).unlink(state);
+    }
+  }
+
+  mutable std::mutex mutex_;
+  size_t capacity_;
+  std::vector<std::optional<T>> slots_;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  bool closed_ = false;
+  waiter_list senders_;
+  waiter_list receivers_;
+};
+
+}  // namespace xcoro
@@ -0,0 +1,317 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <limits>
+#include <mutex>
+#include <optional>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "xcoro/async_scope.hpp"
+#include "xcoro/awaitable_traits.hpp"
+#include "xcoro/condition_variable.hpp"
+#include "xcoro/mutex.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+
+namespace xcoro {
+
+namespace detail {
+
+// 从共享迭代器里取出的元素。引用类型的元素只保存指针；迭代器按值产生的元素（如 views::iota）
+// 在 ++it 之后就失效了，需要复制一份
+template <typename Ref>
+class concurrent_item {
+ public:
+  using reference = std::conditional_t<std::is_reference_v<Ref>, Ref, Ref&>;
+
+  explicit concurrent_item(Ref ref) {
+    if constexpr (std::is_reference_v<Ref>) {
+      value_ = std::addressof(ref);
+    } else {
+      value_ = std::move(ref);
+    }
+  }
+
+  reference get() noexcept {
+    if constexpr (std::is_reference_v<Ref>) {
+      return static_cast<Ref>(*value_);
+    } else {
+      return value_;
+    }
+  }
+
+ private:
+  std::conditional_t<std::is_reference_v<Ref>, std::remove_reference_t<Ref>*, Ref> value_;
+};
+
+// 所有 worker 共享的输入位置。迭代器只在锁内推进，任意 input_range 都可以使用
+template <typename View>
+class concurrent_source {
+ public:
+  using item = concurrent_item<std::ranges::range_reference_t<View>>;
+
+  explicit concurrent_source(View& view)
+      : it_(std::ranges::begin(view)), end_(std::ranges::end(view)) {}
+
+  // 取出下一个元素；已经取完或者有任务失败时返回 false
+  bool pull(size_t& index, std::optional<item>& out) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (failed_ || it_ == end_) {
+      return false;
+    }
+    index = next_index_++;
+    out.emplace(*it_);
+    ++it_;
+    return true;
+  }
+
+  // 有任务失败后不再启动新的元素，已经在运行的任务照常结束
+  void fail() noexcept {
+    std::lock_guard<std::mutex> guard(mutex_);
+    failed_ = true;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::ranges::iterator_t<View> it_;
+  std::ranges::sentinel_t<View> end_;
+  size_t next_index_ = 0;
+  bool failed_ = false;
+};
+
+template <typename View, typename Body>
+task<> concurrent_worker(concurrent_source<View>& source, Body& body, thread_pool* pool) {
+  if (pool != nullptr) {
+    co_await pool->schedule();
+  }
+  size_t index = 0;
+  std::optional<typename concurrent_source<View>::item> item;
+  while (source.pull(index, item)) {
+    try {
+      co_await body(index, item->get());
+    } catch (...) {
+      source.fail();
+      throw;
+    }
+    item.reset();
+  }
+}
+
+inline void check_concurrency_limit(size_t limit) {
+  if (limit == 0) {
+    throw std::invalid_argument("concurrency limit must be positive");
+  }
+}
+
+// 启动最多 limit 个 worker，每个 worker 循环取下一个元素并等待 body(index, item) 完成，
+// 所以同时在运行的 body 不超过 limit 个。第一个异常在所有 worker 结束后重新抛出
+template <typename View, typename Body>
+task<> run_concurrent(View view, size_t limit, thread_pool* pool, Body body) {
+  size_t workers = limit;
+  if constexpr (std::ranges::sized_range<View>) {
+    workers = std::min<size_t>(workers, std::ranges::size(view));
+  }
+
+  concurrent_source<View> source(view);
+  async_scope scope;
+  for (size_t i = 0; i < workers; ++i) {
+    scope.spawn(concurrent_worker(source, body, pool));
+  }
+  co_await scope.join();
+}
+
+template <typename Range, typename Fn>
+using concurrent_result_t = std::remove_cvref_t<awaiter_result_t<std::invoke_result_t<
+    Fn&, typename concurrent_item<std::ranges::range_reference_t<
+             std::views::all_t<Range>>>::reference>>>;
+
+template <typename View, typename Fn>
+task<std::vector<concurrent_result_t<View, Fn>>> map_concurrent_impl(View view, size_t limit,
+                                                                     thread_pool* pool, Fn fn) {
+  using result_type = concurrent_result_t<View, Fn>;
+  // 可以默认构造的结果直接按下标写进最终的 vector；否则先放进 optional 槽位，最后再移动出来。
+  // 不知道大小的 range 按需扩展
+  constexpr bool kDirect =
+      std::is_default_constructible_v<result_type> && std::is_move_assignable_v<result_type>;
+  using slot_type = std::conditional_t<kDirect, result_type, std::optional<result_type>>;
+  std::mutex mutex;
+  std::vector<slot_type> slots;
+  if constexpr (std::ranges::sized_range<View>) {
+    slots.resize(std::ranges::size(view));
+  }
+
+  co_await run_concurrent(std::move(view), limit, pool,
+                          [&](size_t index, auto&& item) -> task<> {
+                            result_type result = co_await fn(item);
+                            std::lock_guard<std::mutex> guard(mutex);
+                            if (index >= slots.size()) {
+                              slots.resize(index + 1);
+                            }
+                            slots[index] = std::move(result);
+                          });
+
+  if constexpr (kDirect) {
+    co_return slots;
+  } else {
+    std::vector<result_type> results;
+    results.reserve(slots.size());
+    for (auto& slot : slots) {
+      results.push_back(std::move(*slot));
+    }
+    co_return results;
+  }
+}
+
+// 按输入顺序流式交出结果。已经完成、还没轮到的结果放在大小为 limit 的环形窗口里：
+// 下标超出窗口的结果要等前面的交出去才能放入，它的 worker 在此期间不会取新的元素，
+// 所以最多缓存 limit 个结果，一个很慢的元素只会让后面的元素暂停，不会让缓存无限增长
+template <typename View, typename Fn, typename Sink>
+task<> map_concurrent_ordered_impl(View view, size_t limit, thread_pool* pool, Fn fn,
+                                   Sink sink) {
+  using result_type = concurrent_result_t<View, Fn>;
+  std::vector<std::optional<result_type>> window(limit);
+  size_t next = 0;
+  // 第一个失败（fn 或 sink 抛出异常）的下标；它之前的结果照常按顺序交出，它及之后的丢弃
+  size_t failed_index = std::numeric_limits<size_t>::max();
+  mutex window_mutex;
+  condition_variable advanced;
+
+  co_await run_concurrent(
+      std::move(view), limit, pool, [&](size_t index, auto&& item) -> task<> {
+        std::optional<result_type> result;
+        std::exception_ptr error;
+        try {
+          result.emplace(co_await fn(item));
+        } catch (...) {
+          error = std::current_exception();
+        }
+
+        co_await window_mutex.lock();
+        if (error) {
+          failed_index = std::min(failed_index, index);
+        } else {
+          while (index < failed_index && index >= next + limit) {
+            co_await advanced.wait(window_mutex);
+          }
+          if (index >= failed_index) {
+            window_mutex.unlock();
+            co_return;
+          }
+          window[index % limit] = std::move(result);
+          try {
+            for (auto* slot = &window[next % limit]; next < failed_index && slot->has_value();
+                 slot = &window[next % limit]) {
+              auto value = std::move(**slot);
+              slot->reset();
+              const size_t current = next++;
+              sink(current, std::move(value));
+            }
+          } catch (...) {
+            error = std::current_exception();
+            failed_index = std::min(failed_index, next - 1);
+          }
+        }
+        window_mutex.unlock();
+        // 等待者只关心 next 和 failed_index，无条件通知最简单，代价只是一次空唤醒
+        advanced.notify_all();
+        if (error) {
+          std::rethrow_exception(error);
+        }
+      });
+}
+
+template <typename View, typename Fn, typename Sink>
+task<> map_concurrent_unordered_impl(View view, size_t limit, thread_pool* pool, Fn fn,
+                                     Sink sink) {
+  using result_type = concurrent_result_t<View, Fn>;
+  std::mutex mutex;
+  co_await run_concurrent(std::move(view), limit, pool,
+                          [&](size_t index, auto&& item) -> task<> {
+                            result_type result = co_await fn(item);
+                            std::lock_guard<std::mutex> guard(mutex);
+                            sink(index, std::move(result));
+                          });
+}
+
+}  // namespace detail
+
+// 对 range 的每个元素 co_await fn(item)，同时最多 limit 个在运行，limit 为 0 时抛出 invalid_argument。
+// range 可以是任意 input_range，元素按需取出，不会一次性创建所有协程；
+// 右值 range 被移动进返回的 task，左值 range 只保存引用，需要活到 task 结束。
+// 某个元素抛出异常后不再启动新的元素，等已经开始的都结束后重新抛出第一个异常
+template <std::ranges::viewable_range Range, typename Fn>
+task<> for_each_concurrent(Range&& range, size_t limit, Fn fn) {
+  detail::check_concurrency_limit(limit);
+  return detail::run_concurrent(std::views::all(std::forward<Range>(range)), limit, nullptr,
+                                [fn = std::move(fn)](size_t, auto&& item) mutable {
+                                  return fn(item);
+                                });
+}
+
+// 同上，每个 worker 先切换到 pool 上再开始取元素
+template <std::ranges::viewable_range Range, typename Fn>
+task<> for_each_concurrent(thread_pool& pool, Range&& range, size_t limit, Fn fn) {
+  detail::check_concurrency_limit(limit);
+  return detail::run_concurrent(std::views::all(std::forward<Range>(range)), limit, &pool,
+                                [fn = std::move(fn)](size_t, auto&& item) mutable {
+                                  return fn(item);
+                                });
+}
+
+// 并发度受限的 map，结果按输入顺序返回。所有结果都会缓存在返回的 vector 里，
+// 只需要逐个处理结果时使用 map_concurrent_ordered 或 map_concurrent_unordered
+template <std::ranges::viewable_range Range, typename Fn>
+auto map_concurrent(Range&& range, size_t limit, Fn fn) {
+  detail::check_concurrency_limit(limit);
+  return detail::map_concurrent_impl(std::views::all(std::forward<Range>(range)), limit, nullptr,
+                                     std::move(fn));
+}
+
+template <std::ranges::viewable_range Range, typename Fn>
+auto map_concurrent(thread_pool& pool, Range&& range, size_t limit, Fn fn) {
+  detail::check_concurrency_limit(limit);
+  return detail::map_concurrent_impl(std::views::all(std::forward<Range>(range)), limit, &pool,
+                                     std::move(fn));
+}
+
+// 流式的有序 map：按输入顺序把结果交给 sink(index, result)，sink 的调用是串行的。
+// 最多缓存 limit 个提前完成的结果；某个元素失败后，它之前的结果仍按顺序交出，它之后的结果不再交出
+template <std::ranges::viewable_range Range, typename Fn, typename Sink>
+task<> map_concurrent_ordered(Range&& range, size_t limit, Fn fn, Sink sink) {
+  detail::check_concurrency_limit(limit);
+  return detail::map_concurrent_ordered_impl(std::views::all(std::forward<Range>(range)), limit,
+                                             nullptr, std::move(fn), std::move(sink));
+}
+
+template <std::ranges::viewable_range Range, typename Fn, typename Sink>
+task<> map_concurrent_ordered(thread_pool& pool, Range&& range, size_t limit, Fn fn,
+                              Sink sink) {
+  detail::check_concurrency_limit(limit);
+  return detail::map_concurrent_ordered_impl(std::views::all(std::forward<Range>(range)), limit,
+                                             &pool, std::move(fn), std::move(sink));
+}
+
+// 流式的无序 map：每个结果一完成就交给 sink(index, result)，不缓存结果。
+// sink 的调用是串行的，但顺序是完成顺序，index 是元素在 range 中的位置
+template <std::ranges::viewable_range Range, typename Fn, typename Sink>
+task<> map_concurrent_unordered(Range&& range, size_t limit, Fn fn, Sink sink) {
+  detail::check_concurrency_limit(limit);
+  return detail::map_concurrent_unordered_impl(std::views::all(std::forward<Range>(range)), limit,
+                                               nullptr, std::move(fn), std::move(sink));
+}
+
+template <std::ranges::viewable_range Range, typename Fn, typename Sink>
+task<> map_concurrent_unordered(thread_pool& pool, Range&& range, size_t limit, Fn fn,
+                                Sink sink) {
+  detail::check_concurrency_limit(limit);
+  return detail::map_concurrent_unordered_impl(std::views::all(std::forward<Range>(range)), limit,
+                                               &pool, std::move(fn), std::move(sink));
+}
+
+}  // namespace xcoro
@@ -3,18 +3,18 @@
 #include <atomic>
 #include <coroutine>
 #include <cstdint>
-#include <memory>
 #include <mutex>
-#include <queue>
 #include <utility>
-#include <vector>
 
 #include "xcoro/cancellation_registration.hpp"
 #include "xcoro/cancellation_token.hpp"
+#include "xcoro/executor.hpp"
 #include "xcoro/mutex.hpp"
 
 namespace xcoro {
 
+// 等待节点放在 awaiter 里，组成由 mutex_ 保护的侵入式双向链表，等待不分配内存。
+// 取消时把节点从链表里摘掉，notify 取出的节点不会再被取消回调碰到
 class condition_variable {
  public:
   condition_variable() = default;
@@ -29,16 +29,17 @@ class condition_variable {
       wake_requested,
     };
 
-    std::coroutine_handle<> handle{};
     mutex* associated_mutex{};
-    std::atomic<bool> resumed{false};
-    std::atomic<bool> cancelled{false};
+    // 被唤醒后重新获取互斥量时使用的等待节点，位于 awaiter 中
+    mutex::lock_waiter* relock{};
+    // 以下三个字段在 condition_variable::mutex_ 下访问
+    waiter_state* prev{};
+    waiter_state* next{};
+    bool linked{false};
+    // 在 mutex_ 下摘链后置位，恢复之后由 await_resume 读取
+    bool cancelled{false};
     std::atomic<suspend_state> suspend_phase{suspend_state::waiting_await_suspend};
 
-    bool try_mark_resumed() noexcept {
-      return !resumed.exchange(true, std::memory_order_acq_rel);
-    }
-
     bool try_mark_suspended() noexcept {
       auto expected = suspend_state::waiting_await_suspend;
       return suspend_phase.compare_exchange_strong(expected, suspend_state::suspended,
@@ -55,6 +56,13 @@ class condition_variable {
       }
       return expected == suspend_state::suspended;
     }
+
+    // 节点已经从链表里取出；await_suspend 还没有挂起完成时由它自己去重新加锁
+    void wake() noexcept {
+      if (should_resume_now()) {
+        associated_mutex->lock_and_resume(*relock);
+      }
+    }
   };
 
  public:
@@ -62,6 +70,18 @@ class condition_variable {
     awaiter(condition_variable& cv, mutex& m, cancellation_token token = {}) noexcept
         : cv_(cv), mutex_(m), token_(std::move(token)) {}
 
+    // 只能在开始等待之前移动，此时两个等待节点都还没有被使用
+    awaiter(awaiter&& other) noexcept
+        : cv_(other.cv_), mutex_(other.mutex_), token_(std::move(other.token_)) {}
+
+    ~awaiter() {
+      registration_.deregister();
+      // 协程在等待期间被销毁，节点可能还在链表里
+      if (waiting_) {
+        cv_.remove_waiter(node_);
+      }
+    }
+
     bool await_ready() noexcept {
       if (token_.can_be_cancelled() && token_.is_cancellation_requested()) {
         cancelled_immediate_ = true;
@@ -76,39 +96,33 @@ class condition_variable {
         return false;
       }
 
-      auto state = std::make_shared<waiter_state>();
-      state->handle = handle;
-      state->associated_mutex = &mutex_;
-      cv_.enqueue_waiter(state);
+      node_.associated_mutex = &mutex_;
+      relock_.handle = handle;
+      relock_.executor = current_executor();
+      node_.relock = &relock_;
+      waiting_ = true;
+      cv_.enqueue_waiter(node_);
       mutex_.unlock();
-      state_ = state;
 
       if (token_.can_be_cancelled()) {
-        registration_ = cancellation_registration(
-            token_, [state]() noexcept {
-              if (!state->try_mark_resumed()) {
-                return;
-              }
-              state->cancelled.store(true, std::memory_order_release);
-              if (!state->should_resume_now()) {
-                return;
-              }
-              if (state->associated_mutex) {
-                state->associated_mutex->lock_and_resume(state->handle);
-              }
-            });
+        registration_ = cancellation_registration(token_, [this]() noexcept {
+          if (cv_.remove_waiter(node_, true)) {
+            node_.wake();
+          }
+        });
       }
 
-      if (state->try_mark_suspended()) {
+      if (node_.try_mark_suspended()) {
         return true;
       }
 
-      return mutex_.lock_or_enqueue(handle);
+      return mutex_.lock_or_enqueue(relock_);
     }
 
     void await_resume() {
-      if (cancelled_immediate_ ||
-          (state_ && state_->cancelled.load(std::memory_order_acquire))) {
+      waiting_ = false;
+      registration_.deregister();
+      if (cancelled_immediate_ || node_.cancelled) {
         throw operation_cancelled{};
       }
     }
@@ -118,7 +132,9 @@ class condition_variable {
     mutex& mutex_;
     cancellation_token token_;
     cancellation_registration registration_;
-    std::shared_ptr<waiter_state> state_;
+    waiter_state node_;
+    mutex::lock_waiter relock_;
+    bool waiting_{false};
     bool cancelled_immediate_{false};
   };
 
@@ -128,54 +144,83 @@ class condition_variable {
   }
 
   void notify_one() noexcept {
-    std::shared_ptr<waiter_state> w;
+    waiter_state* w = nullptr;
     {
       std::lock_guard<std::mutex> guard(mutex_);
-      while (!waiters_.empty()) {
-        w = waiters_.front();
-        waiters_.pop();
-        if (!w || !w->try_mark_resumed()) {
-          w.reset();
-          continue;
-        }
-        break;
+      w = head_;
+      if (w != nullptr) {
+        unlink(*w);
       }
     }
 
-    if (w && w->associated_mutex && w->should_resume_now()) {
-      w->associated_mutex->lock_and_resume(w->handle);
+    if (w != nullptr) {
+      w->wake();
     }
   }
 
   void notify_all() noexcept {
-    std::vector<std::shared_ptr<waiter_state>> to_resume;
+    waiter_state* w = nullptr;
     {
       std::lock_guard<std::mutex> guard(mutex_);
-      while (!waiters_.empty()) {
-        auto w = waiters_.front();
-        waiters_.pop();
-        if (!w || !w->try_mark_resumed()) {
-          continue;
-        }
-        to_resume.push_back(std::move(w));
+      w = std::exchange(head_, nullptr);
+      tail_ = nullptr;
+      for (auto* node = w; node != nullptr; node = node->next) {
+        node->linked = false;
       }
     }
 
-    for (auto& w : to_resume) {
-      if (w && w->associated_mutex && w->should_resume_now()) {
-        w->associated_mutex->lock_and_resume(w->handle);
-      }
+    while (w != nullptr) {
+      // 唤醒之后节点所在的 awaiter 随时可能销毁，先取出后继
+      waiter_state* next = w->next;
+      w->wake();
+      w = next;
     }
   }
 
  private:
-  void enqueue_waiter(const std::shared_ptr<waiter_state>& w) noexcept {
+  void enqueue_waiter(waiter_state& w) noexcept {
     std::lock_guard<std::mutex> guard(mutex_);
-    waiters_.push(w);
+    w.prev = tail_;
+    w.next = nullptr;
+    if (tail_ != nullptr) {
+      tail_->next = &w;
+    } else {
+      head_ = &w;
+    }
+    tail_ = &w;
+    w.linked = true;
+  }
+
+  // 节点还在链表里时摘掉并返回 true；已经被 notify 取走时返回 false
+  bool remove_waiter(waiter_state& w, bool cancelled = false) noexcept {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (!w.linked) {
+      return false;
+    }
+    unlink(w);
+    w.cancelled = cancelled;
+    return true;
+  }
+
+  void unlink(waiter_state& w) noexcept {
+    if (w.prev != nullptr) {
+      w.prev->next = w.next;
+    } else {
+      head_ = w.next;
+    }
+    if (w.next != nullptr) {
+      w.next->prev = w.prev;
+    } else {
+      tail_ = w.prev;
+    }
+    w.prev = nullptr;
+    w.next = nullptr;
+    w.linked = false;
   }
 
   std::mutex mutex_;
-  std::queue<std::shared_ptr<waiter_state>> waiters_;
+  waiter_state* head_ = nullptr;
+  waiter_state* tail_ = nullptr;
 };
 
 }  // namespace xcoro
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <concepts>
+#include <coroutine>
+#include <memory>
+#include <utility>
+
+#include "xcoro/awaitable.hpp"
+
+namespace xcoro {
+
+namespace concepts {
+
+// 调度器：既可以通过 co_await schedule() 把当前协程切到自己的线程上，
+// 也可以直接接收一个已经挂起的协程句柄（post），稍后由自己的线程恢复
+template <typename T>
+concept Executor = requires(T& executor, std::coroutine_handle<> handle) {
+  { executor.schedule() } -> Awaitable;
+  { executor.post(handle) } -> std::same_as<bool>;
+};
+
+}  // namespace concepts
+
+// 对某个调度器的非拥有引用，类型擦除后只保留 post 能力
+// I/O 等待在挂起时记录它，完成时把协程投递回原调度器，而不是在 reactor 线程上直接恢复
+class executor_ref {
+ public:
+  executor_ref() noexcept = default;
+
+  template <concepts::Executor Executor>
+  executor_ref(Executor& executor) noexcept
+      : executor_(std::addressof(executor)),
+        post_([](void* self, std::coroutine_handle<> handle) noexcept {
+          return static_cast<Executor*>(self)->post(handle);
+        }) {}
+
+  explicit operator bool() const noexcept { return executor_ != nullptr; }
+
+  // 返回 false 表示没有调度器，或者调度器已经停止接收任务，
+  // 此时调用方需要自己负责恢复协程
+  bool post(std::coroutine_handle<> handle) const noexcept {
+    return executor_ != nullptr && post_(executor_, handle);
+  }
+
+  bool refers_to(const void* executor) const noexcept {
+    return executor_ == executor;
+  }
+
+  friend bool operator==(const executor_ref& lhs, const executor_ref& rhs) noexcept {
+    return lhs.executor_ == rhs.executor_;
+  }
+
+ private:
+  void* executor_ = nullptr;
+  bool (*post_)(void*, std::coroutine_handle<>) noexcept = nullptr;
+};
+
+namespace detail {
+
+inline thread_local executor_ref current_executor_{};
+
+// 标记当前线程正在替某个调度器执行协程，析构时恢复之前的值
+class executor_scope {
+ public:
+  explicit executor_scope(executor_ref executor) noexcept
+      : previous_(std::exchange(current_executor_, executor)) {}
+
+  ~executor_scope() { current_executor_ = previous_; }
+
+  executor_scope(const executor_scope&) = delete;
+  executor_scope& operator=(const executor_scope&) = delete;
+
+ private:
+  executor_ref previous_;
+};
+
+}  // namespace detail
+
+// 当前线程所属的调度器；不在任何调度器线程上时返回空引用
+inline executor_ref current_executor() noexcept {
+  return detail::current_executor_;
+}
+
+}  // namespace xcoro
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+
+#include "xcoro/manual_reset_event.hpp"
+
+namespace xcoro {
+
+// 一次性的倒计数门闩：计数减到 0 时唤醒所有等待者，之后的等待立即返回。
+// count_down 只是一次原子减法，最后一次才会去恢复等待链表上的协程
+class async_latch {
+ public:
+  explicit async_latch(std::ptrdiff_t count) noexcept : count_(count) {
+    assert(count >= 0);
+    if (count <= 0) {
+      event_.set();
+    }
+  }
+
+  async_latch(const async_latch&) = delete;
+  async_latch& operator=(const async_latch&) = delete;
+
+  void count_down(std::ptrdiff_t n = 1) noexcept {
+    const auto old = count_.fetch_sub(n, std::memory_order_acq_rel);
+    assert(old >= n && "async_latch::count_down would go below zero");
+    if (old == n) {
+      event_.set();
+    }
+  }
+
+  bool try_wait() const noexcept { return event_.is_set(); }
+
+  auto operator co_await() const noexcept { return event_.operator co_await(); }
+
+  // 先 count_down(n)，再等待计数归零
+  auto arrive_and_wait(std::ptrdiff_t n = 1) noexcept {
+    count_down(n);
+    return event_.operator co_await();
+  }
+
+ private:
+  std::atomic<std::ptrdiff_t> count_;
+  manual_reset_event event_;
+};
+
+}  // namespace xcoro
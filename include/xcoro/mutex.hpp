@@ -3,64 +3,77 @@
 #include <atomic>
 #include <coroutine>
 #include <cstdint>
-#include <memory>
-#include <mutex>
-#include <queue>
+#include <thread>
 #include <utility>
 
 #include "xcoro/cancellation_registration.hpp"
 #include "xcoro/cancellation_token.hpp"
+#include "xcoro/executor.hpp"
 
 namespace xcoro {
 
 class condition_variable;
 
+// 整个互斥量的状态放在一个原子字里：
+//   kUnlocked        未加锁
+//   kLockedNoWaiters 已加锁，没有新到达的等待者
+//   其它值           已加锁，值是新到达等待者组成的 LIFO 链表头
+// 等待节点放在 awaiter 里，入队只是一次 CAS，不分配内存也不使用系统锁。
+// 持锁者 unlock 时把新到达的链表整体取下并反转，追加到 FIFO 队列 waiters_，
+// 然后把锁直接交给队首等待者，投递回等待者所在的调度器上恢复。
+// 可取消的等待被取消时要把节点从这两段链表里摘掉，awaiter 之后才能随协程销毁；
+// 摘链和 unlock 取队首都在自旋锁 queue_lock_ 下进行，入队和没有等待者的 unlock 不碰它
 class mutex {
  public:
-  mutex() = default;
+  mutex() noexcept = default;
   mutex(const mutex&) = delete;
   mutex& operator=(const mutex&) = delete;
 
   bool try_lock() noexcept {
-    std::lock_guard<std::mutex> guard(mutex_);
-    if (!locked_) {
-      locked_ = true;
-      return true;
-    }
-    return false;
+    auto expected = kUnlocked;
+    return state_.compare_exchange_strong(expected, kLockedNoWaiters, std::memory_order_acquire,
+                                          std::memory_order_relaxed);
   }
 
   void unlock() noexcept {
-    std::coroutine_handle<> next;
-    bool handed_off = false;
-    {
-      std::lock_guard<std::mutex> guard(mutex_);
-      while (!waiters_.empty()) {
-        auto waiter = waiters_.front();
-        waiters_.pop();
-        if (!waiter || !waiter->try_mark_resumed()) {
-          continue;
-        }
-        handed_off = true;
-        if (waiter->should_resume_now()) {
-          next = waiter->handle;
-        }
-        break;
+    // 只有持锁者会让 waiters_ 从空变为非空，这里读到空就一定是空的
+    if (waiters_.load(std::memory_order_relaxed) == nullptr) {
+      auto expected = kLockedNoWaiters;
+      if (state_.compare_exchange_strong(expected, kUnlocked, std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+        return;
       }
+    }
 
-      if (!handed_off) {
-        locked_ = false;
+    lock_queue();
+    lock_waiter* next = waiters_.load(std::memory_order_relaxed);
+    if (next == nullptr) {
+      auto expected = kLockedNoWaiters;
+      if (state_.compare_exchange_strong(expected, kUnlocked, std::memory_order_release,
+                                         std::memory_order_relaxed)) {
+        unlock_queue();
         return;
       }
-    }
 
-    if (next) {
-      next.resume();
+      // 有新的等待者，整体取下 LIFO 链表并反转成 FIFO。
+      // 持有 queue_lock_ 时取消方不会修改 state_，换出来的一定是非空链表
+      auto* waiter =
+          reinterpret_cast<lock_waiter*>(state_.exchange(kLockedNoWaiters, std::memory_order_acquire));
+      do {
+        lock_waiter* following = waiter->next;
+        waiter->next = next;
+        next = waiter;
+        waiter = following;
+      } while (waiter != nullptr);
     }
+    // 被取消的等待者已经在取消时摘掉了，队首一定还在等待
+    waiters_.store(next->next, std::memory_order_relaxed);
+    unlock_queue();
+    grant(*next);
   }
 
  private:
-  struct waiter_state {
+  struct lock_waiter {
     enum class suspend_state : std::uint8_t {
       waiting_await_suspend,
       suspended,
@@ -68,14 +81,14 @@ class mutex {
     };
 
     std::coroutine_handle<> handle{};
-    std::atomic<bool> resumed{false};
-    std::atomic<bool> cancelled{false};
+    executor_ref executor{};
+    lock_waiter* next = nullptr;
+    // 以下字段只用于可取消的等待
+    bool cancellable = false;
+    // 在 queue_lock_ 下摘链后置位，恢复之后由 await_resume 读取
+    bool cancelled = false;
     std::atomic<suspend_state> suspend_phase{suspend_state::waiting_await_suspend};
 
-    bool try_mark_resumed() noexcept {
-      return !resumed.exchange(true, std::memory_order_acq_rel);
-    }
-
     bool try_mark_suspended() noexcept {
       auto expected = suspend_state::waiting_await_suspend;
       return suspend_phase.compare_exchange_strong(expected, suspend_state::suspended,
@@ -99,6 +112,18 @@ class mutex {
     awaiter(mutex& m, cancellation_token token = {}) noexcept
         : mutex_(m), token_(std::move(token)) {}
 
+    // 只能在开始等待之前移动（例如把 awaiter 交给 sync_wait / when_all），此时节点还没有被使用
+    awaiter(awaiter&& other) noexcept : mutex_(other.mutex_), token_(std::move(other.token_)) {}
+    awaiter& operator=(awaiter&&) = delete;
+
+    ~awaiter() {
+      registration_.deregister();
+      // 协程在等待期间被销毁，节点可能还在等待链表里
+      if (waiting_) {
+        mutex_.abandon(node_);
+      }
+    }
+
     bool await_ready() noexcept {
       if (token_.can_be_cancelled() && token_.is_cancellation_requested()) {
         cancelled_immediate_ = true;
@@ -108,40 +133,33 @@ class mutex {
     }
 
     bool await_suspend(std::coroutine_handle<> handle) noexcept {
-      if (token_.can_be_cancelled() && token_.is_cancellation_requested()) {
-        cancelled_immediate_ = true;
-        return false;
+      node_.handle = handle;
+      node_.executor = current_executor();
+      if (!token_.can_be_cancelled()) {
+        // 入队之后 unlock 可能立刻在别的线程恢复本协程，此后不能再访问 awaiter
+        return mutex_.lock_or_enqueue(node_);
       }
 
-      auto state = std::make_shared<waiter_state>();
-      state->handle = handle;
-      if (!mutex_.enqueue_waiter(state)) {
-        return false;  // 不挂起，拿到锁，直接执行
+      if (token_.is_cancellation_requested()) {
+        cancelled_immediate_ = true;
+        return false;
       }
-      state_ = state;
-
-      if (token_.can_be_cancelled()) {
-        registration_ = cancellation_registration(
-            token_, [state]() noexcept {
-              if (!state->try_mark_resumed()) {
-                return;
-              }
-              state->cancelled.store(true, std::memory_order_release);
-              if (!state->should_resume_now()) {
-                return;
-              }
-              if (state->handle) {
-                state->handle.resume();
-              }
-            });
+      node_.cancellable = true;
+      if (!mutex_.lock_or_enqueue(node_)) {
+        return false;
       }
-
-      return state->try_mark_suspended();
+      waiting_ = true;
+      // 先入队再注册：注册时已经请求的取消会立即执行回调，把刚入队的节点摘掉
+      registration_ =
+          cancellation_registration(token_, [this]() noexcept { mutex_.cancel(node_); });
+      // 失败说明 unlock 或取消回调已经先一步处理了这个节点，直接继续执行
+      return node_.try_mark_suspended();
     }
 
     void await_resume() {
-      if (cancelled_immediate_ ||
-          (state_ && state_->cancelled.load(std::memory_order_acquire))) {
+      waiting_ = false;
+      registration_.deregister();
+      if (cancelled_immediate_ || node_.cancelled) {
         throw operation_cancelled{};
       }
     }
@@ -149,8 +167,9 @@ class mutex {
    private:
     mutex& mutex_;
     cancellation_token token_;
+    lock_waiter node_;
     cancellation_registration registration_;
-    std::shared_ptr<waiter_state> state_;
+    bool waiting_{false};
     bool cancelled_immediate_{false};
   };
 
@@ -158,42 +177,126 @@ class mutex {
   auto lock(cancellation_token token) noexcept { return awaiter{*this, std::move(token)}; }
 
  private:
-  bool enqueue_waiter(const std::shared_ptr<waiter_state>& state) noexcept {
-    std::lock_guard<std::mutex> guard(mutex_);
-    if (!locked_) {
-      locked_ = true;
-      return false;
-    }
-    waiters_.push(state);
-    return true;
-  }
+  static constexpr std::uintptr_t kLockedNoWaiters = 0;
+  static constexpr std::uintptr_t kUnlocked = 1;
 
-  bool lock_or_enqueue(std::coroutine_handle<> handle) noexcept {
-    auto state = std::make_shared<waiter_state>();
-    state->handle = handle;
-    {
-      std::lock_guard<std::mutex> guard(mutex_);
-      if (!locked_) {
-        locked_ = true;
-        return false;
+  // 拿到锁返回 false；否则把 waiter 挂到等待链表上返回 true
+  bool lock_or_enqueue(lock_waiter& waiter) noexcept {
+    auto old = state_.load(std::memory_order_relaxed);
+    for (;;) {
+      if (old == kUnlocked) {
+        if (state_.compare_exchange_weak(old, kLockedNoWaiters, std::memory_order_acquire,
+                                         std::memory_order_relaxed)) {
+          return false;
+        }
+        continue;
+      }
+      waiter.next = reinterpret_cast<lock_waiter*>(old);
+      if (state_.compare_exchange_weak(old, reinterpret_cast<std::uintptr_t>(&waiter),
+                                       std::memory_order_release, std::memory_order_relaxed)) {
+        return true;
       }
-      waiters_.push(state);
     }
-    return state->try_mark_suspended();
   }
 
-  void lock_and_resume(std::coroutine_handle<> handle) noexcept {
-    if (lock_or_enqueue(handle)) {
-      return;
+  void lock_and_resume(lock_waiter& waiter) noexcept {
+    if (!lock_or_enqueue(waiter)) {
+      resume(waiter);
     }
-    if (handle) {
+  }
+
+  // 有调度器时投递回等待者所在的调度器，unlock 方不会在自己的线程上执行下一个临界区；
+  // 没有调度器（例如 sync_wait 线程）或调度器已停止时才直接恢复
+  static void resume(lock_waiter& waiter) noexcept {
+    const auto handle = waiter.handle;
+    const executor_ref executor = waiter.executor;
+    if (!executor.post(handle)) {
       handle.resume();
     }
   }
 
-  std::mutex mutex_;
-  bool locked_{false};
-  std::queue<std::shared_ptr<waiter_state>> waiters_;
+  // 节点已经从等待链表中取出。可取消的等待者需要和 await_suspend 握手，
+  // 还没有挂起完成时由它自己继续执行
+  static void grant(lock_waiter& waiter) noexcept {
+    if (!waiter.cancellable || waiter.should_resume_now()) {
+      resume(waiter);
+    }
+  }
+
+  void cancel(lock_waiter& waiter) noexcept {
+    lock_queue();
+    const bool removed = remove_waiter(waiter);
+    if (removed) {
+      waiter.cancelled = true;
+    }
+    unlock_queue();
+    if (removed && waiter.should_resume_now()) {
+      resume(waiter);
+    }
+  }
+
+  void abandon(lock_waiter& waiter) noexcept {
+    lock_queue();
+    (void)remove_waiter(waiter);
+    unlock_queue();
+  }
+
+  // 调用方持有 queue_lock_。节点已经被 unlock 取走（拿到了锁）时返回 false。
+  // LIFO 链表的表头可能被并发入队改变，只有摘表头需要 CAS；表头之后的节点只在持有
+  // queue_lock_ 时才会被修改。取消是慢路径，这里线性查找即可
+  bool remove_waiter(lock_waiter& waiter) noexcept {
+    for (;;) {
+      auto head = state_.load(std::memory_order_acquire);
+      if (head == kUnlocked || head == kLockedNoWaiters) {
+        break;
+      }
+      auto* node = reinterpret_cast<lock_waiter*>(head);
+      if (node == &waiter) {
+        if (state_.compare_exchange_strong(head, reinterpret_cast<std::uintptr_t>(waiter.next),
+                                           std::memory_order_acq_rel,
+                                           std::memory_order_acquire)) {
+          return true;
+        }
+        continue;
+      }
+      for (; node->next != nullptr; node = node->next) {
+        if (node->next == &waiter) {
+          node->next = waiter.next;
+          return true;
+        }
+      }
+      break;
+    }
+
+    lock_waiter* previous = nullptr;
+    for (auto* node = waiters_.load(std::memory_order_relaxed); node != nullptr;
+         previous = node, node = node->next) {
+      if (node == &waiter) {
+        if (previous == nullptr) {
+          waiters_.store(node->next, std::memory_order_relaxed);
+        } else {
+          previous->next = node->next;
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void lock_queue() noexcept {
+    while (queue_lock_.exchange(true, std::memory_order_acquire)) {
+      while (queue_lock_.load(std::memory_order_relaxed)) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  void unlock_queue() noexcept { queue_lock_.store(false, std::memory_order_release); }
+
+  std::atomic<std::uintptr_t> state_{kUnlocked};
+  // 已经反转成 FIFO 的等待者，在 queue_lock_ 下修改
+  std::atomic<lock_waiter*> waiters_{nullptr};
+  std::atomic<bool> queue_lock_{false};
 
   friend class condition_variable;
 };
@@ -2,6 +2,7 @@
 
 #include <sys/socket.h>
 
+#include <span>
 #include <stdexcept>
 #include <system_error>
 
@@ -26,6 +27,15 @@ class acceptor {
 
   static acceptor listen(io_context& ctx, const endpoint& ep,
                          listen_options options = {}) {
+    // AF_UNIX 地址监听流式本地 socket；地址复用选项只对 TCP 有意义，
+    // 路径地址对应的文件已存在时 bind 失败，需要调用方先 unlink
+    if (ep.is_unix()) {
+      auto listen_socket = socket::open_unix(ctx, SOCK_STREAM);
+      listen_socket.bind(ep);
+      listen_socket.listen(options.backlog);
+      return acceptor{ctx, std::move(listen_socket)};
+    }
+
     auto listen_socket = socket::open_tcp(ctx, ep.family());
     if (options.reuse_address) {
       listen_socket.set_reuse_address(true);
@@ -60,7 +70,7 @@ class acceptor {
           socket_.native_handle(), reinterpret_cast<sockaddr*>(&storage),
           &length);
       if (fd >= 0) {
-        co_return socket{ctx(), fd};
+        co_return socket::adopt(ctx(), fd);
       }
       if (errno == EINTR) {
         continue;
@@ -73,6 +83,48 @@ class acceptor {
     }
   }
 
+  // 一次就绪事件内尽量把 backlog 里排队的连接都取出来，最多填满 out。
+  // 至少接入一个连接才返回，返回值是写入 out 前缀的 socket 数量；
+  // 已经接入连接之后遇到的错误不抛出，留给下一次调用处理
+  task<size_t> async_accept_batch(std::span<socket> out,
+                                  cancellation_token token = {}) {
+    size_t accepted = 0;
+    while (accepted < out.size()) {
+      if (accepted == 0) {
+        throw_if_cancellation_requested(token);
+      }
+
+      const int fd = detail::accept_nonblocking(socket_.native_handle(),
+                                                nullptr, nullptr);
+      if (fd >= 0) {
+        // adopt 失败时已经关闭了 fd，这个连接只能丢弃；
+        // 已经接入的连接在 out 里，照常返回，错误留给下一次调用
+        try {
+          out[accepted] = socket::adopt(ctx(), fd);
+        } catch (...) {
+          if (accepted > 0) {
+            break;
+          }
+          throw;
+        }
+        ++accepted;
+        continue;
+      }
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      if (accepted > 0) {
+        break;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await ctx().wait_readable(socket_.descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "accept failed");
+    }
+    co_return accepted;
+  }
+
  private:
   io_context& ctx() {
     if (ctx_ == nullptr) {
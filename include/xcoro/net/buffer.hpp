@@ -45,6 +45,21 @@ class byte_buffer {
     return readable_regions()[0];
   }
 
+  // 以缓冲区序列的形式返回可读数据，可以直接交给 socket 的分散写接口一次发出
+  std::array<const_buffer, 2> readable_buffers() const noexcept {
+    const auto regions = readable_regions();
+    return {const_buffer{regions[0]}, const_buffer{regions[1]}};
+  }
+
+  // 把回绕的可读数据搬到存储开头，返回覆盖全部可读数据的连续区域；
+  // 没有回绕时不移动任何数据
+  std::span<const std::byte> make_contiguous() {
+    if (read_index_ + size_ > capacity()) {
+      linearize();
+    }
+    return readable_regions()[0];
+  }
+
   // 兼容旧接口，保留 data() 但明确它只返回第一段连续可读区域。
   std::span<const std::byte> data() const noexcept {
     return contiguous_readable_region();
@@ -75,6 +90,13 @@ class byte_buffer {
             std::span<std::byte>(storage_.data(), second_length)};
   }
 
+  // 以缓冲区序列的形式返回可写空间，交给 socket 的分散读接口后再 commit 实际读到的字节数
+  std::array<mutable_buffer, 2> writable_buffers(
+      size_t max_bytes = std::numeric_limits<size_t>::max()) {
+    const auto regions = writable_regions(max_bytes);
+    return {mutable_buffer{regions[0]}, mutable_buffer{regions[1]}};
+  }
+
   // 兼容旧接口。
   std::array<std::span<std::byte>, 2> prepare_regions(
       size_t n = std::numeric_limits<size_t>::max()) {
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "xcoro/cancellation_token.hpp"
+#include "xcoro/net/buffer.hpp"
+#include "xcoro/net/detail/byte_scan.hpp"
+#include "xcoro/task.hpp"
+
+namespace xcoro::net {
+
+// 在一个支持 async_read_some(mutable_buffer, token) 的流（通常是 socket）上加一层读缓冲。
+// 查找分隔符时记录已经扫描过的位置，新数据到达后只扫描新增的部分，
+// 不会在每次部分读取后重新扫描整个缓冲区
+template <typename Stream>
+class buffered_stream {
+ public:
+  static constexpr size_t kDefaultReadSize = 4096;
+  // 默认上限：对端一直不发送分隔符时缓冲区不会无限增长，超过后抛出 std::length_error。
+  // 需要更长的行或头部时显式传入更大的值，确实不需要上限时传入 kUnlimited
+  static constexpr size_t kDefaultMaxBufferSize = 64 * 1024;
+  static constexpr size_t kUnlimited = std::numeric_limits<size_t>::max();
+
+  explicit buffered_stream(Stream stream, size_t max_buffer_size = kDefaultMaxBufferSize,
+                           size_t read_size = kDefaultReadSize)
+      : stream_(std::move(stream)),
+        buffer_(read_size),
+        max_buffer_size_(max_buffer_size),
+        read_size_(std::max<size_t>(read_size, 1)) {}
+
+  Stream& next_layer() noexcept { return stream_; }
+  const Stream& next_layer() const noexcept { return stream_; }
+
+  // 当前已缓冲但还没有被消费的数据，总是一段连续内存
+  std::span<const std::byte> buffered() { return buffer_.make_contiguous(); }
+  size_t buffered_size() const noexcept { return buffer_.size(); }
+
+  void consume(size_t n) noexcept { buffer_.consume(std::min(n, buffer_.size())); }
+
+  // 读取直到缓冲区中出现 delimiter，返回包含分隔符在内的长度，数据仍留在缓冲区中，
+  // 调用方通过 buffered() 取用后再 consume。对端关闭时仍未找到分隔符则返回 0
+  task<size_t> async_read_until(std::string_view delimiter,
+                                cancellation_token token = {}) {
+    if (delimiter.empty()) {
+      throw std::invalid_argument("buffered_stream delimiter must not be empty");
+    }
+
+    const auto needle = std::as_bytes(std::span{delimiter});
+    size_t scanned = 0;
+    for (;;) {
+      // 直接扫描环形缓冲区的两段，数据回绕时也不搬动
+      // 分隔符可能横跨上次扫描的末尾，回退 size - 1 个字节重新比较
+      const size_t start = scanned >= needle.size() - 1 ? scanned - (needle.size() - 1) : 0;
+      const size_t hit = detail::find_sequence(buffer_.readable_regions(), start, needle);
+      if (hit != detail::npos) {
+        co_return hit + needle.size();
+      }
+      scanned = buffer_.size();
+
+      const size_t read = co_await fill(token);
+      if (read == 0) {
+        co_return 0;
+      }
+    }
+  }
+
+  task<size_t> async_read_until(char delimiter, cancellation_token token = {}) {
+    const char delimiters[1] = {delimiter};
+    co_return co_await async_read_until(std::string_view{delimiters, 1}, std::move(token));
+  }
+
+  // 读取一行并从缓冲区中移除，返回值不含行尾的 "\n" 或 "\r\n"；
+  // 对端关闭且没有完整的一行时返回 std::nullopt，残留数据仍可通过 buffered() 取得
+  task<std::optional<std::string>> async_read_line(cancellation_token token = {}) {
+    const size_t length = co_await async_read_until('\n', std::move(token));
+    if (length == 0) {
+      co_return std::nullopt;
+    }
+
+    // 从两段可读区域直接拷出这一行，不为了取一行把整个缓冲区搬成连续的
+    std::string line(length - 1, '\0');
+    size_t copied = 0;
+    for (const auto region : buffer_.readable_regions()) {
+      const size_t n = std::min(region.size(), line.size() - copied);
+      std::memcpy(line.data() + copied, region.data(), n);
+      copied += n;
+    }
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    consume(length);
+    co_return line;
+  }
+
+  // 确保缓冲区中至少有 n 个字节（或对端已关闭），返回缓冲的数据但不消费
+  task<std::span<const std::byte>> async_peek(size_t n, cancellation_token token = {}) {
+    while (buffer_.size() < n) {
+      const size_t read = co_await fill(token);
+      if (read == 0) {
+        break;
+      }
+    }
+    co_return buffered();
+  }
+
+  // 优先返回已缓冲的数据，缓冲区为空时才去读底层流
+  task<size_t> async_read_some(mutable_buffer dst, cancellation_token token = {}) {
+    if (dst.bytes.empty()) {
+      co_return 0;
+    }
+    if (buffer_.empty()) {
+      // 请求足够大时直接读进调用方的缓冲区，省掉一次拷贝
+      if (dst.bytes.size() >= read_size_) {
+        co_return co_await stream_.async_read_some(dst, std::move(token));
+      }
+      const size_t read = co_await fill(token);
+      if (read == 0) {
+        co_return 0;
+      }
+    }
+
+    const auto data = buffered();
+    const size_t n = std::min(data.size(), dst.bytes.size());
+    std::memcpy(dst.bytes.data(), data.data(), n);
+    consume(n);
+    co_return n;
+  }
+
+ private:
+  // 从底层流读一次追加到缓冲区尾部，返回读到的字节数，0 表示对端已关闭
+  task<size_t> fill(cancellation_token& token) {
+    if (buffer_.size() >= max_buffer_size_) {
+      throw std::length_error("buffered_stream exceeded max buffer size");
+    }
+
+    // 只读进第一段可写区域：尾部空间不够时不为了凑出连续空间而搬动已有数据，
+    // 剩下的部分下次从缓冲区开头继续写
+    const size_t want = std::min(read_size_, max_buffer_size_ - buffer_.size());
+    const auto space = buffer_.writable_regions(want)[0];
+    const size_t n = co_await stream_.async_read_some(mutable_buffer{space}, token);
+    buffer_.commit(n);
+    co_return n;
+  }
+
+  Stream stream_;
+  byte_buffer buffer_;
+  size_t max_buffer_size_;
+  size_t read_size_;
+};
+
+}  // namespace xcoro::net
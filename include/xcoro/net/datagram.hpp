@@ -0,0 +1,52 @@
+#pragma once
+
+#include <netinet/in.h>
+#include <netinet/udp.h>
+
+#include <cstddef>
+
+#include "xcoro/net/buffer.hpp"
+#include "xcoro/net/endpoint.hpp"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace xcoro::net {
+
+// 批量接收的一个槽位：buffer 由调用方提供，其余字段由 async_recv_batch 填写
+struct datagram {
+  mutable_buffer buffer;
+  // 发送方地址
+  endpoint peer{};
+  // 实际收到的字节数
+  size_t size = 0;
+  // 开启 UDP_GRO 时内核可能把多个同源数据报合并成一次交付，
+  // 此时 buffer 中是若干个 segment_size 大小的数据报首尾相接（最后一个可以更短）；0 表示未合并
+  size_t segment_size = 0;
+  // 数据报比 buffer 大，超出部分被丢弃
+  bool truncated = false;
+  // 辅助数据（UDP_GRO 以及调用方自己开启的 IP_PKTINFO、时间戳等）超出了预留空间被截断（MSG_CTRUNC）。
+  // 此时 segment_size 可能缺失，开启 GRO 的调用方不能再按它拆分 buffer
+  bool control_truncated = false;
+};
+
+// 内核一次 GSO 发送最多切出的数据报数（UDP_MAX_SEGMENTS）。较早的内核是 64，之后提高到了 128，
+// 这里按较小的值检查，保证在所有支持 UDP_SEGMENT 的内核上都不会因此被拒绝
+inline constexpr size_t kMaxGsoSegments = 64;
+
+// 批量发送的一条消息
+struct outgoing_datagram {
+  const_buffer buffer;
+  // 目标地址；未设置（size() == 0）时发往 connect 过的对端
+  endpoint peer;
+  // 非 0 时使用 UDP_SEGMENT（GSO）把 buffer 按该大小切成多个数据报，由内核/网卡完成切分。
+  // 不能超过 65535，切出的数据报不能超过 kMaxGsoSegments 个，否则 async_send_batch 抛出 invalid_argument
+  size_t segment_size = 0;
+};
+
+}  // namespace xcoro::net
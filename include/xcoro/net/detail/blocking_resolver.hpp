@@ -41,6 +41,7 @@ class blocking_resolver {
   struct resolve_job {
     io_context* ctx = nullptr;
     std::coroutine_handle<> handle{};
+    executor_ref executor{};
     resolve_request request;
     std::function<std::vector<endpoint>(const resolve_request&)> resolve_fn;
     cancellation_registration registration{};
@@ -127,16 +128,16 @@ class blocking_resolver {
         continue;
       }
 
-      std::coroutine_handle<> handle;
+      completion done;
       io_context* ctx = nullptr;
       {
         std::lock_guard lock(job->mutex);
-        handle = job->handle;
+        done = completion{job->handle, job->executor};
         ctx = job->ctx;
       }
 
-      if (ctx != nullptr && handle) {
-        io_context_access::enqueue_ready(*ctx, handle);
+      if (ctx != nullptr && done) {
+        io_context_access::post_completion(*ctx, done);
         io_context_access::wake(*ctx);
       }
     }
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <span>
+
+#include "xcoro/net/buffer.hpp"
+
+namespace xcoro::net::detail {
+
+// 单次 readv/writev 最多提交的 iovec 数量，放在协程帧里即可，不需要堆分配
+inline constexpr size_t kMaxIovecs = 64;
+
+inline void* iovec_base(const mutable_buffer& buffer) noexcept {
+  return buffer.bytes.data();
+}
+
+inline void* iovec_base(const const_buffer& buffer) noexcept {
+  // iovec::iov_base 不带 const，写路径上内核只会读取这块内存
+  return const_cast<std::byte*>(buffer.bytes.data());
+}
+
+// 在一组缓冲区上记录已经传输到的位置，每次把剩余部分展开成 iovec 数组，
+// 部分读写之后调用 advance 跳过已经完成的字节
+template <typename Buffer>
+class buffer_cursor {
+ public:
+  explicit buffer_cursor(std::span<const Buffer> buffers) noexcept
+      : buffers_(buffers) {
+    skip_empty();
+  }
+
+  bool empty() const noexcept { return index_ == buffers_.size(); }
+
+  size_t fill(iovec* out, size_t max_count) const noexcept {
+    size_t count = 0;
+    size_t offset = offset_;
+    for (size_t i = index_; i < buffers_.size() && count < max_count; ++i) {
+      const auto& bytes = buffers_[i].bytes;
+      if (bytes.size() > offset) {
+        out[count].iov_base = static_cast<std::byte*>(iovec_base(buffers_[i])) + offset;
+        out[count].iov_len = bytes.size() - offset;
+        ++count;
+      }
+      offset = 0;
+    }
+    return count;
+  }
+
+  void advance(size_t n) noexcept {
+    while (n > 0 && index_ < buffers_.size()) {
+      const size_t remaining = buffers_[index_].bytes.size() - offset_;
+      if (n < remaining) {
+        offset_ += n;
+        return;
+      }
+      n -= remaining;
+      ++index_;
+      offset_ = 0;
+    }
+    skip_empty();
+  }
+
+ private:
+  void skip_empty() noexcept {
+    while (index_ < buffers_.size() && buffers_[index_].bytes.size() == offset_) {
+      ++index_;
+      offset_ = 0;
+    }
+  }
+
+  std::span<const Buffer> buffers_;
+  size_t index_ = 0;
+  size_t offset_ = 0;
+};
+
+}  // namespace xcoro::net::detail
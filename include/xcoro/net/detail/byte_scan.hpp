@@ -0,0 +1,81 @@
+#pragma once
+
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <span>
+
+namespace xcoro::net::detail {
+
+inline constexpr size_t npos = static_cast<size_t>(-1);
+
+// 在 [data, data + size) 中查找第一个等于 value 的字节，返回下标，找不到返回 npos。
+// 直接使用 memchr：glibc 在运行时按 CPU 选择 SSE2/AVX2/EVEX 实现，不依赖编译时的 -m 选项
+inline size_t find_byte(const std::byte* data, size_t size, std::byte value) noexcept {
+  if (size == 0) {
+    return npos;
+  }
+  const void* hit = std::memchr(data, static_cast<int>(value), size);
+  return hit == nullptr ? npos : static_cast<size_t>(static_cast<const std::byte*>(hit) - data);
+}
+
+// 查找多字节分隔符，同样交给 glibc 按 CPU 分派的 memmem
+inline size_t find_sequence(std::span<const std::byte> haystack,
+                            std::span<const std::byte> needle) noexcept {
+  if (needle.empty()) {
+    return 0;
+  }
+  if (needle.size() == 1) {
+    return find_byte(haystack.data(), haystack.size(), needle.front());
+  }
+  if (haystack.size() < needle.size()) {
+    return npos;
+  }
+  const void* hit = ::memmem(haystack.data(), haystack.size(), needle.data(), needle.size());
+  return hit == nullptr
+             ? npos
+             : static_cast<size_t>(static_cast<const std::byte*>(hit) - haystack.data());
+}
+
+// 在环形缓冲区的两段可读区域（逻辑上首尾相接）中，从逻辑位置 start 开始查找 needle，
+// 返回逻辑下标。不需要先把回绕的数据搬成一段：两段分别查找，横跨接缝的匹配单独比较
+inline size_t find_sequence(const std::array<std::span<const std::byte>, 2>& regions,
+                            size_t start, std::span<const std::byte> needle) noexcept {
+  const auto first = regions[0];
+  const auto second = regions[1];
+  if (start < first.size()) {
+    const size_t hit = find_sequence(first.subspan(start), needle);
+    if (hit != npos) {
+      return start + hit;
+    }
+  }
+
+  if (second.empty()) {
+    return npos;
+  }
+  // 起点落在第一段末尾 needle.size() - 1 个字节内的匹配横跨接缝
+  const size_t seam_begin =
+      std::max(start, first.size() - std::min(first.size(), needle.size() - 1));
+  for (size_t candidate = seam_begin; candidate < first.size(); ++candidate) {
+    const size_t head = first.size() - candidate;
+    if (needle.size() - head > second.size()) {
+      break;
+    }
+    if (std::memcmp(first.data() + candidate, needle.data(), head) == 0 &&
+        std::memcmp(second.data(), needle.data() + head, needle.size() - head) == 0) {
+      return candidate;
+    }
+  }
+
+  const size_t offset = start > first.size() ? start - first.size() : 0;
+  if (offset >= second.size()) {
+    return npos;
+  }
+  const size_t hit = find_sequence(second.subspan(offset), needle);
+  return hit == npos ? npos : first.size() + offset + hit;
+}
+
+}  // namespace xcoro::net::detail
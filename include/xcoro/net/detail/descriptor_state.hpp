@@ -1,8 +1,7 @@
 #pragma once
 
+#include <atomic>
 #include <cstdint>
-#include <memory>
-#include <mutex>
 
 #include "xcoro/net/detail/operation_state.hpp"
 
@@ -17,30 +16,44 @@ namespace xcoro::net::detail {
 enum class wait_kind {
   read,
   write,
+  // 等待 socket 错误队列中出现消息（EPOLLERR），用于接收 MSG_ZEROCOPY 的完成通知
+  error,
 };
 
+// 某个方向上的等待槽，用一个原子字同时表示三种状态：
+// - kIdle：没有等待者，也没有未消费的就绪事件
+// - kReady：事件先于等待者到达，下一个等待者不挂起，直接重试系统调用
+// - 其他值：正在等待的 wait_operation_state*
+// 挂起、完成、取消都通过 CAS 争夺这个字，谁把指针换出来谁负责恢复协程
 struct waiter_slot {
-  wait_operation_state* operation = nullptr;
+  static constexpr std::uintptr_t kIdle = 0;
+  static constexpr std::uintptr_t kReady = 1;
+
+  std::atomic<std::uintptr_t> state{kIdle};
 };
 
 struct descriptor_state {
   io_context* ctx = nullptr;
   int fd = -1;
 
-  mutable std::mutex mutex;
-  uint32_t registered_events = 0;
-  bool registered_with_epoll = false;
-  bool closing = false;
+  // fd 第一次等待时以边沿触发方式加入 epoll，之后直到关闭都不再 epoll_ctl
+  std::atomic_bool registered{false};
+  std::atomic_bool closing{false};
+  // true 时等待完成后直接在事件循环线程上恢复协程，不投递回等待方所在的调度器
+  bool resume_inline = false;
 
   waiter_slot read_waiter;
   waiter_slot write_waiter;
-};
+  waiter_slot error_waiter;
 
-inline std::shared_ptr<descriptor_state> make_descriptor_state(io_context& ctx, int fd) {
-  auto state = std::make_shared<descriptor_state>();
-  state->ctx = &ctx;
-  state->fd = fd;
-  return state;
-}
+  // MSG_ZEROCOPY 状态，只由持有写方向的协程访问：
+  // 下一次零拷贝发送的序号，以及已经收到完成通知的发送次数
+  bool zerocopy = false;
+  std::uint32_t zerocopy_next = 0;
+  std::uint32_t zerocopy_completed = 0;
+
+  // 由 descriptor_table 管理：该槽位当前是否被某个 socket 占用
+  std::atomic_bool in_use{false};
+};
 
 }  // namespace xcoro::net::detail
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+#include "xcoro/net/detail/descriptor_state.hpp"
+
+namespace xcoro::net {
+
+class io_context;
+
+}  // namespace xcoro::net
+
+namespace xcoro::net::detail {
+
+// 每个io_context一张按fd下标索引的descriptor_state表。
+// fd由内核分配且总是取最小可用值，天然稠密，所以直接用fd做下标：
+// - 按块（chunk）分配，块只在第一次用到时创建，之后永不释放，状态地址稳定，
+//   epoll_event.data.ptr 可以直接指向它
+// - socket关闭后槽位被重置并留给下一个复用同一fd的连接，
+//   短连接场景下不再有每连接一次的malloc和锁对象构造
+class descriptor_table {
+ public:
+  static constexpr size_t kChunkSize = 1024;
+  static constexpr size_t kMaxChunks = 4096;
+
+  descriptor_table() = default;
+
+  ~descriptor_table() {
+    for (auto& slot : chunks_) {
+      delete slot.load(std::memory_order_acquire);
+    }
+  }
+
+  descriptor_table(const descriptor_table&) = delete;
+  descriptor_table& operator=(const descriptor_table&) = delete;
+
+  // 为fd占用一个槽位，同一个fd同时只能被一个socket持有
+  descriptor_state& acquire(io_context& ctx, int fd) {
+    if (fd < 0) {
+      throw std::system_error(EBADF, std::system_category(),
+                              "invalid descriptor");
+    }
+
+    const auto index = static_cast<size_t>(fd);
+    if (index / kChunkSize >= kMaxChunks) {
+      throw std::system_error(EMFILE, std::system_category(),
+                              "descriptor table exhausted");
+    }
+
+    auto& state = chunk_for(index / kChunkSize).states[index % kChunkSize];
+    if (state.in_use.exchange(true, std::memory_order_acq_rel)) {
+      throw std::logic_error("descriptor is already owned by another socket");
+    }
+
+    state.ctx = &ctx;
+    state.fd = fd;
+    state.resume_inline = false;
+    state.read_waiter.state.store(waiter_slot::kIdle, std::memory_order_relaxed);
+    state.write_waiter.state.store(waiter_slot::kIdle, std::memory_order_relaxed);
+    state.error_waiter.state.store(waiter_slot::kIdle, std::memory_order_relaxed);
+    state.zerocopy = false;
+    state.zerocopy_next = 0;
+    state.zerocopy_completed = 0;
+    state.registered.store(false, std::memory_order_relaxed);
+    state.closing.store(false, std::memory_order_release);
+    return state;
+  }
+
+  // 调用前需要先从reactor注销，并且还没有::close(fd)，
+  // 这样内核不会在槽位重置完成之前把同一个fd号分配出去
+  void release(descriptor_state& state) noexcept {
+    state.fd = -1;
+    state.registered.store(false, std::memory_order_relaxed);
+    state.in_use.store(false, std::memory_order_release);
+  }
+
+ private:
+  struct chunk {
+    std::array<descriptor_state, kChunkSize> states;
+  };
+
+  chunk& chunk_for(size_t index) {
+    chunk* current = chunks_[index].load(std::memory_order_acquire);
+    if (current != nullptr) {
+      return *current;
+    }
+
+    std::lock_guard lock(grow_mutex_);
+    current = chunks_[index].load(std::memory_order_relaxed);
+    if (current == nullptr) {
+      current = new chunk{};
+      chunks_[index].store(current, std::memory_order_release);
+    }
+    return *current;
+  }
+
+  std::array<std::atomic<chunk*>, kMaxChunks> chunks_{};
+  std::mutex grow_mutex_;  // 只在分配新块时使用
+};
+
+}  // namespace xcoro::net::detail
@@ -11,7 +11,6 @@
 #include <stdexcept>
 #include <system_error>
 #include <utility>
-#include <vector>
 
 #include "xcoro/cancellation_token.hpp"
 #include "xcoro/net/detail/descriptor_state.hpp"
@@ -80,28 +79,22 @@ class epoll_reactor {
   }
 
   // 将一个等待操作装配到系统中，准备在条件满足时触发
+  // executor 非空时，完成后协程会被投递回该调度器，而不是在事件循环线程上恢复
+  // 返回 false 表示不需要挂起：fd已关闭、已取消，或者就绪事件已经先到达
   bool arm_wait(descriptor_state& state, wait_kind kind, wait_operation_state& operation,
-                std::coroutine_handle<> handle,
+                std::coroutine_handle<> handle, executor_ref executor,
                 cancellation_token token) {
-    std::lock_guard lock(state.mutex);
+    operation.reset(handle, executor);
 
-    if (state.fd == -1 || state.closing) {
-      operation.reset(handle);
-      operation.error.store(EBADF, std::memory_order_release);
-      operation.completed.store(true, std::memory_order_release);
+    if (state.fd == -1 || state.closing.load()) {
+      finish_inline(operation, false, EBADF);
       return false;
     }
 
-    auto& slot = slot_for(state, kind);
-    if (slot.operation != nullptr) {
-      throw std::logic_error(
-          "concurrent waits on the same descriptor direction are not allowed");
-    }
-
-    operation.reset(handle);
-    slot.operation = &operation;
-    update_interest_locked(state);
+    ensure_registered(state);
 
+    // 先注册取消回调再装入等待槽：回调只会 CAS 自己的指针，
+    // 在装入之前触发的取消由下面对 token 的再次检查兜底
     if (token.can_be_cancelled()) {
       operation.registration =
           cancellation_registration(token, [this, &state, kind, &operation]() noexcept {
@@ -109,67 +102,86 @@ class epoll_reactor {
           });
     }
 
+    auto& slot = slot_for(state, kind);
+    const auto self = reinterpret_cast<std::uintptr_t>(&operation);
+    std::uintptr_t expected = slot.state.load(std::memory_order_acquire);
+    for (;;) {
+      if (expected == waiter_slot::kReady) {
+        // 事件已经先到达，消费掉这次就绪，让调用方直接重试系统调用
+        if (slot.state.compare_exchange_weak(expected, waiter_slot::kIdle)) {
+          finish_inline(operation, false, 0);
+          return false;
+        }
+        continue;
+      }
+
+      if (expected != waiter_slot::kIdle) {
+        operation.registration = {};
+        throw std::logic_error(
+            "concurrent waits on the same descriptor direction are not allowed");
+      }
+
+      if (slot.state.compare_exchange_weak(expected, self)) {
+        break;
+      }
+    }
+
+    // 从这里开始，operation 可能已经被事件循环或取消回调完成并恢复，
+    // 只有重新把自己从槽里换出来之后才可以再访问它
+    if (state.closing.load() || token.is_cancellation_requested()) {
+      std::uintptr_t installed = self;
+      if (slot.state.compare_exchange_strong(installed, waiter_slot::kIdle)) {
+        const bool cancelled = !state.closing.load();
+        finish_inline(operation, cancelled, cancelled ? 0 : EBADF);
+        return false;
+      }
+    }
+
     return true;
   }
 
   void cancel_wait(descriptor_state& state, wait_kind kind,
                    wait_operation_state& operation) noexcept {
-    std::coroutine_handle<> handle;
-    {
-      std::lock_guard lock(state.mutex);
-      auto& slot = slot_for(state, kind);
-      if (slot.operation != &operation) {
-        return;
-      }
-
-      slot.operation = nullptr;
-      update_interest_locked(state);
-      complete_operation_locked(operation, true, 0, handle);
+    if (!try_retract(slot_for(state, kind), operation)) {
+      return;
     }
 
-    if (handle) {
-      io_context_access::enqueue_ready(*ctx_, handle);
-      io_context_access::wake(*ctx_);
+    const completion done = complete_operation(operation, true, 0);
+    io_context_access::post_completion(*ctx_, done);
+    io_context_access::wake(*ctx_);
+  }
+
+  // awaiter 在协程销毁等场景下提前析构时调用：只撤回等待，不再恢复协程
+  void abandon_wait(descriptor_state& state, wait_kind kind,
+                    wait_operation_state& operation) noexcept {
+    if (try_retract(slot_for(state, kind), operation)) {
+      operation.registration = {};
+      operation.completed.store(true, std::memory_order_release);
     }
   }
 
   void unregister_descriptor(descriptor_state& state,
                              int error = EBADF) noexcept {
-    std::vector<std::coroutine_handle<>> ready;
-    {
-      std::lock_guard lock(state.mutex);
-      state.closing = true;
+    state.closing.store(true);
 
-      if (state.registered_with_epoll && state.fd != -1) {
-        (void)::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, state.fd, nullptr);
-      }
-
-      state.registered_with_epoll = false;
-      state.registered_events = 0;
+    if (state.registered.exchange(false) && state.fd != -1) {
+      (void)::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, state.fd, nullptr);
+    }
 
-      if (state.read_waiter.operation != nullptr) {
-        auto* operation = std::exchange(state.read_waiter.operation, nullptr);
-        std::coroutine_handle<> handle;
-        complete_operation_locked(*operation, false, error, handle);
-        if (handle) {
-          ready.push_back(handle);
-        }
+    bool resumed = false;
+    for (auto* slot : {&state.read_waiter, &state.write_waiter, &state.error_waiter}) {
+      const std::uintptr_t previous = slot->state.exchange(waiter_slot::kIdle);
+      if (previous == waiter_slot::kIdle || previous == waiter_slot::kReady) {
+        continue;
       }
 
-      if (state.write_waiter.operation != nullptr) {
-        auto* operation = std::exchange(state.write_waiter.operation, nullptr);
-        std::coroutine_handle<> handle;
-        complete_operation_locked(*operation, false, error, handle);
-        if (handle) {
-          ready.push_back(handle);
-        }
-      }
+      auto* operation = reinterpret_cast<wait_operation_state*>(previous);
+      io_context_access::post_completion(*ctx_,
+                                         complete_operation(*operation, false, error));
+      resumed = true;
     }
 
-    for (auto handle : ready) {
-      io_context_access::enqueue_ready(*ctx_, handle);
-    }
-    if (!ready.empty()) {
+    if (resumed) {
       io_context_access::wake(*ctx_);
     }
   }
@@ -202,108 +214,117 @@ class epoll_reactor {
 
  private:
   static waiter_slot& slot_for(descriptor_state& state, wait_kind kind) noexcept {
-    return kind == wait_kind::read ? state.read_waiter : state.write_waiter;
+    switch (kind) {
+      case wait_kind::read:
+        return state.read_waiter;
+      case wait_kind::write:
+        return state.write_waiter;
+      case wait_kind::error:
+        break;
+    }
+    return state.error_waiter;
+  }
+
+  static bool try_retract(waiter_slot& slot, wait_operation_state& operation) noexcept {
+    std::uintptr_t expected = reinterpret_cast<std::uintptr_t>(&operation);
+    return slot.state.compare_exchange_strong(expected, waiter_slot::kIdle);
   }
 
-  static void complete_operation_locked(wait_operation_state& operation,
-                                        bool cancelled, int error,
-                                        std::coroutine_handle<>& ready) noexcept {
+  // 调用方已经通过 CAS 独占了 operation
+  static completion complete_operation(wait_operation_state& operation,
+                                       bool cancelled, int error) noexcept {
     operation.registration = {};
     operation.cancelled.store(cancelled, std::memory_order_release);
     operation.error.store(error, std::memory_order_release);
 
-    if (!operation.completed.exchange(true, std::memory_order_acq_rel)) {
-      ready = operation.handle;
-    }
+    // completed 置位之后 awaiter 随时可能被销毁，需要先把恢复目标拷出来
+    const completion done{operation.handle, operation.executor};
+    operation.completed.store(true, std::memory_order_release);
+    return done;
   }
 
-  void update_interest_locked(descriptor_state& state) {
-    uint32_t desired = 0;
-    if (state.read_waiter.operation != nullptr) {
-      desired |= EPOLLIN | EPOLLRDHUP | EPOLLERR | EPOLLHUP;
-    }
-    if (state.write_waiter.operation != nullptr) {
-      desired |= EPOLLOUT | EPOLLERR | EPOLLHUP;
-    }
-
-    if (desired == 0) {
-      if (state.registered_with_epoll && state.fd != -1) {
-        (void)::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, state.fd, nullptr);
-      }
-      state.registered_with_epoll = false;
-      state.registered_events = 0;
-      return;
-    }
+  // await_suspend 返回 false 的路径：协程没有挂起，由 await_resume 直接读取结果
+  static void finish_inline(wait_operation_state& operation, bool cancelled,
+                            int error) noexcept {
+    operation.registration = {};
+    operation.cancelled.store(cancelled, std::memory_order_release);
+    operation.error.store(error, std::memory_order_release);
+    operation.completed.store(true, std::memory_order_release);
+  }
 
-    if (state.registered_with_epoll && state.registered_events == desired) {
+  // 边沿触发只注册一次，读写两个方向共用，后续等待不再调用 epoll_ctl
+  void ensure_registered(descriptor_state& state) {
+    if (state.registered.load(std::memory_order_acquire) ||
+        state.registered.exchange(true, std::memory_order_acq_rel)) {
       return;
     }
 
     epoll_event event{};
-    event.events = desired;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
     event.data.ptr = &state;
 
-    const int op = state.registered_with_epoll ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
-    if (::epoll_ctl(epoll_fd_, op, state.fd, &event) == -1) {
-      if (errno == ENOENT && op == EPOLL_CTL_MOD) {
-        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, state.fd, &event) == -1) {
-          throw std::system_error(errno, std::system_category(),
-                                  "epoll_ctl add failed");
-        }
-      } else if (errno == EEXIST && op == EPOLL_CTL_ADD) {
-        if (::epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, state.fd, &event) == -1) {
-          throw std::system_error(errno, std::system_category(),
-                                  "epoll_ctl mod failed");
-        }
-      } else {
-        throw std::system_error(errno, std::system_category(), "epoll_ctl failed");
+    if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, state.fd, &event) == -1) {
+      // EEXIST 说明这个fd已经由另一个 descriptor_state（socket 或另一个原始fd操作）注册，
+      // 不能改为指向当前状态：当前状态注销时的 EPOLL_CTL_DEL 会把原来的注册一起删掉，
+      // 而原状态的 registered 仍为 true，之后永远不会再注册，等待者也就永远收不到事件
+      const int saved_errno = errno;
+      state.registered.store(false, std::memory_order_release);
+      throw std::system_error(saved_errno, std::system_category(),
+                              saved_errno == EEXIST
+                                  ? "epoll_ctl add failed: fd is already registered by "
+                                    "another descriptor state"
+                                  : "epoll_ctl add failed");
+    }
+  }
+
+  // 有等待者就把它换出来完成，没有就留下就绪标记
+  static completion notify_slot(waiter_slot& slot) noexcept {
+    std::uintptr_t current = slot.state.load(std::memory_order_acquire);
+    for (;;) {
+      if (current == waiter_slot::kReady) {
+        return {};
+      }
+
+      const std::uintptr_t next =
+          current == waiter_slot::kIdle ? waiter_slot::kReady : waiter_slot::kIdle;
+      if (slot.state.compare_exchange_weak(current, next)) {
+        break;
       }
     }
 
-    state.registered_with_epoll = true;
-    state.registered_events = desired;
+    if (current == waiter_slot::kIdle) {
+      return {};
+    }
+    return complete_operation(*reinterpret_cast<wait_operation_state*>(current),
+                              false, 0);
   }
 
   void dispatch_descriptor_event(descriptor_state& state, uint32_t events) noexcept {
-    std::vector<std::coroutine_handle<>> ready;
-    {
-      std::lock_guard lock(state.mutex);
-      if (state.closing) {
-        return;
-      }
+    if (state.closing.load(std::memory_order_acquire)) {
+      return;
+    }
 
-      const bool read_ready =
-          (events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0;
-      const bool write_ready =
-          (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0;
-
-      if (read_ready && state.read_waiter.operation != nullptr) {
-        auto* operation = std::exchange(state.read_waiter.operation, nullptr);
-        std::coroutine_handle<> handle;
-        complete_operation_locked(*operation, false, 0, handle);
-        if (handle) {
-          ready.push_back(handle);
-        }
-      }
+    const bool read_ready =
+        (events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP)) != 0;
+    const bool write_ready =
+        (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0;
 
-      if (write_ready && state.write_waiter.operation != nullptr) {
-        auto* operation = std::exchange(state.write_waiter.operation, nullptr);
-        std::coroutine_handle<> handle;
-        complete_operation_locked(*operation, false, 0, handle);
-        if (handle) {
-          ready.push_back(handle);
-        }
+    if (read_ready) {
+      if (const completion done = notify_slot(state.read_waiter)) {
+        io_context_access::post_completion(*ctx_, done);
       }
+    }
 
-      try {
-        update_interest_locked(state);
-      } catch (...) {
-        // 事件分发路径不向外抛异常，避免中断事件循环。
+    if (write_ready) {
+      if (const completion done = notify_slot(state.write_waiter)) {
+        io_context_access::post_completion(*ctx_, done);
       }
     }
 
-    for (auto handle : ready) {
-      io_context_access::enqueue_ready(*ctx_, handle);
+    if ((events & EPOLLERR) != 0) {
+      if (const completion done = notify_slot(state.error_waiter)) {
+        io_context_access::post_completion(*ctx_, done);
+      }
     }
   }
 
@@ -1,11 +1,17 @@
 #pragma once
 
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
+#include <array>
 #include <cerrno>
+#include <cstddef>
+#include <optional>
 #include <system_error>
+#include <utility>
 
 namespace xcoro::net::detail {
 
@@ -61,6 +67,23 @@ inline int create_socket(int family, int type, int protocol) {
   return fd;
 }
 
+inline void create_socket_pair(int family, int type, int protocol, int (&fds)[2]) {
+  int rc = ::socketpair(family, type | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol, fds);
+  if (rc == -1 && errno == EINVAL) {
+    rc = ::socketpair(family, type, protocol, fds);
+    if (rc == 0) {
+      for (const int fd : fds) {
+        set_nonblocking(fd, true);
+        set_cloexec(fd, true);
+      }
+    }
+  }
+
+  if (rc == -1) {
+    throw std::system_error(errno, std::system_category(), "socketpair failed");
+  }
+}
+
 inline int accept_nonblocking(int listen_fd, sockaddr* addr, socklen_t* addrlen) {
   int fd = ::accept4(listen_fd, addr, addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
   if (fd == -1 && (errno == ENOSYS || errno == EINVAL)) {
@@ -83,4 +106,122 @@ inline int get_socket_error(int fd) {
   return error;
 }
 
+inline bool is_pipe(int fd) {
+  struct stat info {};
+  if (::fstat(fd, &info) == -1) {
+    throw std::system_error(errno, std::system_category(), "fstat failed");
+  }
+  return S_ISFIFO(info.st_mode);
+}
+
+// 不等待地检查 fd 是否就绪；出错或挂断也算就绪，随后的系统调用会报告具体结果
+inline bool poll_ready(int fd, short events) noexcept {
+  pollfd entry{fd, events, 0};
+  return ::poll(&entry, 1, 0) > 0 && entry.revents != 0;
+}
+
+// splice 的两端至少有一个必须是管道，socket 之间转发时用它做内核内的中转
+class pipe_pair {
+ public:
+  pipe_pair() {
+    int fds[2] = {-1, -1};
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) == -1) {
+      throw std::system_error(errno, std::system_category(), "pipe2 failed");
+    }
+    read_fd_ = fds[0];
+    write_fd_ = fds[1];
+  }
+
+  ~pipe_pair() { reset(); }
+
+  pipe_pair(const pipe_pair&) = delete;
+  pipe_pair& operator=(const pipe_pair&) = delete;
+
+  pipe_pair(pipe_pair&& other) noexcept
+      : read_fd_(std::exchange(other.read_fd_, -1)),
+        write_fd_(std::exchange(other.write_fd_, -1)) {}
+
+  pipe_pair& operator=(pipe_pair&& other) noexcept {
+    if (this != &other) {
+      reset();
+      read_fd_ = std::exchange(other.read_fd_, -1);
+      write_fd_ = std::exchange(other.write_fd_, -1);
+    }
+    return *this;
+  }
+
+  int read_fd() const noexcept { return read_fd_; }
+  int write_fd() const noexcept { return write_fd_; }
+
+ private:
+  void reset() noexcept {
+    if (read_fd_ != -1) {
+      ::close(read_fd_);
+      ::close(write_fd_);
+      read_fd_ = -1;
+      write_fd_ = -1;
+    }
+  }
+
+  int read_fd_ = -1;
+  int write_fd_ = -1;
+};
+
+// 从当前线程的缓存里借一条中转管道，避免每次转发都 pipe2 + 两次 close。
+// 转发期间管道被借出，同一线程上同时进行的其它转发会拿到另一条。
+// 只有排空的管道才能还回来：残留数据的管道（转发中途失败）直接关闭，不会串到下一次转发
+class pipe_lease {
+ public:
+  pipe_lease() : pipe_(take()) {}
+
+  ~pipe_lease() {
+    if (drained_) {
+      give_back(std::move(pipe_));
+    }
+  }
+
+  pipe_lease(const pipe_lease&) = delete;
+  pipe_lease& operator=(const pipe_lease&) = delete;
+
+  int read_fd() const noexcept { return pipe_.read_fd(); }
+  int write_fd() const noexcept { return pipe_.write_fd(); }
+
+  // 有数据读进管道后置为 false，全部写出后置回 true
+  void set_drained(bool drained) noexcept { drained_ = drained; }
+
+ private:
+  static constexpr std::size_t kMaxCached = 4;
+
+  struct cache {
+    std::array<std::optional<pipe_pair>, kMaxCached> pipes;
+    std::size_t count = 0;
+  };
+
+  static cache& local() noexcept {
+    thread_local cache pipes;
+    return pipes;
+  }
+
+  static pipe_pair take() {
+    auto& pipes = local();
+    if (pipes.count == 0) {
+      return pipe_pair{};
+    }
+    auto& slot = pipes.pipes[--pipes.count];
+    pipe_pair pipe = std::move(*slot);
+    slot.reset();
+    return pipe;
+  }
+
+  static void give_back(pipe_pair pipe) noexcept {
+    auto& pipes = local();
+    if (pipes.count < kMaxCached) {
+      pipes.pipes[pipes.count++].emplace(std::move(pipe));
+    }
+  }
+
+  pipe_pair pipe_;
+  bool drained_ = true;
+};
+
 }  // namespace xcoro::net::detail
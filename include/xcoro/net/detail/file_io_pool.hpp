@@ -0,0 +1,166 @@
+#pragma once
+
+#include <sys/types.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "xcoro/net/detail/io_context_access.hpp"
+
+namespace xcoro::net {
+
+class io_context;
+
+}  // namespace xcoro::net
+
+namespace xcoro::net::detail {
+
+enum class file_op { read, write, fsync, fdatasync };
+
+// 一次阻塞文件操作。节点放在等待者的协程帧里，工作线程完成后投递回 io_context，
+// 投递是对节点的最后一次访问，不需要额外分配
+struct file_job {
+  io_context* ctx = nullptr;
+  std::coroutine_handle<> handle{};
+  executor_ref executor{};
+  file_op op = file_op::read;
+  int fd = -1;
+  std::byte* data = nullptr;
+  size_t size = 0;
+  off_t offset = 0;
+  size_t result = 0;
+  std::exception_ptr exception;
+  file_job* next = nullptr;
+};
+
+// 普通文件在 epoll 看来总是就绪的，读写会阻塞事件循环线程，
+// 所以交给固定数量的工作线程执行 pread/pwrite/fsync
+class file_io_pool {
+ public:
+  static file_io_pool& instance() {
+    static file_io_pool pool;
+    return pool;
+  }
+
+  file_io_pool(const file_io_pool&) = delete;
+  file_io_pool& operator=(const file_io_pool&) = delete;
+
+  void submit(file_job* job) {
+    {
+      std::lock_guard lock(mutex_);
+      if (tail_ == nullptr) {
+        head_ = job;
+      } else {
+        tail_->next = job;
+      }
+      tail_ = job;
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  static constexpr unsigned kMaxWorkers = 4;
+
+  file_io_pool() {
+    const unsigned count = std::clamp(std::thread::hardware_concurrency(), 1u, kMaxWorkers);
+    workers_.reserve(count);
+    for (unsigned i = 0; i < count; ++i) {
+      workers_.emplace_back([this] { worker_loop(); });
+    }
+  }
+
+  ~file_io_pool() {
+    {
+      std::lock_guard lock(mutex_);
+      stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+      worker.join();
+    }
+  }
+
+  void worker_loop() {
+    while (true) {
+      file_job* job = nullptr;
+      {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [this] { return stopping_ || head_ != nullptr; });
+        if (head_ == nullptr) {
+          return;
+        }
+        job = head_;
+        head_ = job->next;
+        if (head_ == nullptr) {
+          tail_ = nullptr;
+        }
+      }
+
+      try {
+        job->result = run(*job);
+      } catch (...) {
+        job->exception = std::current_exception();
+      }
+
+      // 投递之后等待者可能立即恢复并销毁节点，先把需要的字段取出来
+      io_context* ctx = job->ctx;
+      const completion done{job->handle, job->executor};
+      io_context_access::post_completion(*ctx, done);
+      io_context_access::wake(*ctx);
+    }
+  }
+
+  // 读写循环处理短读短写：读到文件末尾时提前返回，写总是写完整个缓冲区
+  static size_t run(const file_job& job) {
+    if (job.op == file_op::fsync || job.op == file_op::fdatasync) {
+      const int rc = job.op == file_op::fsync ? ::fsync(job.fd) : ::fdatasync(job.fd);
+      if (rc == -1) {
+        throw std::system_error(errno, std::system_category(),
+                                job.op == file_op::fsync ? "fsync failed" : "fdatasync failed");
+      }
+      return 0;
+    }
+
+    size_t done = 0;
+    while (done < job.size) {
+      const off_t offset = job.offset + static_cast<off_t>(done);
+      const ssize_t n = job.op == file_op::read
+                            ? ::pread(job.fd, job.data + done, job.size - done, offset)
+                            : ::pwrite(job.fd, job.data + done, job.size - done, offset);
+      if (n > 0) {
+        done += static_cast<size_t>(n);
+        continue;
+      }
+      if (n == 0) {
+        if (job.op == file_op::read) {
+          break;
+        }
+        throw std::system_error(EIO, std::system_category(), "pwrite made no progress");
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(),
+                              job.op == file_op::read ? "pread failed" : "pwrite failed");
+    }
+    return done;
+  }
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  file_job* head_ = nullptr;
+  file_job* tail_ = nullptr;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace xcoro::net::detail
@@ -2,6 +2,8 @@
 
 #include <coroutine>
 
+#include "xcoro/net/detail/operation_state.hpp"
+
 namespace xcoro::net {
 
 class io_context;
@@ -12,7 +14,9 @@ namespace xcoro::net::detail {
 
 struct io_context_access {
   static void enqueue_ready(io_context& ctx, std::coroutine_handle<> handle) noexcept;
+  static void post_completion(io_context& ctx, const completion& done) noexcept;
   static void wake(io_context& ctx) noexcept;
+  static executor_ref affine_executor(io_context& ctx) noexcept;
 };
 
 }  // namespace xcoro::net::detail
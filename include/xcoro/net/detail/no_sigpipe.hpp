@@ -1,7 +1,9 @@
 #pragma once
 
 #include <pthread.h>
+#include <signal.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #include <cerrno>
@@ -33,4 +35,53 @@ inline ssize_t write_no_sigpipe(int fd, const void* buffer, size_t count) {
   return -1;
 }
 
+// 分散写版本：sendmsg 同样可以带 MSG_NOSIGNAL，非套接字 fd 回退到 writev
+inline ssize_t writev_no_sigpipe(int fd, const iovec* iov, size_t count) {
+  msghdr message{};
+  message.msg_iov = const_cast<iovec*>(iov);
+  message.msg_iovlen = count;
+  ssize_t n = ::sendmsg(fd, &message, MSG_NOSIGNAL);
+  if (n >= 0) {
+    return n;
+  }
+
+  if (errno == ENOTSOCK || errno == EPERM) {
+    return ::writev(fd, iov, static_cast<int>(count));
+  }
+
+  return -1;
+}
+
+// sendfile/splice 没有 MSG_NOSIGNAL 这样的标志，只能在调用期间临时屏蔽 SIGPIPE：
+// 屏蔽、调用、以 EPIPE 失败时取走这次调用产生的 SIGPIPE，最后恢复原来的屏蔽字。
+// 线程的信号屏蔽字在返回时保持原样，不会影响调用方自己的写操作和之后创建的线程、子进程。
+// 调用方本来就屏蔽了 SIGPIPE 时不改屏蔽字；调用前已经挂起的 SIGPIPE 属于调用方，不会被取走
+template <typename Call>
+ssize_t call_without_sigpipe(Call&& call) {
+  sigset_t pipe_set;
+  sigemptyset(&pipe_set);
+  sigaddset(&pipe_set, SIGPIPE);
+  sigset_t old_mask;
+  pthread_sigmask(SIG_BLOCK, &pipe_set, &old_mask);
+  const bool already_blocked = sigismember(&old_mask, SIGPIPE) == 1;
+  bool already_pending = false;
+  if (already_blocked) {
+    sigset_t pending;
+    already_pending = ::sigpending(&pending) == 0 && sigismember(&pending, SIGPIPE) == 1;
+  }
+
+  const ssize_t n = call();
+  const int error = errno;
+  if (n == -1 && error == EPIPE && !already_pending) {
+    const timespec no_wait{0, 0};
+    while (::sigtimedwait(&pipe_set, nullptr, &no_wait) == -1 && errno == EINTR) {
+    }
+  }
+  if (!already_blocked) {
+    pthread_sigmask(SIG_SETMASK, &old_mask, nullptr);
+  }
+  errno = error;
+  return n;
+}
+
 }  // namespace xcoro::net::detail
\ No newline at end of file
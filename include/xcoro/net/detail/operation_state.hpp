@@ -4,20 +4,33 @@
 #include <coroutine>
 
 #include "xcoro/cancellation_registration.hpp"
+#include "xcoro/executor.hpp"
 
 namespace xcoro::net::detail {
 
+// 一次已完成等待的恢复目标：
+// executor 为空时直接放回 io_context 的 ready queue，否则投递回等待方原来的调度器
+struct completion {
+  std::coroutine_handle<> handle{};
+  executor_ref executor{};
+
+  explicit operator bool() const noexcept { return static_cast<bool>(handle); }
+};
+
 // 单次等待操作的状态。
 // 它归某个 awaiter 所有，descriptor 只临时持有裸指针。
 struct wait_operation_state {
   std::coroutine_handle<> handle{};
+  executor_ref executor{};
   cancellation_registration registration{};
   std::atomic_bool completed{false};
   std::atomic_bool cancelled{false};
   std::atomic_int error{0};
 
-  void reset(std::coroutine_handle<> new_handle) noexcept {
+  void reset(std::coroutine_handle<> new_handle,
+             executor_ref new_executor = {}) noexcept {
     handle = new_handle;
+    executor = new_executor;
     registration = {};
     completed.store(false, std::memory_order_release);
     cancelled.store(false, std::memory_order_release);
@@ -8,6 +8,8 @@
 #include <queue>
 #include <vector>
 
+#include "xcoro/executor.hpp"
+
 namespace xcoro::net {
 
 class io_context;
@@ -21,6 +23,7 @@ class timer_queue {
   struct timer_state {
     io_context* ctx = nullptr;
     std::coroutine_handle<> handle{};
+    executor_ref executor{};
     std::atomic_bool completed{false};
     std::atomic_bool cancelled{false};
   };
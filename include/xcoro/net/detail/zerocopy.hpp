@@ -0,0 +1,74 @@
+#pragma once
+
+// linux/errqueue.h 用到 struct timespec，但自己没有包含定义它的头文件
+#include <time.h>
+
+#include <linux/errqueue.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <system_error>
+
+#include "xcoro/net/detail/descriptor_state.hpp"
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+
+namespace xcoro::net::detail {
+
+// 零拷贝发送的序号是 32 位并且会回绕，按差值比较先后
+inline bool zerocopy_reached(std::uint32_t completed, std::uint32_t target) noexcept {
+  return static_cast<std::int32_t>(completed - target) >= 0;
+}
+
+// 读空 socket 错误队列，把 MSG_ZEROCOPY 完成通知累加到 state.zerocopy_completed。
+// 每条通知覆盖一段闭区间 [ee_info, ee_data] 的发送序号，内核可能把相邻的通知合并
+inline void drain_zerocopy_completions(descriptor_state& state) {
+  for (;;) {
+    alignas(cmsghdr) char control[128];
+    msghdr message{};
+    message.msg_control = control;
+    message.msg_controllen = sizeof(control);
+
+    if (::recvmsg(state.fd, &message, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return;
+      }
+      throw std::system_error(errno, std::system_category(),
+                              "recvmsg(MSG_ERRQUEUE) failed");
+    }
+
+    for (cmsghdr* header = CMSG_FIRSTHDR(&message); header != nullptr;
+         header = CMSG_NXTHDR(&message, header)) {
+      const bool ip_error = (header->cmsg_level == SOL_IP && header->cmsg_type == IP_RECVERR) ||
+                            (header->cmsg_level == SOL_IPV6 && header->cmsg_type == IPV6_RECVERR);
+      if (!ip_error) {
+        continue;
+      }
+
+      const auto* error = reinterpret_cast<const sock_extended_err*>(CMSG_DATA(header));
+      if (error->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+        state.zerocopy_completed += error->ee_data - error->ee_info + 1;
+      } else if (error->ee_errno != 0) {
+        throw std::system_error(static_cast<int>(error->ee_errno), std::system_category(),
+                                "socket error queue reported failure");
+      }
+    }
+  }
+}
+
+}  // namespace xcoro::net::detail
@@ -3,7 +3,9 @@
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <stdexcept>
@@ -72,6 +74,20 @@ class endpoint {
     return from_numeric_address("::", port);
   }
 
+  // 文件系统路径上的 AF_UNIX 地址；路径放不进 sun_path 时抛出异常
+  static endpoint unix_path(std::string_view path) {
+    if (path.empty()) {
+      throw std::invalid_argument("unix socket path must not be empty");
+    }
+    return make_unix(path, false);
+  }
+
+  // Linux 抽象命名空间地址：sun_path 以 '\0' 开头，不在文件系统中创建文件，
+  // 最后一个引用关闭后名字自动释放
+  static endpoint unix_abstract(std::string_view name) {
+    return make_unix(name, true);
+  }
+
   static endpoint from_sockaddr(const sockaddr* sa, socklen_t len) {
     if (sa == nullptr || len == 0 || len > sizeof(sockaddr_storage)) {
       throw std::runtime_error("invalid sockaddr");
@@ -93,7 +109,32 @@ class endpoint {
 
   int family() const noexcept { return data()->sa_family; }
 
+  bool is_unix() const noexcept { return length_ != 0 && family() == AF_UNIX; }
+
+  bool is_abstract() const noexcept {
+    const auto* address = reinterpret_cast<const sockaddr_un*>(&storage_);
+    return is_unix() && length_ > kUnixPathOffset && address->sun_path[0] == '\0';
+  }
+
+  // AF_UNIX 地址的路径；抽象地址按 ss/netstat 的习惯以 '@' 开头，未命名的 socket 返回空串
+  std::string path() const {
+    if (!is_unix() || length_ <= kUnixPathOffset) {
+      return {};
+    }
+    const auto* address = reinterpret_cast<const sockaddr_un*>(&storage_);
+    const size_t length = length_ - kUnixPathOffset;
+    if (address->sun_path[0] == '\0') {
+      return "@" + std::string(address->sun_path + 1, length - 1);
+    }
+    // 内核返回的路径地址可能带着结尾的 '\0'
+    return std::string(address->sun_path, ::strnlen(address->sun_path, length));
+  }
+
   std::string address_string() const {
+    if (is_unix()) {
+      return path();
+    }
+
     char buffer[INET6_ADDRSTRLEN] = {0};
 
     if (family() == AF_INET) {
@@ -128,6 +169,9 @@ class endpoint {
   }
 
   std::string to_string() const {
+    if (is_unix()) {
+      return path();
+    }
     if (family() == AF_INET6) {
       return "[" + address_string() + "]:" + std::to_string(port());
     }
@@ -135,6 +179,27 @@ class endpoint {
   }
 
  private:
+  static constexpr socklen_t kUnixPathOffset = offsetof(sockaddr_un, sun_path);
+
+  static endpoint make_unix(std::string_view path, bool abstract) {
+    sockaddr_un address{};
+    const size_t prefix = abstract ? 1 : 0;
+    // 路径地址需要留出结尾的 '\0'，抽象地址按长度计算不需要
+    const size_t capacity = sizeof(address.sun_path) - (abstract ? 0 : 1);
+    if (prefix + path.size() > capacity) {
+      throw std::invalid_argument("unix socket path is too long: " + std::string(path));
+    }
+
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path + prefix, path.data(), path.size());
+
+    endpoint ep;
+    std::memcpy(&ep.storage_, &address, sizeof(address));
+    ep.length_ = static_cast<socklen_t>(kUnixPathOffset + prefix + path.size() +
+                                        (abstract ? 0 : 1));
+    return ep;
+  }
+
   sockaddr_storage storage_{};
   socklen_t length_{0};
 };
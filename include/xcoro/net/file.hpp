@@ -0,0 +1,227 @@
+#pragma once
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "xcoro/cancellation_token.hpp"
+#include "xcoro/net/buffer.hpp"
+#include "xcoro/net/detail/file_io_pool.hpp"
+#include "xcoro/net/detail/io_context_access.hpp"
+#include "xcoro/net/io_context.hpp"
+#include "xcoro/task.hpp"
+
+namespace xcoro::net {
+
+// 按 O_DIRECT 要求对齐的堆内存，大小向上取整到对齐粒度
+class aligned_buffer {
+ public:
+  static constexpr size_t kDefaultAlignment = 4096;
+
+  aligned_buffer() noexcept = default;
+  explicit aligned_buffer(size_t size, size_t alignment = kDefaultAlignment)
+      : size_((size + alignment - 1) / alignment * alignment) {
+    if (size_ != 0) {
+      data_ = static_cast<std::byte*>(std::aligned_alloc(alignment, size_));
+      if (data_ == nullptr) {
+        throw std::bad_alloc{};
+      }
+    }
+  }
+
+  aligned_buffer(aligned_buffer&& other) noexcept
+      : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {}
+  aligned_buffer& operator=(aligned_buffer&& other) noexcept {
+    if (this != &other) {
+      std::free(data_);
+      data_ = std::exchange(other.data_, nullptr);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  aligned_buffer(const aligned_buffer&) = delete;
+  aligned_buffer& operator=(const aligned_buffer&) = delete;
+
+  ~aligned_buffer() { std::free(data_); }
+
+  std::byte* data() noexcept { return data_; }
+  const std::byte* data() const noexcept { return data_; }
+  size_t size() const noexcept { return size_; }
+
+  std::span<std::byte> bytes() noexcept { return {data_, size_}; }
+  std::span<const std::byte> bytes() const noexcept { return {data_, size_}; }
+
+ private:
+  std::byte* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+// 普通文件的异步读写。普通文件在 epoll 上总是就绪，直接读写会阻塞事件循环，
+// 这里把 pread/pwrite/fsync 交给后台工作线程执行，完成后回到等待者的调度器上恢复。
+// 以 O_DIRECT 打开时，偏移、长度和缓冲区地址都必须按 direct_alignment() 对齐（可使用 aligned_buffer）
+class async_file {
+ public:
+  async_file() noexcept = default;
+  // 接管 fd 的所有权
+  async_file(io_context& ctx, int fd) : ctx_(&ctx), fd_(fd) {
+    const int flags = ::fcntl(fd_, F_GETFL);
+    if (flags == -1) {
+      throw std::system_error(errno, std::system_category(), "fcntl(F_GETFL) failed");
+    }
+    direct_ = (flags & O_DIRECT) != 0;
+  }
+
+  static async_file open(io_context& ctx, const std::string& path, int flags,
+                         mode_t mode = 0644) {
+    const int fd = ::open(path.c_str(), flags | O_CLOEXEC, mode);
+    if (fd == -1) {
+      throw std::system_error(errno, std::system_category(), "open failed: " + path);
+    }
+    try {
+      return async_file{ctx, fd};
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+  }
+
+  async_file(async_file&& other) noexcept
+      : ctx_(std::exchange(other.ctx_, nullptr)),
+        fd_(std::exchange(other.fd_, -1)),
+        direct_(std::exchange(other.direct_, false)) {}
+  async_file& operator=(async_file&& other) noexcept {
+    if (this != &other) {
+      close();
+      ctx_ = std::exchange(other.ctx_, nullptr);
+      fd_ = std::exchange(other.fd_, -1);
+      direct_ = std::exchange(other.direct_, false);
+    }
+    return *this;
+  }
+
+  async_file(const async_file&) = delete;
+  async_file& operator=(const async_file&) = delete;
+
+  ~async_file() { close(); }
+
+  bool is_open() const noexcept { return fd_ != -1; }
+  int native_handle() const noexcept { return fd_; }
+  bool is_direct() const noexcept { return direct_; }
+
+  // O_DIRECT 要求的对齐粒度。4096 覆盖常见设备的逻辑块大小
+  static constexpr size_t direct_alignment() noexcept { return aligned_buffer::kDefaultAlignment; }
+
+  void close() noexcept {
+    if (fd_ != -1) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+
+  uint64_t size() const {
+    ensure_open();
+    struct stat info{};
+    if (::fstat(fd_, &info) == -1) {
+      throw std::system_error(errno, std::system_category(), "fstat failed");
+    }
+    return static_cast<uint64_t>(info.st_size);
+  }
+
+  // 从 offset 处读取，直到填满 dst 或到达文件末尾，返回读到的字节数
+  task<size_t> async_read_at(uint64_t offset, mutable_buffer dst,
+                             cancellation_token token = {}) {
+    check_direct(offset, dst.bytes.data(), dst.bytes.size());
+    co_return co_await submit(detail::file_op::read, dst.bytes.data(), dst.bytes.size(),
+                              offset, token);
+  }
+
+  // 把 src 全部写到 offset 处
+  task<size_t> async_write_at(uint64_t offset, const_buffer src,
+                              cancellation_token token = {}) {
+    check_direct(offset, src.bytes.data(), src.bytes.size());
+    co_return co_await submit(detail::file_op::write, const_cast<std::byte*>(src.bytes.data()),
+                              src.bytes.size(), offset, token);
+  }
+
+  // data_only 为 true 时使用 fdatasync，不强制刷写与读取数据无关的元数据
+  task<> async_fsync(bool data_only = false, cancellation_token token = {}) {
+    co_await submit(data_only ? detail::file_op::fdatasync : detail::file_op::fsync, nullptr,
+                    0, 0, token);
+  }
+
+ private:
+  // token 只在提交前检查；已经交给工作线程的操作无法中断，会执行完毕
+  class file_operation {
+   public:
+    file_operation(io_context& ctx, detail::file_job job) noexcept : ctx_(&ctx), job_(job) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) {
+      job_.ctx = ctx_;
+      job_.handle = handle;
+      job_.executor = detail::io_context_access::affine_executor(*ctx_);
+      detail::file_io_pool::instance().submit(&job_);
+    }
+
+    size_t await_resume() {
+      if (job_.exception) {
+        std::rethrow_exception(job_.exception);
+      }
+      return job_.result;
+    }
+
+   private:
+    io_context* ctx_;
+    detail::file_job job_;
+  };
+
+  task<size_t> submit(detail::file_op op, std::byte* data, size_t size, uint64_t offset,
+                      cancellation_token& token) {
+    ensure_open();
+    throw_if_cancellation_requested(token);
+    detail::file_job job;
+    job.op = op;
+    job.fd = fd_;
+    job.data = data;
+    job.size = size;
+    job.offset = static_cast<off_t>(offset);
+    co_return co_await file_operation{*ctx_, job};
+  }
+
+  void check_direct(uint64_t offset, const std::byte* data, size_t size) const {
+    if (!direct_) {
+      return;
+    }
+    constexpr size_t alignment = direct_alignment();
+    if (offset % alignment != 0 || size % alignment != 0 ||
+        reinterpret_cast<uintptr_t>(data) % alignment != 0) {
+      throw std::invalid_argument("O_DIRECT file I/O requires aligned offset, size and buffer");
+    }
+  }
+
+  void ensure_open() const {
+    if (!is_open()) {
+      throw std::runtime_error("async_file is not open");
+    }
+  }
+
+  io_context* ctx_ = nullptr;
+  int fd_ = -1;
+  bool direct_ = false;
+};
+
+}  // namespace xcoro::net
@@ -17,7 +17,9 @@
 
 #include "xcoro/cancellation_registration.hpp"
 #include "xcoro/cancellation_token.hpp"
+#include "xcoro/executor.hpp"
 #include "xcoro/net/detail/descriptor_state.hpp"
+#include "xcoro/net/detail/descriptor_table.hpp"
 #include "xcoro/net/detail/epoll_reactor.hpp"
 #include "xcoro/net/detail/io_context_access.hpp"
 #include "xcoro/net/detail/no_sigpipe.hpp"
@@ -114,13 +116,21 @@ class io_context {
   // 后续逻辑延后到下一轮调度执行
   task<> schedule() { co_await schedule_awaiter{this}; }
 
+  // 把一个已经挂起的协程投递到ready queue，由事件循环线程恢复
+  // 满足 concepts::Executor，可以作为 executor_ref 的目标
+  bool post(std::coroutine_handle<> handle) noexcept {
+    enqueue_ready(handle);
+    wake();
+    return true;
+  }
+
   task<size_t> async_read_some(int fd, void* buffer, size_t count) {
     co_return co_await async_read_some(fd, buffer, count, cancellation_token{});
   }
 
   // 1. 先直接::read
   // 2. EINTR 重试
-  // 3. EAGAIN/EWOULDBLOCK时构造一个临时descriptor_state
+  // 3. EAGAIN/EWOULDBLOCK时使用一个临时descriptor_state
   // 4. co_await wait_readable(state,token)
   // 5. 协程恢复后继续重试::read
   task<size_t> async_read_some(int fd, void* buffer, size_t count,
@@ -129,9 +139,8 @@ class io_context {
       co_return 0;
     }
 
-    detail::descriptor_state state;
-    state.ctx = this;
-    state.fd = fd;
+    temporary_descriptor scoped{this, fd};
+    auto& state = scoped.state();
     auto* out = static_cast<std::byte*>(buffer);
 
     for (;;) {
@@ -166,9 +175,8 @@ class io_context {
       co_return 0;
     }
 
-    detail::descriptor_state state;
-    state.ctx = this;
-    state.fd = fd;
+    temporary_descriptor scoped{this, fd};
+    auto& state = scoped.state();
     auto* out = static_cast<std::byte*>(buffer);
     size_t total = 0;
 
@@ -210,9 +218,8 @@ class io_context {
       co_return 0;
     }
 
-    detail::descriptor_state state;
-    state.ctx = this;
-    state.fd = fd;
+    temporary_descriptor scoped{this, fd};
+    auto& state = scoped.state();
     auto* out = static_cast<const std::byte*>(buffer);
     size_t written = 0;
 
@@ -238,16 +245,14 @@ class io_context {
   }
 
   task<> async_accept(int fd, cancellation_token token = {}) {
-    detail::descriptor_state state;
-    state.ctx = this;
-    state.fd = fd;
+    temporary_descriptor scoped{this, fd};
+    auto& state = scoped.state();
     co_await wait_readable(state, token);
   }
 
   task<> async_connection(int fd, cancellation_token token = {}) {
-    detail::descriptor_state state;
-    state.ctx = this;
-    state.fd = fd;
+    temporary_descriptor scoped{this, fd};
+    auto& state = scoped.state();
     co_await wait_writable(state, token);
 
     int error = 0;
@@ -295,6 +300,26 @@ class io_context {
   friend class resolver;
   friend struct detail::io_context_access;
 
+  // 原始fd接口使用的临时descriptor_state。
+  // fd一旦等待过就会留在epoll里，协程结束时必须注销，否则epoll会继续持有指向已销毁状态的指针
+  class temporary_descriptor {
+   public:
+    temporary_descriptor(io_context* ctx, int fd) noexcept {
+      state_.ctx = ctx;
+      state_.fd = fd;
+    }
+
+    ~temporary_descriptor() { state_.ctx->unregister_descriptor(state_); }
+
+    temporary_descriptor(const temporary_descriptor&) = delete;
+    temporary_descriptor& operator=(const temporary_descriptor&) = delete;
+
+    detail::descriptor_state& state() noexcept { return state_; }
+
+   private:
+    detail::descriptor_state state_;
+  };
+
   // 把协程挂到ready queue
   class schedule_awaiter {
    public:
@@ -324,7 +349,7 @@ class io_context {
     ~fd_wait_awaiter() {
       if (ctx_ != nullptr && state_ != nullptr &&
           !operation_.completed.load(std::memory_order_acquire)) {
-        ctx_->reactor_.cancel_wait(*state_, kind_, operation_);
+        ctx_->reactor_.abandon_wait(*state_, kind_, operation_);
       }
     }
 
@@ -339,7 +364,10 @@ class io_context {
         return false;  // 如果token已取消，则直接走inline取消路径
       }
 
-      return ctx_->reactor_.arm_wait(*state_, kind_, operation_, handle, token_);
+      const executor_ref executor =
+          state_->resume_inline ? executor_ref{} : ctx_->affine_executor();
+      return ctx_->reactor_.arm_wait(*state_, kind_, operation_, handle,
+                                     executor, token_);
     }
 
     void await_resume() {
@@ -359,7 +387,7 @@ class io_context {
     io_context* ctx_ = nullptr;
     // 当前等待对应的descriptor共享状态
     detail::descriptor_state* state_ = nullptr;        // 记录这个fd当前有哪些等待者
-    detail::wait_kind kind_{detail::wait_kind::read};  // 等待方向，可读/可写
+    detail::wait_kind kind_{detail::wait_kind::read};  // 等待方向，可读/可写/错误队列
     cancellation_token token_;
     detail::wait_operation_state operation_;  // 记录这一次等待自己的完成状态
   };
@@ -384,6 +412,7 @@ class io_context {
       state_ = std::make_shared<detail::timer_queue::timer_state>();
       state_->ctx = ctx_;
       state_->handle = handle;
+      state_->executor = ctx_->affine_executor();
 
       if (token_.can_be_cancelled() && token_.is_cancellation_requested()) {
         state_->cancelled.store(true, std::memory_order_release);
@@ -397,7 +426,8 @@ class io_context {
             cancellation_registration(token_, [state = state_, ctx = ctx_]() noexcept {
               if (!state->completed.exchange(true, std::memory_order_acq_rel)) {
                 state->cancelled.store(true, std::memory_order_release);
-                detail::io_context_access::enqueue_ready(*ctx, state->handle);
+                detail::io_context_access::post_completion(
+                    *ctx, detail::completion{state->handle, state->executor});
                 detail::io_context_access::wake(*ctx);
               }
             });
@@ -438,6 +468,23 @@ class io_context {
                              std::move(token)};
   }
 
+  // 等待 socket 错误队列可读（EPOLLERR），由零拷贝发送用来等待完成通知
+  task<> wait_error(detail::descriptor_state& state,
+                    cancellation_token token = {}) {
+    co_await fd_wait_awaiter{this, &state, detail::wait_kind::error,
+                             std::move(token)};
+  }
+
+  // 从descriptor表里为fd占用一个槽位，socket持有期间地址保持不变
+  detail::descriptor_state& acquire_descriptor(int fd) {
+    return descriptors_.acquire(*this, fd);
+  }
+
+  // 归还槽位，需要在unregister_descriptor之后、::close(fd)之前调用
+  void release_descriptor(detail::descriptor_state& state) noexcept {
+    descriptors_.release(state);
+  }
+
   // 把某个fd从reactor中注销，并恢复仍然挂在这个fd上的等待者
   void unregister_descriptor(detail::descriptor_state& state,
                              int error = EBADF) noexcept {
@@ -451,6 +498,25 @@ class io_context {
     ready_.push(handle);
   }
 
+  // 恢复一个已完成的等待：优先投递回等待方原来的调度器，
+  // 没有调度器或者调度器已停止时，退回本io_context的ready queue
+  void post_completion(const detail::completion& done) noexcept {
+    if (done.executor.post(done.handle)) {
+      return;
+    }
+    enqueue_ready(done.handle);
+  }
+
+  // 挂起时所在的调度器。事件循环线程本身或者没有调度器的线程返回空，
+  // 表示完成后在事件循环线程上直接恢复，保持原来的行为
+  executor_ref affine_executor() const noexcept {
+    const executor_ref executor = current_executor();
+    if (executor.refers_to(this)) {
+      return {};
+    }
+    return executor;
+  }
+
   // 唤醒epoll_wait()
   void wake() noexcept { reactor_.wake(); }
 
@@ -479,13 +545,14 @@ class io_context {
     for (auto& state : due) {
       if (state != nullptr &&
           !state->completed.exchange(true, std::memory_order_acq_rel)) {
-        enqueue_ready(state->handle);
+        post_completion(detail::completion{state->handle, state->executor});
       }
     }
   }
 
   // 主事件循环
   void event_loop() {
+    xcoro::detail::executor_scope executor_scope{*this};
     while (!stopped_.load(std::memory_order_acquire)) {
       reactor_.poll_once(timers_.timeout_ms());
       resume_due_timers();
@@ -497,8 +564,9 @@ class io_context {
     // 退出前，完成所有ready工作
   }
 
-  detail::timer_queue timers_;     // 保存所有定时器
-  detail::epoll_reactor reactor_;  // 负责和epoll/eventfd交互
+  detail::timer_queue timers_;             // 保存所有定时器
+  detail::descriptor_table descriptors_;  // socket的descriptor_state槽位，需要比reactor_活得久
+  detail::epoll_reactor reactor_;         // 负责和epoll/eventfd交互
 
   std::mutex ready_mutex_;                     // 保护ready_队列
   std::queue<std::coroutine_handle<>> ready_;  // 保存即将被恢复的协程句柄
@@ -516,6 +584,15 @@ inline void io_context_access::enqueue_ready(io_context& ctx,
   ctx.enqueue_ready(handle);
 }
 
+inline void io_context_access::post_completion(io_context& ctx,
+                                               const completion& done) noexcept {
+  ctx.post_completion(done);
+}
+
 inline void io_context_access::wake(io_context& ctx) noexcept { ctx.wake(); }
 
+inline executor_ref io_context_access::affine_executor(io_context& ctx) noexcept {
+  return ctx.affine_executor();
+}
+
 }  // namespace xcoro::net::detail
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "xcoro/net/buffer.hpp"
+
+namespace xcoro::net {
+
+namespace detail {
+
+class iobuf_block_pool;
+
+// 固定大小的引用计数内存块，块头和数据区在同一次分配里。
+// 块头按缓存行对齐并补齐，数据区从缓存行边界开始，memcpy 和向量化读写都是对齐的
+struct alignas(64) iobuf_block {
+  static constexpr size_t kAllocationSize = 16 * 1024;
+
+  std::atomic<uint32_t> refs{1};
+  // 分配这个块的线程的缓存，块在哪个线程上释放都会回到这里
+  iobuf_block_pool* owner = nullptr;
+  // 只在空闲链表里使用
+  iobuf_block* next_free = nullptr;
+
+  std::byte* data() noexcept { return reinterpret_cast<std::byte*>(this + 1); }
+  static constexpr size_t capacity() noexcept {
+    return kAllocationSize - sizeof(iobuf_block);
+  }
+
+  static iobuf_block* allocate();
+  static void release(iobuf_block* block) noexcept;
+
+  void retain() noexcept { refs.fetch_add(1, std::memory_order_relaxed); }
+
+  // 只有唯一持有者才能在已发布的数据之外继续写入
+  bool unique() const noexcept { return refs.load(std::memory_order_acquire) == 1; }
+};
+
+static_assert(sizeof(iobuf_block) == alignof(iobuf_block));
+
+// 每个线程缓存一批空闲块，在本线程分配和归还都不需要同步。
+// 在其它线程上释放的块（例如 reactor 线程读入、worker 线程处理完后释放）压进所属缓存的
+// 无锁远程链表，所属线程缓存用完时一次性收回，块不会在释放线程上越积越多而分配线程一直新建。
+// 缓存对象在堆上，所属线程退出后由最后一个块释放它，之后再归还的块直接释放内存
+class iobuf_block_pool {
+ public:
+  static constexpr size_t kMaxCachedBlocks = 256;
+
+  iobuf_block_pool(const iobuf_block_pool&) = delete;
+  iobuf_block_pool& operator=(const iobuf_block_pool&) = delete;
+
+  static iobuf_block_pool& local() {
+    thread_local thread_handle handle;
+    return *handle.pool;
+  }
+
+  // 当前线程的缓存，还没有创建时为空
+  static iobuf_block_pool* current() noexcept { return current_; }
+
+  iobuf_block* acquire() {
+    if (free_.empty()) {
+      collect_remote();
+    }
+    if (!free_.empty()) {
+      iobuf_block* block = free_.back();
+      free_.pop_back();
+      block->refs.store(1, std::memory_order_relaxed);
+      return block;
+    }
+    void* memory =
+        ::operator new(iobuf_block::kAllocationSize, std::align_val_t{alignof(iobuf_block)});
+    live_.fetch_add(1, std::memory_order_relaxed);
+    auto* block = ::new (memory) iobuf_block{};
+    block->owner = this;
+    return block;
+  }
+
+  // 只在所属线程上调用
+  void recycle(iobuf_block* block) noexcept {
+    if (free_.size() < kMaxCachedBlocks) {
+      try {
+        free_.push_back(block);
+        return;
+      } catch (...) {
+      }
+    }
+    destroy(block);
+  }
+
+  // 在其它线程上归还；所属线程已经退出时直接释放
+  static void recycle_remote(iobuf_block* block) noexcept {
+    iobuf_block_pool* owner = block->owner;
+    iobuf_block* head = owner->remote_.load(std::memory_order_acquire);
+    do {
+      if (head == closed_marker()) {
+        owner->destroy(block);
+        return;
+      }
+      block->next_free = head;
+    } while (!owner->remote_.compare_exchange_weak(head, block, std::memory_order_release,
+                                                   std::memory_order_acquire));
+  }
+
+ private:
+  struct thread_handle {
+    thread_handle() : pool(new iobuf_block_pool) { current_ = pool; }
+    ~thread_handle() {
+      current_ = nullptr;
+      pool->close();
+    }
+    iobuf_block_pool* pool;
+  };
+
+  iobuf_block_pool() = default;
+
+  static iobuf_block* closed_marker() noexcept {
+    static iobuf_block marker;
+    return &marker;
+  }
+
+  void collect_remote() noexcept {
+    iobuf_block* block = remote_.exchange(nullptr, std::memory_order_acquire);
+    while (block != nullptr) {
+      iobuf_block* next = block->next_free;
+      recycle(block);
+      block = next;
+    }
+  }
+
+  // 所属线程退出：释放缓存里的块，之后远程归还的块直接释放
+  void close() noexcept {
+    iobuf_block* block = remote_.exchange(closed_marker(), std::memory_order_acq_rel);
+    while (block != nullptr) {
+      iobuf_block* next = block->next_free;
+      destroy(block);
+      block = next;
+    }
+    for (iobuf_block* cached : free_) {
+      destroy(cached);
+    }
+    free_.clear();
+    unref();
+  }
+
+  void destroy(iobuf_block* block) noexcept {
+    block->~iobuf_block();
+    ::operator delete(block, std::align_val_t{alignof(iobuf_block)});
+    unref();
+  }
+
+  void unref() noexcept {
+    if (live_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      delete this;
+    }
+  }
+
+  inline static thread_local iobuf_block_pool* current_ = nullptr;
+
+  std::vector<iobuf_block*> free_;
+  std::atomic<iobuf_block*> remote_{nullptr};
+  // 所属线程占一个引用，每个还存在的块（使用中或者在缓存里）各占一个
+  std::atomic<size_t> live_{1};
+};
+
+inline iobuf_block* iobuf_block::allocate() {
+  return iobuf_block_pool::local().acquire();
+}
+
+inline void iobuf_block::release(iobuf_block* block) noexcept {
+  if (block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    if (block->owner == iobuf_block_pool::current()) {
+      block->owner->recycle(block);
+    } else {
+      iobuf_block_pool::recycle_remote(block);
+    }
+  }
+}
+
+}  // namespace detail
+
+// 由引用计数内存块串成的链式缓冲区。
+// 拷贝、切片、拆分帧都只增加块的引用计数，不搬运字节；
+// 只有 append/prepend 原始字节时才会写入，且只写入当前独占的块
+class iobuf {
+ public:
+  iobuf() noexcept = default;
+
+  explicit iobuf(std::span<const std::byte> bytes) { append(bytes); }
+
+  ~iobuf() { clear(); }
+
+  // 拷贝只共享底层块
+  iobuf(const iobuf& other) : segments_(other.segments_), size_(other.size_) {
+    for (auto& segment : segments_) {
+      segment.block->retain();
+    }
+  }
+
+  iobuf& operator=(const iobuf& other) {
+    if (this != &other) {
+      iobuf copy(other);
+      swap(copy);
+    }
+    return *this;
+  }
+
+  iobuf(iobuf&& other) noexcept
+      : segments_(std::move(other.segments_)),
+        size_(std::exchange(other.size_, 0)) {
+    other.segments_.clear();
+  }
+
+  iobuf& operator=(iobuf&& other) noexcept {
+    if (this != &other) {
+      clear();
+      segments_ = std::move(other.segments_);
+      size_ = std::exchange(other.size_, 0);
+      other.segments_.clear();
+    }
+    return *this;
+  }
+
+  void swap(iobuf& other) noexcept {
+    segments_.swap(other.segments_);
+    std::swap(size_, other.size_);
+  }
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_t size() const noexcept { return size_; }
+  size_t segment_count() const noexcept { return segments_.size(); }
+
+  iobuf clone() const { return iobuf(*this); }
+
+  // 追加原始字节：优先写进尾部独占块的剩余空间，不够时再取新块
+  void append(std::span<const std::byte> bytes) {
+    while (!bytes.empty()) {
+      auto space = prepare(1);
+      const size_t n = std::min(space.size(), bytes.size());
+      std::memcpy(space.data(), bytes.data(), n);
+      commit(n);
+      bytes = bytes.subspan(n);
+    }
+  }
+
+  // 追加另一个链，只共享其中的块
+  void append(const iobuf& other) {
+    segments_.reserve(segments_.size() + other.segments_.size());
+    for (const auto& segment : other.segments_) {
+      segment.block->retain();
+      segments_.push_back(segment);
+    }
+    size_ += other.size_;
+  }
+
+  void append(iobuf&& other) {
+    if (segments_.empty()) {
+      *this = std::move(other);
+      return;
+    }
+    segments_.insert(segments_.end(), other.segments_.begin(), other.segments_.end());
+    size_ += std::exchange(other.size_, 0);
+    other.segments_.clear();
+  }
+
+  // 在头部插入字节，典型用法是在已经编码好的消息体前补上长度前缀
+  void prepend(std::span<const std::byte> bytes) {
+    if (bytes.empty()) {
+      return;
+    }
+
+    if (!segments_.empty()) {
+      auto& head = segments_.front();
+      if (head.offset >= bytes.size() && head.block->unique()) {
+        head.offset -= static_cast<uint32_t>(bytes.size());
+        head.length += static_cast<uint32_t>(bytes.size());
+        std::memcpy(head.block->data() + head.offset, bytes.data(), bytes.size());
+        size_ += bytes.size();
+        return;
+      }
+    }
+
+    iobuf front;
+    while (!bytes.empty()) {
+      // 数据放在块的末尾，之后的 prepend 还能继续利用块前部的空间
+      const size_t n = std::min(bytes.size(), detail::iobuf_block::capacity());
+      auto* block = detail::iobuf_block::allocate();
+      const auto offset = static_cast<uint32_t>(detail::iobuf_block::capacity() - n);
+      std::memcpy(block->data() + offset, bytes.data() + bytes.size() - n, n);
+      front.segments_.insert(front.segments_.begin(),
+                             segment{block, offset, static_cast<uint32_t>(n)});
+      front.size_ += n;
+      bytes = bytes.first(bytes.size() - n);
+    }
+    front.append(std::move(*this));
+    *this = std::move(front);
+  }
+
+  // 返回尾部至少 min_bytes 的连续可写空间（不超过单个块的容量），写入后调用 commit。
+  // 适合直接把 socket 读到的数据落在链上，避免再拷贝一次
+  std::span<std::byte> prepare(size_t min_bytes) {
+    if (min_bytes > detail::iobuf_block::capacity()) {
+      throw std::length_error("iobuf::prepare exceeds block capacity");
+    }
+
+    if (!segments_.empty()) {
+      auto& tail = segments_.back();
+      const size_t end = tail.offset + tail.length;
+      const size_t room = detail::iobuf_block::capacity() - end;
+      if (room >= min_bytes && room > 0 && tail.block->unique()) {
+        return {tail.block->data() + end, room};
+      }
+    }
+
+    auto* block = detail::iobuf_block::allocate();
+    try {
+      segments_.push_back(segment{block, 0, 0});
+    } catch (...) {
+      detail::iobuf_block::release(block);
+      throw;
+    }
+    return {block->data(), detail::iobuf_block::capacity()};
+  }
+
+  void commit(size_t n) noexcept {
+    assert(!segments_.empty() || n == 0);
+    if (n == 0) {
+      return;
+    }
+    auto& tail = segments_.back();
+    assert(tail.offset + tail.length + n <= detail::iobuf_block::capacity());
+    tail.length += static_cast<uint32_t>(n);
+    size_ += n;
+  }
+
+  // 丢弃头部 n 个字节
+  void consume(size_t n) noexcept {
+    assert(n <= size_);
+    size_ -= n;
+    size_t drop = 0;
+    while (n > 0) {
+      auto& head = segments_[drop];
+      if (n < head.length) {
+        head.offset += static_cast<uint32_t>(n);
+        head.length -= static_cast<uint32_t>(n);
+        break;
+      }
+      n -= head.length;
+      detail::iobuf_block::release(head.block);
+      ++drop;
+    }
+    drop_front_segments(drop);
+  }
+
+  // 丢弃尾部 n 个字节
+  void trim_back(size_t n) noexcept {
+    assert(n <= size_);
+    size_ -= n;
+    while (n > 0) {
+      auto& tail = segments_.back();
+      if (n < tail.length) {
+        tail.length -= static_cast<uint32_t>(n);
+        break;
+      }
+      n -= tail.length;
+      detail::iobuf_block::release(tail.block);
+      segments_.pop_back();
+    }
+  }
+
+  // 截取 [offset, offset + length) 的视图，与原链共享内存块
+  iobuf slice(size_t offset, size_t length) const {
+    if (offset > size_ || length > size_ - offset) {
+      throw std::out_of_range("iobuf::slice out of range");
+    }
+
+    iobuf result;
+    for (const auto& current : segments_) {
+      if (length == 0) {
+        break;
+      }
+      if (offset >= current.length) {
+        offset -= current.length;
+        continue;
+      }
+      const size_t n = std::min<size_t>(current.length - offset, length);
+      current.block->retain();
+      result.segments_.push_back(segment{current.block,
+                                         static_cast<uint32_t>(current.offset + offset),
+                                         static_cast<uint32_t>(n)});
+      result.size_ += n;
+      length -= n;
+      offset = 0;
+    }
+    return result;
+  }
+
+  // 从头部拆出 n 个字节成为独立的链，用于按帧切分
+  iobuf split_front(size_t n) {
+    iobuf front = slice(0, n);
+    consume(n);
+    return front;
+  }
+
+  // 导出为缓冲区序列，交给 socket 的聚集写接口；返回写入 out 的段数，
+  // 段数超过 out.size() 时只导出前面的部分
+  size_t export_buffers(std::span<const_buffer> out) const noexcept {
+    const size_t count = std::min(out.size(), segments_.size());
+    for (size_t i = 0; i < count; ++i) {
+      const auto& current = segments_[i];
+      out[i] = const_buffer{
+          std::span<const std::byte>(current.block->data() + current.offset, current.length)};
+    }
+    return count;
+  }
+
+  std::vector<const_buffer> buffers() const {
+    std::vector<const_buffer> result(segments_.size());
+    export_buffers(result);
+    return result;
+  }
+
+  size_t copy_to(std::span<std::byte> out) const noexcept {
+    size_t copied = 0;
+    for (const auto& current : segments_) {
+      if (copied == out.size()) {
+        break;
+      }
+      const size_t n = std::min<size_t>(current.length, out.size() - copied);
+      std::memcpy(out.data() + copied, current.block->data() + current.offset, n);
+      copied += n;
+    }
+    return copied;
+  }
+
+  void clear() noexcept {
+    for (auto& current : segments_) {
+      detail::iobuf_block::release(current.block);
+    }
+    segments_.clear();
+    size_ = 0;
+  }
+
+ private:
+  struct segment {
+    detail::iobuf_block* block;
+    uint32_t offset;
+    uint32_t length;
+  };
+
+  void drop_front_segments(size_t count) noexcept {
+    if (count > 0) {
+      segments_.erase(segments_.begin(), segments_.begin() + static_cast<std::ptrdiff_t>(count));
+    }
+  }
+
+  std::vector<segment> segments_;
+  size_t size_ = 0;
+};
+
+}  // namespace xcoro::net
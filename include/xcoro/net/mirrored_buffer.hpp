@@ -0,0 +1,231 @@
+#pragma once
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <system_error>
+#include <utility>
+
+#include "xcoro/net/buffer.hpp"
+
+namespace xcoro::net {
+
+// 与 byte_buffer 接口一致的环形缓冲区，但把同一块 memfd 内存连续映射两次：
+// [base, base + capacity) 与 [base + capacity, base + 2 * capacity) 指向相同的物理页，
+// 因此任何跨越末尾的可读/可写区域在虚拟地址上都是连续的，永远不需要 linearize。
+// 容量按页大小对齐，扩容时重新建立一组映射并拷贝一次现有数据
+class mirrored_byte_buffer {
+ public:
+  explicit mirrored_byte_buffer(size_t initial_capacity = 4096) {
+    remap(round_to_pages(std::max<size_t>(initial_capacity, 1)));
+  }
+
+  ~mirrored_byte_buffer() { unmap(); }
+
+  mirrored_byte_buffer(mirrored_byte_buffer&& other) noexcept
+      : base_(std::exchange(other.base_, nullptr)),
+        capacity_(std::exchange(other.capacity_, 0)),
+        read_index_(std::exchange(other.read_index_, 0)),
+        size_(std::exchange(other.size_, 0)) {}
+
+  mirrored_byte_buffer& operator=(mirrored_byte_buffer&& other) noexcept {
+    if (this != &other) {
+      unmap();
+      base_ = std::exchange(other.base_, nullptr);
+      capacity_ = std::exchange(other.capacity_, 0);
+      read_index_ = std::exchange(other.read_index_, 0);
+      size_ = std::exchange(other.size_, 0);
+    }
+    return *this;
+  }
+
+  mirrored_byte_buffer(const mirrored_byte_buffer&) = delete;
+  mirrored_byte_buffer& operator=(const mirrored_byte_buffer&) = delete;
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_t size() const noexcept { return size_; }
+  size_t capacity() const noexcept { return capacity_; }
+  size_t writable_bytes() const noexcept { return capacity_ - size_; }
+  size_t writable() const noexcept { return writable_bytes(); }
+
+  // 全部可读数据，始终是一段连续内存
+  std::span<const std::byte> readable() const noexcept {
+    return {base_ + read_index_, size_};
+  }
+
+  std::span<const std::byte> data() const noexcept { return readable(); }
+
+  std::span<const std::byte> contiguous_readable_region() const noexcept {
+    return readable();
+  }
+
+  // 与 byte_buffer 保持同样的形状，第二段恒为空
+  std::array<std::span<const std::byte>, 2> readable_regions() const noexcept {
+    return {readable(), std::span<const std::byte>{}};
+  }
+
+  std::array<const_buffer, 2> readable_buffers() const noexcept {
+    return {const_buffer{readable()}, const_buffer{}};
+  }
+
+  // 保证至少 n 字节的连续可写空间，必要时扩容
+  std::span<std::byte> prepare_contiguous(size_t n) {
+    if (n == 0) {
+      return {};
+    }
+
+    ensure_writable(n);
+    return {base_ + write_index(), n};
+  }
+
+  std::span<std::byte> prepare(size_t n) { return prepare_contiguous(n); }
+
+  std::array<std::span<std::byte>, 2> writable_regions(
+      size_t max_bytes = std::numeric_limits<size_t>::max()) {
+    if (max_bytes == 0) {
+      return {std::span<std::byte>{}, std::span<std::byte>{}};
+    }
+
+    if (max_bytes == std::numeric_limits<size_t>::max()) {
+      max_bytes = writable_bytes();
+    } else {
+      ensure_writable(max_bytes);
+    }
+    return {std::span<std::byte>(base_ + write_index(), max_bytes),
+            std::span<std::byte>{}};
+  }
+
+  std::array<std::span<std::byte>, 2> prepare_regions(
+      size_t n = std::numeric_limits<size_t>::max()) {
+    return writable_regions(n);
+  }
+
+  std::array<mutable_buffer, 2> writable_buffers(
+      size_t max_bytes = std::numeric_limits<size_t>::max()) {
+    const auto regions = writable_regions(max_bytes);
+    return {mutable_buffer{regions[0]}, mutable_buffer{}};
+  }
+
+  void commit(size_t n) noexcept {
+    assert(n <= writable_bytes());
+    size_ += n;
+  }
+
+  void consume(size_t n) noexcept {
+    assert(n <= size_);
+    if (n == 0 || capacity_ == 0) {
+      return;
+    }
+
+    read_index_ = (read_index_ + n) % capacity_;
+    size_ -= n;
+    if (size_ == 0) {
+      clear();
+    }
+  }
+
+  void clear() noexcept {
+    read_index_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  static size_t page_size() noexcept {
+    static const size_t size = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    return size;
+  }
+
+  static size_t round_to_pages(size_t n) noexcept {
+    const size_t page = page_size();
+    return (n + page - 1) / page * page;
+  }
+
+  // 被移走的缓冲区没有映射，capacity_ 为 0；再次 prepare 时会重新映射
+  size_t write_index() const noexcept {
+    return capacity_ == 0 ? 0 : (read_index_ + size_) % capacity_;
+  }
+
+  void ensure_writable(size_t n) {
+    if (writable_bytes() >= n) {
+      return;
+    }
+
+    size_t new_capacity = std::max(capacity_, page_size());
+    const size_t required = size_ + n;
+    while (new_capacity < required) {
+      new_capacity *= 2;
+    }
+    remap(round_to_pages(new_capacity));
+  }
+
+  // 建立新的双重映射并把现有数据拷贝到开头，失败时保持原缓冲区不变
+  void remap(size_t new_capacity) {
+    const int fd = ::memfd_create("xcoro-mirrored-buffer", MFD_CLOEXEC);
+    if (fd == -1) {
+      throw std::system_error(errno, std::system_category(), "memfd_create failed");
+    }
+
+    std::byte* base = nullptr;
+    const int error = map_twice(fd, new_capacity, base);
+    ::close(fd);
+    if (error != 0) {
+      throw std::system_error(error, std::system_category(), "mmap(mirrored) failed");
+    }
+
+    if (size_ > 0) {
+      std::memcpy(base, base_ + read_index_, size_);
+    }
+    unmap();
+    base_ = base;
+    capacity_ = new_capacity;
+    read_index_ = 0;
+  }
+
+  static int map_twice(int fd, size_t size, std::byte*& out) {
+    if (::ftruncate(fd, static_cast<off_t>(size)) == -1) {
+      return errno;
+    }
+
+    // 先保留 2 * size 的地址空间，再把 memfd 固定映射到前后两半
+    void* reserved = ::mmap(nullptr, size * 2, PROT_NONE,
+                            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED) {
+      return errno;
+    }
+
+    auto* base = static_cast<std::byte*>(reserved);
+    for (std::byte* half : {base, base + size}) {
+      if (::mmap(half, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                 fd, 0) == MAP_FAILED) {
+        const int error = errno;
+        ::munmap(reserved, size * 2);
+        return error;
+      }
+    }
+
+    out = base;
+    return 0;
+  }
+
+  void unmap() noexcept {
+    if (base_ != nullptr) {
+      ::munmap(base_, capacity_ * 2);
+      base_ = nullptr;
+    }
+  }
+
+  std::byte* base_ = nullptr;
+  size_t capacity_ = 0;
+  size_t read_index_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace xcoro::net
@@ -117,6 +117,7 @@ class resolver {
       job_ = std::make_shared<detail::blocking_resolver::resolve_job>();
       job_->ctx = ctx_;
       job_->handle = handle;
+      job_->executor = detail::io_context_access::affine_executor(*ctx_);
       job_->request.host = query_.host;
       job_->request.service = query_.service;
       job_->request.family = query_.family;
@@ -131,7 +132,7 @@ class resolver {
       if (token_.can_be_cancelled()) {
         job_->registration = cancellation_registration(
             token_, [job = job_]() noexcept {
-              std::coroutine_handle<> ready;
+              detail::completion ready;
               io_context* ready_ctx = nullptr;
               {
                 std::lock_guard lock(job->mutex);
@@ -140,12 +141,12 @@ class resolver {
                 }
                 job->completed = true;
                 job->cancelled = true;
-                ready = job->handle;
+                ready = detail::completion{job->handle, job->executor};
                 ready_ctx = job->ctx;
               }
 
               if (ready_ctx != nullptr && ready) {
-                detail::io_context_access::enqueue_ready(*ready_ctx, ready);
+                detail::io_context_access::post_completion(*ready_ctx, ready);
                 detail::io_context_access::wake(*ready_ctx);
               }
             });
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <linux/filter.h>
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <span>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include "xcoro/net/acceptor.hpp"
+#include "xcoro/net/endpoint.hpp"
+#include "xcoro/net/io_context.hpp"
+#include "xcoro/net/socket.hpp"
+
+#ifndef SO_ATTACH_REUSEPORT_CBPF
+#define SO_ATTACH_REUSEPORT_CBPF 51
+#endif
+
+namespace xcoro::net {
+
+struct sharded_listen_options {
+  int backlog = SOMAXCONN;
+  bool reuse_address = true;
+  // 挂载一段 CBPF 程序，让内核按处理该连接的 CPU 编号选择分片：shard = cpu % N。
+  // 只有当第 i 个 io_context 的事件循环线程固定在对应 CPU 上时才有局部性收益
+  bool steer_by_cpu = false;
+};
+
+// 在同一个端点上为每个 io_context 各创建一个 SO_REUSEPORT 监听 socket。
+// 内核把新连接分散到各个监听 socket 上，每个分片只在自己的事件循环里 accept，
+// 接入的 socket 也注册在该分片的 io_context 上，不存在多个线程争抢同一个 backlog
+class sharded_acceptor {
+ public:
+  sharded_acceptor() = default;
+
+  static sharded_acceptor listen(std::span<io_context* const> contexts,
+                                 const endpoint& ep,
+                                 sharded_listen_options options = {}) {
+    if (contexts.empty()) {
+      throw std::invalid_argument("sharded_acceptor needs at least one io_context");
+    }
+
+    sharded_acceptor result;
+    result.shards_.reserve(contexts.size());
+
+    // 端口为 0 时由第一个分片向内核要一个临时端口，其余分片绑定到同一个实际端点上
+    endpoint bind_ep = ep;
+    for (io_context* ctx : contexts) {
+      if (ctx == nullptr) {
+        throw std::invalid_argument("sharded_acceptor got a null io_context");
+      }
+      auto listen_socket = socket::open_tcp(*ctx, ep.family());
+      if (options.reuse_address) {
+        listen_socket.set_reuse_address(true);
+      }
+      listen_socket.set_reuse_port(true);
+      listen_socket.bind(bind_ep);
+      // reuseport 组内的下标按 listen 的先后顺序分配，与 shards_ 的下标一致
+      listen_socket.listen(options.backlog);
+      if (result.shards_.empty()) {
+        bind_ep = listen_socket.local_endpoint();
+      }
+      result.shards_.emplace_back(*ctx, std::move(listen_socket));
+    }
+
+    if (options.steer_by_cpu && result.shards_.size() > 1) {
+      result.attach_cpu_steering();
+    }
+    return result;
+  }
+
+  size_t size() const noexcept { return shards_.size(); }
+  bool empty() const noexcept { return shards_.empty(); }
+
+  acceptor& shard(size_t index) { return shards_.at(index); }
+  const acceptor& shard(size_t index) const { return shards_.at(index); }
+
+  auto begin() noexcept { return shards_.begin(); }
+  auto end() noexcept { return shards_.end(); }
+
+  endpoint local_endpoint() const {
+    if (shards_.empty()) {
+      throw std::runtime_error("sharded_acceptor is not listening");
+    }
+    return shards_.front().native_socket().local_endpoint();
+  }
+
+ private:
+  void attach_cpu_steering() {
+    // A = 当前 CPU；A %= N；返回 A 作为 reuseport 组内的下标
+    sock_filter code[] = {
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0,
+         static_cast<__u32>(SKF_AD_OFF + SKF_AD_CPU)},
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<__u32>(shards_.size())},
+        {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    sock_fprog program{};
+    program.len = static_cast<unsigned short>(std::size(code));
+    program.filter = code;
+
+    // 程序作用于整个 reuseport 组，挂在任意一个成员上即可
+    if (::setsockopt(shards_.front().native_socket().native_handle(),
+                     SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program,
+                     sizeof(program)) == -1) {
+      throw std::system_error(errno, std::system_category(),
+                              "setsockopt(SO_ATTACH_REUSEPORT_CBPF) failed");
+    }
+  }
+
+  std::vector<acceptor> shards_;
+};
+
+}  // namespace xcoro::net
@@ -1,37 +1,68 @@
 #pragma once
 
+#include <fcntl.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
-#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <span>
 #include <stdexcept>
 #include <system_error>
+#include <utility>
+#include <vector>
 
 #include "xcoro/cancellation_token.hpp"
 #include "xcoro/net/buffer.hpp"
+#include "xcoro/net/datagram.hpp"
+#include "xcoro/net/detail/buffer_sequence.hpp"
 #include "xcoro/net/detail/descriptor_state.hpp"
 #include "xcoro/net/detail/fd_ops.hpp"
 #include "xcoro/net/detail/no_sigpipe.hpp"
+#include "xcoro/net/detail/zerocopy.hpp"
 #include "xcoro/net/endpoint.hpp"
 #include "xcoro/net/io_context.hpp"
 
 namespace xcoro::net {
 
+// 转发的数据已经从源端读进中转管道，却没能写给目的端时抛出（目的端出错或等待被取消，
+// 取消时错误码为 ECANCELED）。transferred() 是已经写给目的端的字节数，
+// stranded() 是已经读出、随中转管道一起丢弃的字节数
+class splice_error : public std::system_error {
+ public:
+  splice_error(int error, size_t transferred, size_t stranded)
+      : std::system_error(error, std::system_category(), "splice left data in flight"),
+        transferred_(transferred),
+        stranded_(stranded) {}
+
+  size_t transferred() const noexcept { return transferred_; }
+  size_t stranded() const noexcept { return stranded_; }
+
+ private:
+  size_t transferred_;
+  size_t stranded_;
+};
+
 class socket {
  public:
+  // async_send_fds / async_recv_fds 单条消息最多传递的 fd 数量
+  static constexpr size_t kMaxPassedFds = 64;
+
   socket() noexcept = default;
-  socket(io_context& ctx, int fd) noexcept
-      : state_(detail::make_descriptor_state(ctx, fd)) {}
-  explicit socket(std::shared_ptr<detail::descriptor_state> state) noexcept
-      : state_(std::move(state)) {}
+  // 接管fd的所有权；descriptor_state来自io_context的槽位表，不再单独分配
+  socket(io_context& ctx, int fd) : state_(&ctx.acquire_descriptor(fd)) {}
 
   static socket open_tcp(io_context& ctx, int family = AF_INET) {
     try {
-      return socket{detail::make_descriptor_state(
-          ctx, detail::create_socket(family, SOCK_STREAM, IPPROTO_TCP))};
+      return adopt(ctx, detail::create_socket(family, SOCK_STREAM, IPPROTO_TCP));
     } catch (const std::system_error& error) {
       throw std::system_error(error.code(), "socket(TCP) failed");
     }
@@ -39,18 +70,42 @@ class socket {
 
   static socket open_udp(io_context& ctx, int family = AF_INET) {
     try {
-      return socket{detail::make_descriptor_state(
-          ctx, detail::create_socket(family, SOCK_DGRAM, IPPROTO_UDP))};
+      return adopt(ctx, detail::create_socket(family, SOCK_DGRAM, IPPROTO_UDP));
     } catch (const std::system_error& error) {
       throw std::system_error(error.code(), "socket(UDP) failed");
     }
   }
 
-  socket(socket&&) noexcept = default;
+  // type 为 SOCK_STREAM、SOCK_DGRAM 或 SOCK_SEQPACKET
+  static socket open_unix(io_context& ctx, int type = SOCK_STREAM) {
+    try {
+      return adopt(ctx, detail::create_socket(AF_UNIX, type, 0));
+    } catch (const std::system_error& error) {
+      throw std::system_error(error.code(), "socket(AF_UNIX) failed");
+    }
+  }
+
+  // 一对互相连接的 AF_UNIX socket，常用于父子进程或同进程内的线程间通信
+  static std::pair<socket, socket> pair(io_context& ctx, int type = SOCK_STREAM) {
+    int fds[2] = {-1, -1};
+    detail::create_socket_pair(AF_UNIX, type, 0, fds);
+    socket first;
+    try {
+      first = adopt(ctx, fds[0]);
+    } catch (...) {
+      ::close(fds[1]);
+      throw;
+    }
+    return {std::move(first), adopt(ctx, fds[1])};
+  }
+
+  socket(socket&& other) noexcept
+      : state_(other.state_.exchange(nullptr, std::memory_order_acq_rel)) {}
   socket& operator=(socket&& other) noexcept {
     if (this != &other) {
       close();
-      state_ = std::move(other.state_);
+      state_.store(other.state_.exchange(nullptr, std::memory_order_acq_rel),
+                   std::memory_order_release);
     }
     return *this;
   }
@@ -61,10 +116,14 @@ class socket {
   ~socket() { close(); }
 
   bool is_open() const noexcept {
-    return state_ != nullptr && state_->fd != -1;
+    const auto* state = state_.load(std::memory_order_acquire);
+    return state != nullptr && state->fd != -1;
   }
 
-  int native_handle() const noexcept { return is_open() ? state_->fd : -1; }
+  int native_handle() const noexcept {
+    const auto* state = state_.load(std::memory_order_acquire);
+    return state != nullptr ? state->fd : -1;
+  }
 
   void bind(const endpoint& ep) {
     ensure_open();
@@ -87,16 +146,22 @@ class socket {
     }
   }
 
+  // 可以在另一个线程上调用，用来打断已经挂起在这个 socket 上的读写：它们以 EBADF 结束。
+  // 但不能与正在发起（还没有挂起）的操作并发，否则那个操作可能对已经关闭、
+  // 甚至被内核重新分配的 fd 发起系统调用
   void close() noexcept {
-    if (!is_open()) {
+    auto* state = state_.exchange(nullptr, std::memory_order_acq_rel);
+    if (state == nullptr) {
       return;
     }
 
-    if (state_->ctx != nullptr) {
-      state_->ctx->unregister_descriptor(*state_, EBADF);
+    const int fd = state->fd;
+    io_context* ctx = state->ctx;
+    ctx->unregister_descriptor(*state, EBADF);
+    ctx->release_descriptor(*state);
+    if (fd != -1) {
+      ::close(fd);
     }
-    ::close(state_->fd);
-    state_->fd = -1;
   }
 
   void set_nonblocking(bool on = true) {
@@ -124,6 +189,22 @@ class socket {
                               on ? 1 : 0);
   }
 
+  // 默认情况下，在线程池等调度器上发起的读写会在完成后被投递回原调度器继续执行，
+  // 避免后续计算占用事件循环线程。打开此选项后改为直接在事件循环线程上恢复，
+  // 省掉一次跨线程投递，适合完成后只做少量工作的场景
+  void set_resume_inline(bool on = true) {
+    ensure_open();
+    descriptor().resume_inline = on;
+  }
+
+  // 打开 SO_ZEROCOPY，之后才能使用 async_write_all_zerocopy 的零拷贝路径。
+  // 内核或协议不支持时抛出 std::system_error（通常是 ENOPROTOOPT / EOPNOTSUPP）
+  void set_zerocopy(bool on = true) {
+    ensure_open();
+    detail::set_socket_option(native_handle(), SOL_SOCKET, SO_ZEROCOPY, on ? 1 : 0);
+    descriptor().zerocopy = on;
+  }
+
   task<> async_connect(const endpoint& ep, cancellation_token token = {}) {
     ensure_open();
 
@@ -177,6 +258,34 @@ class socket {
     }
   }
 
+  // 分散读：一次 readv 填充多块缓冲区，返回实际读到的字节数，0 表示对端已关闭
+  task<size_t> async_read_some(std::span<const mutable_buffer> dst,
+                               cancellation_token token = {}) {
+    ensure_open();
+    detail::buffer_cursor<mutable_buffer> cursor{dst};
+    if (cursor.empty()) {
+      co_return 0;
+    }
+
+    iovec iov[detail::kMaxIovecs];
+    const size_t count = cursor.fill(iov, detail::kMaxIovecs);
+    for (;;) {
+      throw_if_cancellation_requested(token);
+      const ssize_t n = ::readv(native_handle(), iov, static_cast<int>(count));
+      if (n >= 0) {
+        co_return static_cast<size_t>(n);
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await context().wait_readable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "readv failed");
+    }
+  }
+
   task<size_t> async_read_exact(mutable_buffer dst, cancellation_token token = {}) {
     ensure_open();
     if (dst.bytes.empty()) {
@@ -237,6 +346,34 @@ class socket {
     }
   }
 
+  // 聚集写：header 和 body 等多块数据通过一次 sendmsg 发出，不需要先拷贝到连续内存
+  task<size_t> async_write_some(std::span<const const_buffer> src,
+                                cancellation_token token = {}) {
+    ensure_open();
+    detail::buffer_cursor<const_buffer> cursor{src};
+    if (cursor.empty()) {
+      co_return 0;
+    }
+
+    iovec iov[detail::kMaxIovecs];
+    const size_t count = cursor.fill(iov, detail::kMaxIovecs);
+    for (;;) {
+      throw_if_cancellation_requested(token);
+      const ssize_t n = detail::writev_no_sigpipe(native_handle(), iov, count);
+      if (n >= 0) {
+        co_return static_cast<size_t>(n);
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await context().wait_writable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "writev failed");
+    }
+  }
+
   task<size_t> async_write_all(const_buffer src, cancellation_token token = {}) {
     ensure_open();
     if (src.bytes.empty()) {
@@ -266,6 +403,410 @@ class socket {
     co_return written;
   }
 
+  // 写完整个缓冲区序列才返回；部分写入后从中断的位置继续，不重复发送已写出的字节
+  task<size_t> async_write_all(std::span<const const_buffer> src,
+                               cancellation_token token = {}) {
+    ensure_open();
+    detail::buffer_cursor<const_buffer> cursor{src};
+    iovec iov[detail::kMaxIovecs];
+    size_t written = 0;
+    while (!cursor.empty()) {
+      throw_if_cancellation_requested(token);
+      const size_t count = cursor.fill(iov, detail::kMaxIovecs);
+      const ssize_t n = detail::writev_no_sigpipe(native_handle(), iov, count);
+      if (n > 0) {
+        cursor.advance(static_cast<size_t>(n));
+        written += static_cast<size_t>(n);
+        continue;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await context().wait_writable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "writev failed");
+    }
+
+    co_return written;
+  }
+
+  // 开启 UDP_GRO：内核可以把同一个流上连续到达的数据报合并后一次交付，
+  // 合并信息通过 datagram::segment_size 返回给 async_recv_batch 的调用方
+  void set_udp_gro(bool on = true) {
+    ensure_open();
+    detail::set_socket_option(native_handle(), SOL_UDP, UDP_GRO, on ? 1 : 0);
+  }
+
+  // 为之后的每次发送设置默认的 GSO 分段大小，0 表示关闭
+  void set_udp_segment(uint16_t segment_size) {
+    ensure_open();
+    detail::set_socket_option(native_handle(), SOL_UDP, UDP_SEGMENT, segment_size);
+  }
+
+  task<size_t> async_send_to(const_buffer src, const endpoint& peer,
+                             cancellation_token token = {}) {
+    ensure_open();
+    for (;;) {
+      throw_if_cancellation_requested(token);
+      const ssize_t n = ::sendto(native_handle(), src.bytes.data(), src.bytes.size(),
+                                 MSG_NOSIGNAL, peer.data(), peer.size());
+      if (n >= 0) {
+        co_return static_cast<size_t>(n);
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await context().wait_writable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "sendto failed");
+    }
+  }
+
+  // 接收一个数据报，发送方地址写入 peer；数据报比 dst 大时超出部分被丢弃
+  task<size_t> async_recv_from(mutable_buffer dst, endpoint& peer,
+                               cancellation_token token = {}) {
+    ensure_open();
+    for (;;) {
+      throw_if_cancellation_requested(token);
+      sockaddr_storage storage{};
+      socklen_t length = sizeof(storage);
+      const ssize_t n = ::recvfrom(native_handle(), dst.bytes.data(), dst.bytes.size(), 0,
+                                   reinterpret_cast<sockaddr*>(&storage), &length);
+      if (n >= 0) {
+        peer = sender_endpoint(storage, length);
+        co_return static_cast<size_t>(n);
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await context().wait_readable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "recvfrom failed");
+    }
+  }
+
+  // 一次 recvmmsg 尽可能多地填充 out，至少收到一个数据报才返回，返回填写的槽位数
+  task<size_t> async_recv_batch(std::span<datagram> out,
+                                cancellation_token token = {}) {
+    ensure_open();
+    if (out.empty()) {
+      co_return 0;
+    }
+
+    const size_t count = std::min(out.size(), kMaxDatagramBatch);
+    datagram_batch batch;
+    for (size_t i = 0; i < count; ++i) {
+      batch.iov[i].iov_base = out[i].buffer.bytes.data();
+      batch.iov[i].iov_len = out[i].buffer.bytes.size();
+    }
+
+    for (;;) {
+      throw_if_cancellation_requested(token);
+      // recvmmsg 会改写长度字段，每次重试前都要重新初始化
+      for (size_t i = 0; i < count; ++i) {
+        auto& header = batch.headers[i].msg_hdr;
+        header = msghdr{};
+        header.msg_name = &batch.addresses[i];
+        header.msg_namelen = sizeof(sockaddr_storage);
+        header.msg_iov = &batch.iov[i];
+        header.msg_iovlen = 1;
+        header.msg_control = batch.control[i];
+        header.msg_controllen = sizeof(batch.control[i]);
+        batch.headers[i].msg_len = 0;
+      }
+
+      const int n = ::recvmmsg(native_handle(), batch.headers, static_cast<unsigned>(count),
+                               0, nullptr);
+      if (n > 0) {
+        for (int i = 0; i < n; ++i) {
+          const auto& header = batch.headers[i].msg_hdr;
+          auto& slot = out[static_cast<size_t>(i)];
+          slot.size = batch.headers[i].msg_len;
+          slot.truncated = (header.msg_flags & MSG_TRUNC) != 0;
+          slot.control_truncated = (header.msg_flags & MSG_CTRUNC) != 0;
+          slot.segment_size = 0;
+          slot.peer = sender_endpoint(batch.addresses[i], header.msg_namelen);
+          for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg != nullptr;
+               cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg)) {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+              int segment = 0;
+              std::memcpy(&segment, CMSG_DATA(cmsg), sizeof(segment));
+              slot.segment_size = static_cast<size_t>(segment);
+            }
+          }
+        }
+        co_return static_cast<size_t>(n);
+      }
+      if (n == -1 && errno == EINTR) {
+        continue;
+      }
+      if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        co_await context().wait_readable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "recvmmsg failed");
+    }
+  }
+
+  // 用 sendmmsg 发送全部消息，部分发送时从下一条继续，返回发送的消息数
+  task<size_t> async_send_batch(std::span<const outgoing_datagram> messages,
+                                cancellation_token token = {}) {
+    ensure_open();
+    // 先整体检查，不合法的消息不会让前面的消息已经发出去
+    for (const auto& message : messages) {
+      check_gso_segment(message);
+    }
+    size_t sent = 0;
+    datagram_batch batch;
+    while (sent < messages.size()) {
+      throw_if_cancellation_requested(token);
+      const size_t count = std::min(messages.size() - sent, kMaxDatagramBatch);
+      for (size_t i = 0; i < count; ++i) {
+        const auto& message = messages[sent + i];
+        batch.iov[i].iov_base = const_cast<std::byte*>(message.buffer.bytes.data());
+        batch.iov[i].iov_len = message.buffer.bytes.size();
+
+        auto& header = batch.headers[i].msg_hdr;
+        header = msghdr{};
+        if (message.peer.size() != 0) {
+          header.msg_name = const_cast<sockaddr*>(message.peer.data());
+          header.msg_namelen = message.peer.size();
+        }
+        header.msg_iov = &batch.iov[i];
+        header.msg_iovlen = 1;
+        if (message.segment_size != 0) {
+          header.msg_control = batch.control[i];
+          header.msg_controllen = CMSG_SPACE(sizeof(uint16_t));
+          cmsghdr* cmsg = CMSG_FIRSTHDR(&header);
+          cmsg->cmsg_level = SOL_UDP;
+          cmsg->cmsg_type = UDP_SEGMENT;
+          cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+          const auto segment = static_cast<uint16_t>(message.segment_size);
+          std::memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+        }
+      }
+
+      const int n = ::sendmmsg(native_handle(), batch.headers, static_cast<unsigned>(count),
+                               MSG_NOSIGNAL);
+      if (n > 0) {
+        sent += static_cast<size_t>(n);
+        continue;
+      }
+      if (n == -1 && errno == EINTR) {
+        continue;
+      }
+      if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        co_await context().wait_writable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(n == -1 ? errno : EIO, std::system_category(),
+                              "sendmmsg failed");
+    }
+    co_return sent;
+  }
+
+  // 通过 AF_UNIX socket 发送数据并附带 SCM_RIGHTS 传递 fds，返回发送的字节数。
+  // fds 只在第一个字节上传递，流式 socket 上 src 不能为空；调用方仍持有自己的 fds
+  task<size_t> async_send_fds(const_buffer src, std::span<const int> fds,
+                              cancellation_token token = {}) {
+    ensure_open();
+    if (fds.size() > kMaxPassedFds) {
+      throw std::invalid_argument("too many file descriptors to pass");
+    }
+
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxPassedFds)];
+    iovec iov{const_cast<std::byte*>(src.bytes.data()), src.bytes.size()};
+    msghdr message{};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    if (!fds.empty()) {
+      message.msg_control = control;
+      message.msg_controllen = CMSG_SPACE(sizeof(int) * fds.size());
+      cmsghdr* cmsg = CMSG_FIRSTHDR(&message);
+      cmsg->cmsg_level = SOL_SOCKET;
+      cmsg->cmsg_type = SCM_RIGHTS;
+      cmsg->cmsg_len = CMSG_LEN(sizeof(int) * fds.size());
+      std::memcpy(CMSG_DATA(cmsg), fds.data(), sizeof(int) * fds.size());
+    }
+
+    for (;;) {
+      throw_if_cancellation_requested(token);
+      const ssize_t n = ::sendmsg(native_handle(), &message, MSG_NOSIGNAL);
+      if (n >= 0) {
+        co_return static_cast<size_t>(n);
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await context().wait_writable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "sendmsg(SCM_RIGHTS) failed");
+    }
+  }
+
+  // 接收数据以及随之传来的 fds，收到的 fds 追加到 fds 末尾并带有 FD_CLOEXEC，
+  // 由调用方负责关闭。返回 0 表示对端已关闭。
+  // 对端一次传来的 fds 超过 kMaxPassedFds 时内核会丢弃多余部分，此时关闭已收到的 fds 并抛出异常
+  task<size_t> async_recv_fds(mutable_buffer dst, std::vector<int>& fds,
+                              cancellation_token token = {}) {
+    ensure_open();
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int) * kMaxPassedFds)];
+    for (;;) {
+      throw_if_cancellation_requested(token);
+      iovec iov{dst.bytes.data(), dst.bytes.size()};
+      msghdr message{};
+      message.msg_iov = &iov;
+      message.msg_iovlen = 1;
+      message.msg_control = control;
+      message.msg_controllen = sizeof(control);
+
+      const ssize_t n = ::recvmsg(native_handle(), &message, MSG_CMSG_CLOEXEC);
+      if (n < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          co_await context().wait_readable(descriptor(), token);
+          continue;
+        }
+        throw std::system_error(errno, std::system_category(), "recvmsg failed");
+      }
+
+      const size_t first = fds.size();
+      for (cmsghdr* cmsg = CMSG_FIRSTHDR(&message); cmsg != nullptr;
+           cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+          continue;
+        }
+        const size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const size_t offset = fds.size();
+        fds.resize(offset + count);
+        std::memcpy(fds.data() + offset, CMSG_DATA(cmsg), count * sizeof(int));
+      }
+
+      if ((message.msg_flags & MSG_CTRUNC) != 0) {
+        for (size_t i = first; i < fds.size(); ++i) {
+          ::close(fds[i]);
+        }
+        fds.resize(first);
+        throw std::system_error(EMSGSIZE, std::system_category(),
+                                "recvmsg truncated passed file descriptors");
+      }
+      co_return static_cast<size_t>(n);
+    }
+  }
+
+  // 以 MSG_ZEROCOPY 发送整个缓冲区：内核直接引用调用方的页而不拷贝，
+  // 等错误队列里收到覆盖全部发送的完成通知之后才返回，此后调用方才可以复用或释放 src。
+  // 没有调用 set_zerocopy 时退化为普通的 async_write_all。
+  // 只适合大块数据，小消息的通知开销会超过省下的拷贝
+  task<size_t> async_write_all_zerocopy(const_buffer src,
+                                        cancellation_token token = {}) {
+    ensure_open();
+    if (!descriptor().zerocopy) {
+      co_return co_await async_write_all(src, std::move(token));
+    }
+
+    auto& state = descriptor();
+    size_t written = 0;
+    while (written < src.bytes.size()) {
+      throw_if_cancellation_requested(token);
+      const ssize_t n = ::send(native_handle(), src.bytes.data() + written,
+                               src.bytes.size() - written,
+                               MSG_ZEROCOPY | MSG_NOSIGNAL);
+      if (n >= 0) {
+        // 每次成功的零拷贝 send 都占用一个序号，哪怕内核最终退化成了拷贝
+        ++state.zerocopy_next;
+        written += static_cast<size_t>(n);
+        continue;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await context().wait_writable(state, token);
+        continue;
+      }
+      // 未完成的通知占满了 optmem 配额，先收掉一部分完成通知再继续
+      if (errno == ENOBUFS &&
+          !detail::zerocopy_reached(state.zerocopy_completed, state.zerocopy_next)) {
+        co_await wait_zerocopy_progress(token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "send(MSG_ZEROCOPY) failed");
+    }
+
+    while (!detail::zerocopy_reached(state.zerocopy_completed, state.zerocopy_next)) {
+      co_await wait_zerocopy_progress(token);
+    }
+    co_return written;
+  }
+
+  // 把文件 [offset, offset + count) 直接从页缓存发到 socket，数据不经过用户态。
+  // 文件提前结束时返回实际发送的字节数
+  task<size_t> async_sendfile(int file_fd, off_t offset, size_t count,
+                              cancellation_token token = {}) {
+    ensure_open();
+    size_t sent = 0;
+    while (sent < count) {
+      throw_if_cancellation_requested(token);
+      const ssize_t n = detail::call_without_sigpipe([&] {
+        return ::sendfile(native_handle(), file_fd, &offset, count - sent);
+      });
+      if (n > 0) {
+        sent += static_cast<size_t>(n);
+        continue;
+      }
+      if (n == 0) {
+        break;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        co_await context().wait_writable(descriptor(), token);
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "sendfile failed");
+    }
+    co_return sent;
+  }
+
+  // 把最多 count 字节从当前 socket 转发到 dst，经由当前线程缓存的中转管道在内核中完成，
+  // 适合代理场景。源端到达 EOF 时返回已经转发的字节数。
+  // 数据已经读进中转管道、却因为 dst 出错或等待被取消而没能写出时抛出 splice_error
+  task<size_t> async_splice(socket& dst, size_t count, cancellation_token token = {}) {
+    ensure_open();
+    dst.ensure_open();
+    co_return co_await splice_between(descriptor(), false, dst.descriptor(), false, count,
+                                      std::move(token));
+  }
+
+  // 转发到任意 fd。dst_fd 是管道时直接 splice，不经过中转管道；
+  // 其它 fd 必须是非阻塞的，并且不能同时被某个 socket 接管（epoll 注册冲突时抛出 EEXIST）
+  task<size_t> async_splice(int dst_fd, size_t count, cancellation_token token = {}) {
+    ensure_open();
+    io_context::temporary_descriptor target{&context(), dst_fd};
+    co_return co_await splice_between(descriptor(), false, target.state(),
+                                      detail::is_pipe(dst_fd), count, std::move(token));
+  }
+
+  // 从 src_fd 转发最多 count 字节到当前 socket，对 src_fd 的要求同上
+  task<size_t> async_splice_from(int src_fd, size_t count, cancellation_token token = {}) {
+    ensure_open();
+    io_context::temporary_descriptor source{&context(), src_fd};
+    co_return co_await splice_between(source.state(), detail::is_pipe(src_fd), descriptor(),
+                                      false, count, std::move(token));
+  }
+
   endpoint local_endpoint() const {
     ensure_open();
     sockaddr_storage storage{};
@@ -293,20 +834,185 @@ class socket {
   }
 
  private:
+  static constexpr size_t kMaxDatagramBatch = 64;
+
+  // 每条消息的辅助数据空间：UDP_GRO 的 int，加上调用方可能开启的 IPv6 包信息和
+  // SO_TIMESTAMPING（三个 timespec）。仍然不够时由 datagram::control_truncated 报告
+  static constexpr size_t kDatagramControlSize = CMSG_SPACE(sizeof(int)) +
+                                                 CMSG_SPACE(sizeof(in6_pktinfo)) +
+                                                 CMSG_SPACE(3 * sizeof(timespec));
+
+  // recvmmsg/sendmmsg 需要的各个数组，放在协程帧里随批量操作一起分配
+  struct datagram_batch {
+    mmsghdr headers[kMaxDatagramBatch];
+    iovec iov[kMaxDatagramBatch];
+    sockaddr_storage addresses[kMaxDatagramBatch];
+    alignas(cmsghdr) char control[kMaxDatagramBatch][kDatagramControlSize];
+  };
+
+  // UDP_SEGMENT 的值是 uint16_t，直接转换会把超过 65535 的值静默截断
+  static void check_gso_segment(const outgoing_datagram& message) {
+    if (message.segment_size == 0) {
+      return;
+    }
+    if (message.segment_size > UINT16_MAX) {
+      throw std::invalid_argument("outgoing_datagram segment_size exceeds 65535");
+    }
+    const size_t segments =
+        (message.buffer.bytes.size() + message.segment_size - 1) / message.segment_size;
+    if (segments > kMaxGsoSegments) {
+      throw std::invalid_argument("outgoing_datagram splits into too many GSO segments");
+    }
+  }
+
   friend class acceptor;
+  friend class write_queue;
+
+  // 构造失败时由这里负责关闭刚创建的fd，避免泄漏
+  static socket adopt(io_context& ctx, int fd) {
+    try {
+      return socket{ctx, fd};
+    } catch (...) {
+      ::close(fd);
+      throw;
+    }
+  }
+
+  // 未 bind 的 AF_UNIX 数据报发送方没有地址，内核返回的长度为 0，此时构造一个未命名的 AF_UNIX 地址
+  static endpoint sender_endpoint(sockaddr_storage& storage, socklen_t length) {
+    if (length == 0) {
+      storage.ss_family = AF_UNIX;
+      length = sizeof(sa_family_t);
+    }
+    return endpoint::from_sockaddr(reinterpret_cast<const sockaddr*>(&storage), length);
+  }
+
+  // 收取错误队列里已有的完成通知；一条都没有时等待下一次 EPOLLERR
+  task<> wait_zerocopy_progress(cancellation_token& token) {
+    auto& state = descriptor();
+    const std::uint32_t before = state.zerocopy_completed;
+    detail::drain_zerocopy_completions(state);
+    if (state.zerocopy_completed == before) {
+      co_await context().wait_error(state, token);
+      detail::drain_zerocopy_completions(state);
+    }
+  }
 
   io_context& context() const {
-    if (state_ == nullptr || state_->ctx == nullptr) {
+    const auto* state = state_.load(std::memory_order_acquire);
+    if (state == nullptr || state->ctx == nullptr) {
       throw std::runtime_error("socket is not bound to io_context");
     }
-    return *state_->ctx;
+    return *state->ctx;
   }
 
   detail::descriptor_state& descriptor() const {
-    if (state_ == nullptr) {
+    auto* state = state_.load(std::memory_order_acquire);
+    if (state == nullptr) {
       throw std::runtime_error("socket has no descriptor state");
     }
-    return *state_;
+    return *state;
+  }
+
+  static constexpr size_t kSpliceChunk = 64 * 1024;
+
+  static ssize_t splice_once(int in, int out, size_t count) noexcept {
+    return detail::call_without_sigpipe([&] {
+      return ::splice(in, nullptr, out, nullptr, count, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    });
+  }
+
+  // 两端都不是管道时经由中转管道：每轮先从 src 读进管道，全部写给 dst 之后再读下一轮
+  static task<size_t> splice_between(detail::descriptor_state& src, bool src_is_pipe,
+                                     detail::descriptor_state& dst, bool dst_is_pipe,
+                                     size_t count, cancellation_token token) {
+    if (src_is_pipe || dst_is_pipe) {
+      co_return co_await splice_direct(src, dst, count, std::move(token));
+    }
+
+    detail::pipe_lease pipe;
+    size_t moved = 0;
+    while (moved < count) {
+      throw_if_cancellation_requested(token);
+      // 每轮开始时管道是空的，所以这里的 EAGAIN 只可能来自源端
+      const ssize_t in =
+          splice_once(src.fd, pipe.write_fd(), std::min(kSpliceChunk, count - moved));
+      if (in == 0) {
+        break;
+      }
+      if (in < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+          co_await src.ctx->wait_readable(src, token);
+          continue;
+        }
+        throw std::system_error(errno, std::system_category(), "splice failed");
+      }
+
+      // 这一轮读出的数据已经离开源端，写不出去时要把丢失的字节数报告给调用方
+      pipe.set_drained(false);
+      size_t pending = static_cast<size_t>(in);
+      try {
+        while (pending > 0) {
+          const ssize_t out = splice_once(pipe.read_fd(), dst.fd, pending);
+          if (out > 0) {
+            pending -= static_cast<size_t>(out);
+            continue;
+          }
+          if (out < 0 && errno == EINTR) {
+            continue;
+          }
+          if (out < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            co_await dst.ctx->wait_writable(dst, token);
+            continue;
+          }
+          throw std::system_error(out < 0 ? errno : EPIPE, std::system_category(),
+                                  "splice failed");
+        }
+      } catch (const operation_cancelled&) {
+        throw splice_error(ECANCELED, moved + (static_cast<size_t>(in) - pending), pending);
+      } catch (const std::system_error& error) {
+        throw splice_error(error.code().value(), moved + (static_cast<size_t>(in) - pending),
+                           pending);
+      }
+      pipe.set_drained(true);
+      moved += static_cast<size_t>(in);
+    }
+    co_return moved;
+  }
+
+  // 一端是管道：直接 splice，数据不会滞留在中间
+  static task<size_t> splice_direct(detail::descriptor_state& src,
+                                    detail::descriptor_state& dst, size_t count,
+                                    cancellation_token token) {
+    size_t moved = 0;
+    while (moved < count) {
+      throw_if_cancellation_requested(token);
+      const ssize_t n = splice_once(src.fd, dst.fd, std::min(kSpliceChunk, count - moved));
+      if (n > 0) {
+        moved += static_cast<size_t>(n);
+        continue;
+      }
+      if (n == 0) {
+        break;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        // EAGAIN 不区分是哪一端没有就绪：源端不可读就等源端，否则等目的端可写
+        if (!detail::poll_ready(src.fd, POLLIN)) {
+          co_await src.ctx->wait_readable(src, token);
+        } else {
+          co_await dst.ctx->wait_writable(dst, token);
+        }
+        continue;
+      }
+      throw std::system_error(errno, std::system_category(), "splice failed");
+    }
+    co_return moved;
   }
 
   void ensure_open() const {
@@ -322,7 +1028,8 @@ class socket {
     }
   }
 
-  std::shared_ptr<detail::descriptor_state> state_;
+  // 指向io_context槽位表，不拥有。close 可能在别的线程上执行，所以用原子指针
+  std::atomic<detail::descriptor_state*> state_{nullptr};
 };
 
 }  // namespace xcoro::net
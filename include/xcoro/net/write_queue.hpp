@@ -0,0 +1,174 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "xcoro/cancellation_token.hpp"
+#include "xcoro/executor.hpp"
+#include "xcoro/net/buffer.hpp"
+#include "xcoro/net/socket.hpp"
+#include "xcoro/task.hpp"
+
+namespace xcoro::net {
+
+// 多个协程共享一个 socket 写方向时使用的写队列。
+// 第一个到达的写者成为 leader：先在自己的调度器上让出一次，让同一轮里其它写者把消息挂进队列，
+// 再把队列里的全部消息合并成一次 writev 发出（自动 cork）。一批写完后按入队顺序恢复写者，
+// 如果期间又有新消息到达，就把 leader 身份交给其中第一个写者继续发送。
+// 同一时刻只有 leader 在 socket 上等待可写，避免了多个协程同时等待同一方向的限制
+class write_queue {
+ public:
+  explicit write_queue(socket& sock) noexcept : socket_(&sock) {}
+
+  write_queue(const write_queue&) = delete;
+  write_queue& operator=(const write_queue&) = delete;
+
+  // 消息写完（或整批失败）后返回。token 只在入队前检查，一旦入队消息就会被发送
+  task<> async_write(const_buffer message, cancellation_token token = {}) {
+    const const_buffer buffers[1] = {message};
+    co_await async_write(std::span<const const_buffer>{buffers}, std::move(token));
+  }
+
+  task<> async_write(std::span<const const_buffer> message,
+                     cancellation_token token = {}) {
+    throw_if_cancellation_requested(token);
+
+    write_op op{message};
+    const bool leader = co_await enqueue_awaiter{this, &op};
+    if (leader) {
+      co_await flush(op.executor);
+    }
+    if (op.error) {
+      std::rethrow_exception(op.error);
+    }
+  }
+
+ private:
+  struct write_op {
+    std::span<const const_buffer> buffers{};
+    std::coroutine_handle<> handle{};
+    executor_ref executor{};
+    std::exception_ptr error{};
+    bool leader = false;
+    write_op* next = nullptr;
+  };
+
+  // 在 await_suspend 里持锁入队，保证 leader 取走这个节点时句柄已经就绪
+  struct enqueue_awaiter {
+    write_queue* queue;
+    write_op* op;
+
+    bool await_ready() const noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      op->handle = handle;
+      op->executor = current_executor();
+      std::lock_guard<std::mutex> lock(queue->mutex_);
+      queue->push(op);
+      if (!queue->flushing_) {
+        queue->flushing_ = true;
+        op->leader = true;
+        return false;
+      }
+      return true;
+    }
+
+    bool await_resume() const noexcept { return op->leader; }
+  };
+
+  // leader 让出一次时投递回自己所在的调度器，而不是迁移到 io_context 线程上；
+  // 没有调度器（或者调度器已停止）时才退回到 io_context
+  struct yield_awaiter {
+    io_context* ctx;
+    executor_ref executor;
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend(std::coroutine_handle<> handle) noexcept {
+      if (!executor.post(handle)) {
+        ctx->post(handle);
+      }
+    }
+
+    void await_resume() const noexcept {}
+  };
+
+  void push(write_op* op) noexcept {
+    if (tail_ == nullptr) {
+      head_ = op;
+    } else {
+      tail_->next = op;
+    }
+    tail_ = op;
+  }
+
+  task<> flush(executor_ref executor) {
+    // 让出一次，同一轮里的其它写者可以先入队，随后合并发送
+    co_await yield_awaiter{&socket_->context(), executor};
+
+    write_op* batch = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      batch = std::exchange(head_, nullptr);
+      tail_ = nullptr;
+    }
+
+    gathered_.clear();
+    for (write_op* op = batch; op != nullptr; op = op->next) {
+      gathered_.insert(gathered_.end(), op->buffers.begin(), op->buffers.end());
+    }
+
+    std::exception_ptr error;
+    try {
+      co_await socket_->async_write_all(gathered_);
+    } catch (...) {
+      error = std::current_exception();
+    }
+
+    // 先决定下一任 leader 再恢复本批写者：恢复之后节点所在的协程帧可能已经销毁。
+    // 新 leader 的消息留在队首，与之后到达的消息合并成下一批
+    write_op* next_leader = nullptr;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      next_leader = head_;
+      if (next_leader != nullptr) {
+        next_leader->leader = true;
+      } else {
+        flushing_ = false;
+      }
+    }
+
+    write_op* self = batch;
+    for (write_op* op = batch->next; op != nullptr;) {
+      write_op* next = op->next;
+      op->error = error;
+      resume(op);
+      op = next;
+    }
+    self->error = error;
+    if (next_leader != nullptr) {
+      resume(next_leader);
+    }
+  }
+
+  static void resume(write_op* op) noexcept {
+    if (!op->executor.post(op->handle)) {
+      op->handle.resume();
+    }
+  }
+
+  socket* socket_;
+  std::mutex mutex_;
+  write_op* head_ = nullptr;
+  write_op* tail_ = nullptr;
+  bool flushing_ = false;
+  // 只有 leader 访问，复用容量避免每批都分配
+  std::vector<const_buffer> gathered_;
+};
+
+}  // namespace xcoro::net
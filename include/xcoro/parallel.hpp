@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+#include "xcoro/awaitable_traits.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+#include "xcoro/when_all.hpp"
+
+namespace xcoro {
+
+namespace detail {
+
+// 没有指定粒度时，每个 worker 大约分到 8 块，块数多于线程数，窃取才能把负载摊平
+inline size_t parallel_grain(const thread_pool& pool, size_t size, size_t grain,
+                             size_t min_grain) noexcept {
+  if (grain != 0) {
+    return grain;
+  }
+  const size_t chunks = std::max<size_t>(pool.thread_count(), 1) * 8;
+  return std::max(min_grain, (size + chunks - 1) / chunks);
+}
+
+// 排序的叶子太小时协程帧的开销会超过排序本身
+inline constexpr size_t kMinSortGrain = 1024;
+
+template <typename Awaitable>
+task<awaiter_result_t<Awaitable>> run_on(thread_pool& pool, Awaitable awaitable) {
+  co_await pool.schedule();
+  co_return co_await std::move(awaitable);
+}
+
+// 递归二分：右半边投递到当前 worker 的本地队列，空闲 worker 从队列另一端窃取，
+// 拿到的总是最早放进去、也就是最大的一块；左半边在当前线程上直接继续拆分
+template <typename Fn>
+task<> parallel_for_split(thread_pool& pool, size_t first, size_t last, size_t grain, Fn& fn) {
+  if (last - first <= grain) {
+    for (; first != last; ++first) {
+      fn(first);
+    }
+    co_return;
+  }
+  const size_t mid = first + (last - first) / 2;
+  co_await when_all(run_on(pool, parallel_for_split(pool, mid, last, grain, fn)),
+                    parallel_for_split(pool, first, mid, grain, fn));
+}
+
+// count 至少为 1；每一块从自己的第一个元素开始累积，合并时保持左右顺序
+template <typename T, typename It, typename Op>
+task<T> parallel_reduce_split(thread_pool& pool, It first, size_t count, size_t grain, Op& op) {
+  using difference = std::iter_difference_t<It>;
+  if (count <= grain) {
+    T acc(first[0]);
+    for (size_t i = 1; i < count; ++i) {
+      acc = op(std::move(acc), first[static_cast<difference>(i)]);
+    }
+    co_return acc;
+  }
+  const size_t half = count / 2;
+  auto [right, left] = co_await when_all(
+      run_on(pool, parallel_reduce_split<T>(pool, first + static_cast<difference>(half),
+                                            count - half, grain, op)),
+      parallel_reduce_split<T>(pool, first, half, grain, op));
+  co_return op(std::move(left), std::move(right));
+}
+
+// 两半分别排好序后原地归并
+template <typename It, typename Comp>
+task<> parallel_sort_split(thread_pool& pool, It first, It last, size_t grain, Comp& comp) {
+  if (static_cast<size_t>(last - first) <= grain) {
+    std::ranges::sort(first, last, comp);
+    co_return;
+  }
+  const It mid = first + (last - first) / 2;
+  co_await when_all(run_on(pool, parallel_sort_split(pool, mid, last, grain, comp)),
+                    parallel_sort_split(pool, first, mid, grain, comp));
+  std::ranges::inplace_merge(first, mid, last, comp);
+}
+
+template <typename Fn>
+task<> parallel_for_indices(thread_pool& pool, size_t first, size_t last, size_t grain, Fn fn) {
+  if (first >= last) {
+    co_return;
+  }
+  grain = parallel_grain(pool, last - first, grain, 1);
+  co_await pool.schedule();
+  co_await parallel_for_split(pool, first, last, grain, fn);
+}
+
+template <typename View, typename Fn>
+task<> parallel_for_each_impl(thread_pool& pool, View view, Fn fn, size_t grain) {
+  using difference = std::ranges::range_difference_t<View>;
+  auto first = std::ranges::begin(view);
+  co_await parallel_for_indices(pool, 0, std::ranges::size(view), grain,
+                                [&](size_t i) { fn(first[static_cast<difference>(i)]); });
+}
+
+template <typename View, typename Out, typename Fn>
+task<> parallel_transform_impl(thread_pool& pool, View view, Out out, Fn fn, size_t grain) {
+  using difference = std::ranges::range_difference_t<View>;
+  using out_difference = std::iter_difference_t<Out>;
+  auto first = std::ranges::begin(view);
+  co_await parallel_for_indices(pool, 0, std::ranges::size(view), grain, [&](size_t i) {
+    out[static_cast<out_difference>(i)] = fn(first[static_cast<difference>(i)]);
+  });
+}
+
+template <typename View, typename T, typename Op>
+task<T> parallel_reduce_impl(thread_pool& pool, View view, T init, Op op, size_t grain) {
+  const size_t size = std::ranges::size(view);
+  if (size == 0) {
+    co_return init;
+  }
+  grain = parallel_grain(pool, size, grain, 1);
+  co_await pool.schedule();
+  T total = co_await parallel_reduce_split<T>(pool, std::ranges::begin(view), size, grain, op);
+  co_return op(std::move(init), std::move(total));
+}
+
+template <typename View, typename Comp>
+task<> parallel_sort_impl(thread_pool& pool, View view, Comp comp, size_t grain) {
+  const size_t size = std::ranges::size(view);
+  if (size < 2) {
+    co_return;
+  }
+  grain = parallel_grain(pool, size, grain, kMinSortGrain);
+  co_await pool.schedule();
+  auto first = std::ranges::begin(view);
+  const auto last = first + static_cast<std::ranges::range_difference_t<View>>(size);
+  co_await parallel_sort_split(pool, first, last, grain, comp);
+}
+
+}  // namespace detail
+
+// 对 [first, last) 中的每个下标调用 fn(i)，在 pool 上递归拆分并行执行。
+// grain 是一块最多包含的下标数，0 表示按线程数自动选择；fn 很轻时应当调大，
+// 让每一块的工作量远大于一次投递的开销。
+// 所有块都执行完之后才返回，某一块抛出的异常在那时重新抛出；返回时位于 pool 的某个 worker 上
+template <typename Fn>
+task<> parallel_for(thread_pool& pool, size_t first, size_t last, Fn fn, size_t grain = 0) {
+  return detail::parallel_for_indices(pool, first, last, grain, std::move(fn));
+}
+
+// 对 range 的每个元素调用 fn(item)。右值 range 被移动进返回的 task，左值 range 只保存引用
+template <std::ranges::random_access_range Range, typename Fn>
+  requires std::ranges::sized_range<Range> && std::ranges::viewable_range<Range>
+task<> parallel_for(thread_pool& pool, Range&& range, Fn fn, size_t grain = 0) {
+  return detail::parallel_for_each_impl(pool, std::views::all(std::forward<Range>(range)),
+                                        std::move(fn), grain);
+}
+
+// out[i] = fn(range[i])。out 指向的空间至少要有 size(range) 个元素
+template <std::ranges::random_access_range Range, std::random_access_iterator Out, typename Fn>
+  requires std::ranges::sized_range<Range> && std::ranges::viewable_range<Range>
+task<> parallel_transform(thread_pool& pool, Range&& range, Out out, Fn fn, size_t grain = 0) {
+  return detail::parallel_transform_impl(pool, std::views::all(std::forward<Range>(range)), out,
+                                         std::move(fn), grain);
+}
+
+// 用 op 归约 range，结果是 op(init, 所有元素按顺序归约的值)。
+// 和 std::reduce 一样要求 op 满足结合律，但各块按原来的左右顺序合并，不要求交换律。
+// op 需要接受 (T, 元素) 和 (T, T) 两种参数
+template <std::ranges::random_access_range Range, typename T, typename Op = std::plus<>>
+  requires std::ranges::sized_range<Range> && std::ranges::viewable_range<Range>
+task<T> parallel_reduce(thread_pool& pool, Range&& range, T init, Op op = {}, size_t grain = 0) {
+  return detail::parallel_reduce_impl(pool, std::views::all(std::forward<Range>(range)),
+                                      std::move(init), std::move(op), grain);
+}
+
+// 并行归并排序：叶子块用 std::ranges::sort，然后逐层原地归并。不是稳定排序
+template <std::ranges::random_access_range Range, typename Comp = std::ranges::less>
+  requires std::ranges::sized_range<Range> && std::ranges::viewable_range<Range> &&
+           std::sortable<std::ranges::iterator_t<Range>, Comp>
+task<> parallel_sort(thread_pool& pool, Range&& range, Comp comp = {}, size_t grain = 0) {
+  return detail::parallel_sort_impl(pool, std::views::all(std::forward<Range>(range)),
+                                    std::move(comp), grain);
+}
+
+}  // namespace xcoro
@@ -0,0 +1,339 @@
+#pragma once
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+
+#include "xcoro/cancellation_registration.hpp"
+#include "xcoro/cancellation_token.hpp"
+#include "xcoro/executor.hpp"
+
+namespace xcoro {
+
+// 协程读写锁：多个读者可以同时持有共享锁，写者独占。
+// 写者优先：只要有写者在排队，新来的读者就排在它后面，避免写者饿死。
+// 等待者按到达顺序排队，写者释放锁后队首连续的一批读者会被一次性唤醒。
+// 被唤醒的等待者投递回它挂起时所在的调度器，不在释放锁的线程上依次执行
+class shared_mutex {
+ public:
+  shared_mutex() = default;
+  shared_mutex(const shared_mutex&) = delete;
+  shared_mutex& operator=(const shared_mutex&) = delete;
+
+  bool try_lock() noexcept {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return try_acquire(true);
+  }
+
+  bool try_lock_shared() noexcept {
+    std::lock_guard<std::mutex> guard(mutex_);
+    return try_acquire(false);
+  }
+
+  void unlock() noexcept {
+    ready_list ready;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      writer_ = false;
+      dispatch(ready);
+    }
+    wake(ready);
+  }
+
+  void unlock_shared() noexcept {
+    ready_list ready;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      if (--readers_ == 0) {
+        dispatch(ready);
+      }
+    }
+    wake(ready);
+  }
+
+ private:
+  struct waiter_state {
+    enum class suspend_state : std::uint8_t {
+      waiting_await_suspend,
+      suspended,
+      wake_requested,
+    };
+
+    std::coroutine_handle<> handle{};
+    executor_ref executor{};
+    bool exclusive = false;
+    // 等待队列的链接，受 shared_mutex::mutex_ 保护；出队后 next 用来串起待恢复的等待者
+    waiter_state* prev = nullptr;
+    waiter_state* next = nullptr;
+    bool queued = false;
+    std::atomic<bool> resumed{false};
+    std::atomic<bool> cancelled{false};
+    std::atomic<suspend_state> suspend_phase{suspend_state::waiting_await_suspend};
+
+    bool try_mark_resumed() noexcept {
+      return !resumed.exchange(true, std::memory_order_acq_rel);
+    }
+
+    bool try_mark_suspended() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      return suspend_phase.compare_exchange_strong(expected, suspend_state::suspended,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_acquire);
+    }
+
+    bool should_resume_now() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      if (suspend_phase.compare_exchange_strong(expected, suspend_state::wake_requested,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+        return false;
+      }
+      return expected == suspend_state::suspended;
+    }
+  };
+
+  // 在锁内收集、锁外恢复的等待者，按出队的顺序恢复
+  struct ready_list {
+    waiter_state* head = nullptr;
+    waiter_state* tail = nullptr;
+
+    void push_back(waiter_state* waiter) noexcept {
+      waiter->next = nullptr;
+      if (tail == nullptr) {
+        head = waiter;
+      } else {
+        tail->next = waiter;
+      }
+      tail = waiter;
+    }
+  };
+
+ public:
+  // 等待节点就在 awaiter 里，取消回调只引用 awaiter：awaiter 析构时先注销回调
+  // （正在别的线程上执行的回调会被等待），再把仍在队列里的节点摘掉
+  struct awaiter {
+    awaiter(shared_mutex& m, bool exclusive, cancellation_token token = {}) noexcept
+        : mutex_(m), exclusive_(exclusive), token_(std::move(token)) {}
+
+    // 只能在开始等待之前移动，此时节点还没有被使用
+    awaiter(awaiter&& other) noexcept
+        : mutex_(other.mutex_), exclusive_(other.exclusive_), token_(std::move(other.token_)) {}
+    awaiter& operator=(awaiter&&) = delete;
+
+    ~awaiter() {
+      registration_.deregister();
+      // 协程在等待期间被销毁，节点可能还在等待队列里
+      if (waiting_) {
+        mutex_.abandon_waiter(node_);
+      }
+    }
+
+    bool await_ready() noexcept {
+      if (token_.can_be_cancelled() && token_.is_cancellation_requested()) {
+        cancelled_immediate_ = true;
+        return true;
+      }
+      return exclusive_ ? mutex_.try_lock() : mutex_.try_lock_shared();
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      if (token_.can_be_cancelled() && token_.is_cancellation_requested()) {
+        cancelled_immediate_ = true;
+        return false;
+      }
+
+      node_.handle = handle;
+      node_.executor = current_executor();
+      node_.exclusive = exclusive_;
+      if (!mutex_.enqueue_waiter(node_)) {
+        return false;  // 入队前锁已经可用，直接继续执行
+      }
+
+      // 节点已经入队，在锁外注册取消回调（回调可能立即执行并需要加锁），然后尝试挂起
+      waiting_ = true;
+      if (token_.can_be_cancelled()) {
+        registration_ = cancellation_registration(
+            token_, [this]() noexcept { mutex_.cancel_waiter(node_); });
+      }
+      return node_.try_mark_suspended();
+    }
+
+    // 恢复之后先注销取消回调，再检查是否因取消而结束
+    void await_resume() {
+      waiting_ = false;
+      registration_.deregister();
+      if (cancelled_immediate_ || node_.cancelled.load(std::memory_order_acquire)) {
+        throw operation_cancelled{};
+      }
+    }
+
+   private:
+    shared_mutex& mutex_;
+    bool exclusive_;
+    cancellation_token token_;
+    cancellation_registration registration_;
+    waiter_state node_;
+    bool waiting_ = false;
+    bool cancelled_immediate_ = false;
+  };
+
+  auto lock() noexcept { return awaiter{*this, true}; }
+  auto lock(cancellation_token token) noexcept { return awaiter{*this, true, std::move(token)}; }
+
+  auto lock_shared() noexcept { return awaiter{*this, false}; }
+  auto lock_shared(cancellation_token token) noexcept {
+    return awaiter{*this, false, std::move(token)};
+  }
+
+ private:
+  // 调用方持有 mutex_。有写者排队时读者不能插队
+  bool try_acquire(bool exclusive) noexcept {
+    if (exclusive) {
+      if (writer_ || readers_ != 0 || head_ != nullptr) {
+        return false;
+      }
+      writer_ = true;
+      return true;
+    }
+    if (writer_ || waiting_writers_ != 0) {
+      return false;
+    }
+    ++readers_;
+    return true;
+  }
+
+  bool enqueue_waiter(waiter_state& state) noexcept {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (try_acquire(state.exclusive)) {
+      return false;
+    }
+
+    state.prev = tail_;
+    state.next = nullptr;
+    if (tail_ == nullptr) {
+      head_ = &state;
+    } else {
+      tail_->next = &state;
+    }
+    tail_ = &state;
+    state.queued = true;
+    if (state.exclusive) {
+      ++waiting_writers_;
+    }
+    return true;
+  }
+
+  void unlink(waiter_state& state) noexcept {
+    if (state.prev == nullptr) {
+      head_ = state.next;
+    } else {
+      state.prev->next = state.next;
+    }
+    if (state.next == nullptr) {
+      tail_ = state.prev;
+    } else {
+      state.next->prev = state.prev;
+    }
+    state.prev = state.next = nullptr;
+    state.queued = false;
+    if (state.exclusive) {
+      --waiting_writers_;
+    }
+  }
+
+  // 调用方持有 mutex_。锁空闲时把它交给队首的写者，或者交给队首连续的一批读者
+  void dispatch(ready_list& ready) noexcept {
+    while (head_ != nullptr && !writer_) {
+      waiter_state& state = *head_;
+      // 写者要等现有读者全部释放；读者可以与现有读者并存
+      if (state.exclusive && readers_ != 0) {
+        return;
+      }
+
+      unlink(state);
+      // 正在被取消的等待者不接手锁，由取消回调负责恢复它
+      if (!state.try_mark_resumed()) {
+        continue;
+      }
+      if (state.exclusive) {
+        writer_ = true;
+      } else {
+        ++readers_;
+      }
+      ready.push_back(&state);
+    }
+  }
+
+  void cancel_waiter(waiter_state& state) noexcept {
+    if (!state.try_mark_resumed()) {
+      return;
+    }
+    state.cancelled.store(true, std::memory_order_release);
+
+    ready_list ready;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      remove_locked(state, ready);
+    }
+    wake(ready);
+
+    if (state.should_resume_now()) {
+      resume(state);
+    }
+  }
+
+  void abandon_waiter(waiter_state& state) noexcept {
+    ready_list ready;
+    {
+      std::lock_guard<std::mutex> guard(mutex_);
+      remove_locked(state, ready);
+    }
+    wake(ready);
+  }
+
+  // 调用方持有 mutex_。把还在队列里的节点摘掉；排队的写者挡住了后面的读者，
+  // 它离开后可能可以放行
+  void remove_locked(waiter_state& state, ready_list& ready) noexcept {
+    if (!state.queued) {
+      return;
+    }
+    const bool was_head = head_ == &state;
+    unlink(state);
+    if (was_head || state.exclusive) {
+      dispatch(ready);
+    }
+  }
+
+  // 有调度器时投递回等待者挂起时所在的调度器；没有调度器（例如 sync_wait 线程）
+  // 或调度器已停止时才在当前线程直接恢复
+  static void resume(waiter_state& waiter) noexcept {
+    const auto handle = waiter.handle;
+    const executor_ref executor = waiter.executor;
+    if (!executor.post(handle)) {
+      handle.resume();
+    }
+  }
+
+  // 在锁外恢复一串等待者。节点一旦交出就可能被销毁，先读出 next
+  static void wake(const ready_list& ready) noexcept {
+    for (waiter_state* waiter = ready.head; waiter != nullptr;) {
+      waiter_state* next = waiter->next;
+      if (waiter->should_resume_now()) {
+        resume(*waiter);
+      }
+      waiter = next;
+    }
+  }
+
+  std::mutex mutex_;
+  bool writer_ = false;
+  size_t readers_ = 0;
+  size_t waiting_writers_ = 0;
+  waiter_state* head_ = nullptr;
+  waiter_state* tail_ = nullptr;
+};
+
+}  // namespace xcoro
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <span>
+#include <utility>
+#include <vector>
+
+#include "xcoro/channel.hpp"
+#include "xcoro/executor.hpp"
+
+namespace xcoro {
+
+// 单生产者单消费者的协程通道，用于固定在两个线程之间的流水线阶段。
+// 环形缓冲区无锁：生产者只写 tail_，消费者只写 head_，两边各自缓存对方的下标，
+// 只有缓存显示满/空时才去读对方的原子变量。两组下标放在不同的缓存行上避免伪共享。
+// 只有在一方真正挂起时才需要唤醒：挂起方把句柄存进等待槽后再检查一次条件，
+// 另一方发布数据后检查等待槽，用一次 exchange 决定由谁恢复协程。
+// 快路径上每次发布（批量接口每批一次）仍要付出一次 seq_cst 栅栏，原因见 wake()。
+// 被唤醒的协程投递回它挂起时所在的调度器，不会留在唤醒方的线程上。
+// 同一时刻最多只能有一个协程在发送、一个协程在接收；不支持取消令牌
+template <typename T>
+class spsc_channel {
+ public:
+  // 容量向上取整到 2 的幂
+  explicit spsc_channel(size_t capacity)
+      : capacity_(std::bit_ceil(capacity < 1 ? size_t{1} : capacity)),
+        mask_(capacity_ - 1),
+        slots_(std::make_unique<slot[]>(capacity_)) {}
+
+  spsc_channel(const spsc_channel&) = delete;
+  spsc_channel& operator=(const spsc_channel&) = delete;
+
+  ~spsc_channel() {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    for (size_t i = head_.load(std::memory_order_relaxed); i != tail; ++i) {
+      at(i)->~T();
+    }
+  }
+
+  size_t capacity() const noexcept { return capacity_; }
+
+  bool is_closed() const noexcept { return closed_.load(std::memory_order_acquire); }
+
+  // 以下 try_push* 只能由生产者调用。缓冲区满时返回 false
+  bool try_push(const T& value) { return emplace_back(value); }
+
+  // 缓冲区满时返回 false，value 不会被移走
+  bool try_push(T&& value) { return emplace_back(std::move(value)); }
+
+  // 尽可能多地移入 values 的前缀，只发布一次下标、最多唤醒一次，返回移入的个数
+  size_t try_push_many(std::span<T> values) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    const size_t count = std::min(values.size(), room(tail, values.size()));
+    for (size_t i = 0; i < count; ++i) {
+      ::new (static_cast<void*>(at(tail + i))) T(std::move(values[i]));
+    }
+    if (count != 0) {
+      tail_.store(tail + count, std::memory_order_release);
+      wake(consumer_waiter_);
+    }
+    return count;
+  }
+
+  // 以下 try_pop* 只能由消费者调用
+  std::optional<T> try_pop() {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    if (available(head) == 0) {
+      return std::nullopt;
+    }
+    T* item = at(head);
+    std::optional<T> value(std::move(*item));
+    item->~T();
+    head_.store(head + 1, std::memory_order_release);
+    wake(producer_waiter_);
+    return value;
+  }
+
+  // 一次取出最多 limit 个追加到 out，返回取出的个数。
+  // 先为 out 预留空间，移动过程中不会因为扩容抛出异常而留下取了一半的槽位
+  size_t try_pop_many(std::vector<T>& out, size_t limit) {
+    const size_t head = head_.load(std::memory_order_relaxed);
+    const size_t count = std::min(limit, available(head, limit));
+    out.reserve(out.size() + count);
+    for (size_t i = 0; i < count; ++i) {
+      T* item = at(head + i);
+      out.push_back(std::move(*item));
+      item->~T();
+    }
+    if (count != 0) {
+      head_.store(head + count, std::memory_order_release);
+      wake(producer_waiter_);
+    }
+    return count;
+  }
+
+  // 关闭后 send 抛出 channel_closed，消费者取完剩余的值后得到 std::nullopt
+  void close() noexcept {
+    closed_.store(true, std::memory_order_seq_cst);
+    wake(consumer_waiter_);
+    wake(producer_waiter_);
+  }
+
+  class send_awaiter {
+   public:
+    send_awaiter(spsc_channel& ch, T value) : channel_(ch), value_(std::move(value)) {}
+
+    bool await_ready() {
+      if (channel_.is_closed()) {
+        return true;
+      }
+      pushed_ = channel_.emplace_back(std::move(value_));
+      return pushed_;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      // 句柄登记后 awaiter 可能已被恢复的协程销毁，复查只能通过通道本身进行
+      return suspend(channel_.producer_waiter_, handle,
+                     [&ch = channel_] { return ch.is_closed() || !ch.full(); });
+    }
+
+    void await_resume() {
+      if (pushed_) {
+        return;
+      }
+      // 被唤醒时要么有空位要么通道已关闭；只有一个生产者，空位不会被抢走
+      if (channel_.is_closed() || !channel_.emplace_back(std::move(value_))) {
+        throw channel_closed{};
+      }
+    }
+
+   private:
+    spsc_channel& channel_;
+    T value_;
+    bool pushed_ = false;
+  };
+
+  class recv_awaiter {
+   public:
+    explicit recv_awaiter(spsc_channel& ch) noexcept : channel_(ch) {}
+
+    bool await_ready() {
+      result_ = channel_.try_pop();
+      return result_.has_value() || channel_.is_closed();
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      return suspend(channel_.consumer_waiter_, handle,
+                     [&ch = channel_] { return ch.is_closed() || !ch.empty(); });
+    }
+
+    std::optional<T> await_resume() {
+      if (!result_) {
+        result_ = channel_.try_pop();
+      }
+      return std::move(result_);
+    }
+
+   private:
+    spsc_channel& channel_;
+    std::optional<T> result_;
+  };
+
+  class recv_many_awaiter {
+   public:
+    recv_many_awaiter(spsc_channel& ch, std::vector<T>& out, size_t limit) noexcept
+        : channel_(ch), out_(out), limit_(limit) {}
+
+    bool await_ready() {
+      count_ = channel_.try_pop_many(out_, limit_);
+      return count_ != 0 || limit_ == 0 || channel_.is_closed();
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      return suspend(channel_.consumer_waiter_, handle,
+                     [&ch = channel_] { return ch.is_closed() || !ch.empty(); });
+    }
+
+    size_t await_resume() {
+      if (count_ == 0) {
+        count_ = channel_.try_pop_many(out_, limit_);
+      }
+      return count_;
+    }
+
+   private:
+    spsc_channel& channel_;
+    std::vector<T>& out_;
+    size_t limit_;
+    size_t count_ = 0;
+  };
+
+  // 缓冲区满时挂起，直到消费者腾出空位
+  send_awaiter send(T value) { return send_awaiter{*this, std::move(value)}; }
+
+  // 通道关闭并且取空后返回 std::nullopt
+  recv_awaiter recv() noexcept { return recv_awaiter{*this}; }
+
+  // 至少取到一个值才返回，一次最多取 limit 个追加到 out；0 表示通道已关闭并且取空
+  recv_many_awaiter recv_many(std::vector<T>& out, size_t limit) noexcept {
+    return recv_many_awaiter{*this, out, limit};
+  }
+
+ private:
+  static constexpr size_t kCacheLine = 64;
+
+  // 等待槽：挂起方先写 executor 再 release 存入句柄，唤醒方 exchange 取到句柄后读取 executor
+  struct waiter_slot {
+    std::atomic<void*> handle{nullptr};
+    executor_ref executor;
+  };
+
+  // 缓冲区满时返回 false；参数是右值引用时失败不会移走 value
+  template <typename U>
+  bool emplace_back(U&& value) {
+    const size_t tail = tail_.load(std::memory_order_relaxed);
+    if (room(tail) == 0) {
+      return false;
+    }
+    ::new (static_cast<void*>(at(tail))) T(std::forward<U>(value));
+    tail_.store(tail + 1, std::memory_order_release);
+    wake(consumer_waiter_);
+    return true;
+  }
+
+  struct slot {
+    alignas(T) std::byte storage[sizeof(T)];
+  };
+
+  T* at(size_t index) noexcept {
+    return std::launder(reinterpret_cast<T*>(slots_[index & mask_].storage));
+  }
+
+  // 生产者视角的剩余空间，缓存的 head_ 不够 wanted 个空位时才重新读取
+  size_t room(size_t tail, size_t wanted = 1) noexcept {
+    size_t free = capacity_ - (tail - cached_head_);
+    if (free < wanted) {
+      cached_head_ = head_.load(std::memory_order_acquire);
+      free = capacity_ - (tail - cached_head_);
+    }
+    return free;
+  }
+
+  // 消费者视角的可读数量，缓存的 tail_ 不够 wanted 个值时才重新读取
+  size_t available(size_t head, size_t wanted = 1) noexcept {
+    size_t count = cached_tail_ - head;
+    if (count < wanted) {
+      cached_tail_ = tail_.load(std::memory_order_acquire);
+      count = cached_tail_ - head;
+    }
+    return count;
+  }
+
+  // 挂起前的复查只读原子下标、不更新缓存：句柄登记之后对方可能已经在别的线程恢复了本协程，
+  // 缓存字段此时归恢复后的协程所有
+  bool full() const noexcept {
+    return tail_.load(std::memory_order_relaxed) - head_.load(std::memory_order_acquire) ==
+           capacity_;
+  }
+
+  bool empty() const noexcept {
+    return tail_.load(std::memory_order_acquire) == head_.load(std::memory_order_relaxed);
+  }
+
+  // 先登记句柄再重新检查条件：条件已经满足时尝试收回句柄，收回成功就不挂起；
+  // 收回失败说明另一方已经取走句柄并负责恢复
+  template <typename Ready>
+  static bool suspend(waiter_slot& waiter, std::coroutine_handle<> handle,
+                      Ready&& ready) noexcept {
+    waiter.executor = current_executor();
+    waiter.handle.store(handle.address(), std::memory_order_release);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ready()) {
+      return waiter.handle.exchange(nullptr, std::memory_order_acq_rel) == nullptr;
+    }
+    return true;
+  }
+
+  // 发布数据或关闭之后调用。seq_cst 栅栏与 suspend 中的栅栏配对，
+  // 保证要么对方看到了新数据，要么这里看到了对方登记的句柄。
+  // 这是一对 Dekker 式的"先写自己的变量、再读对方的变量"：两边各自的写和读之间都要有
+  // StoreLoad 屏障，只在挂起方加栅栏不够——唤醒方对等待槽的读取可能提前到下标的 release
+  // 写之前，读到空槽后离开，而挂起方复查时也还没看到新下标，协程就永远不会被唤醒。
+  // 所以栅栏不能只放在挂起方，也不能以"对方是否在等"为条件跳过（那正是要读的值）。
+  // 在 x86 上它是一条 mfence，批量接口 try_push_many / try_pop_many 每批只付一次
+  // 挂起方和唤醒方在同一个调度器上，或者挂起方不在调度器上时直接恢复；
+  // 否则投递回挂起方的调度器，调度器已经停止时退回直接恢复
+  static void wake(waiter_slot& waiter) noexcept {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiter.handle.load(std::memory_order_relaxed) == nullptr) {
+      return;
+    }
+    void* address = waiter.handle.exchange(nullptr, std::memory_order_acq_rel);
+    if (address == nullptr) {
+      return;
+    }
+    // 投递之后协程随时可能再次挂起并改写 executor，必须先拷贝出来
+    const executor_ref executor = waiter.executor;
+    const auto handle = std::coroutine_handle<>::from_address(address);
+    if (executor && executor != current_executor() && executor.post(handle)) {
+      return;
+    }
+    handle.resume();
+  }
+
+  const size_t capacity_;
+  const size_t mask_;
+  std::unique_ptr<slot[]> slots_;
+
+  // 生产者独占的缓存行
+  alignas(kCacheLine) std::atomic<size_t> tail_{0};
+  size_t cached_head_ = 0;
+
+  // 消费者独占的缓存行
+  alignas(kCacheLine) std::atomic<size_t> head_{0};
+  size_t cached_tail_ = 0;
+
+  alignas(kCacheLine) waiter_slot consumer_waiter_;
+  waiter_slot producer_waiter_;
+  std::atomic<bool> closed_{false};
+};
+
+}  // namespace xcoro
@@ -10,6 +10,8 @@
 #include <thread>
 #include <vector>
 
+#include "xcoro/executor.hpp"
+
 namespace xcoro {
 
 class thread_pool {
@@ -92,6 +94,12 @@ class thread_pool {
     return yield_operation(*this);
   }
 
+  // 把一个已经挂起的协程投递到线程池，供 executor_ref 使用
+  // 返回 false 表示线程池已经 stop，调用方需要自己恢复协程
+  bool post(std::coroutine_handle<> handle) noexcept {
+    return enqueue(handle, enqueue_kind::schedule);
+  }
+
   [[nodiscard]] size_t thread_count() const noexcept {
     return threads_.size();
   }
@@ -207,6 +215,7 @@ class thread_pool {
   void worker_thread(uint32_t thread_index) noexcept {
     tls_state::current_pool = this;
     tls_state::current_index = static_cast<int>(thread_index);
+    detail::executor_scope executor_scope{*this};
     while (true) {
       std::coroutine_handle<> task;
       {
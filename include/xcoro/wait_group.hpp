@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <cassert>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+
+namespace xcoro {
+
+// Go 风格的 WaitGroup：先 add(n) 登记要等待的任务数，每个任务结束时 done()，
+// co_await wg.wait() 在计数归零后返回。计数归零之后可以再次 add 开始新的一轮。
+// 计数只是一个原子字；等待者用无锁链表登记，只有把计数减到 0 的那次调用才会去恢复它们。
+// 等待返回之后就可以销毁 wait_group，即使最后一次 done() 还没有从函数里返回。
+// 和 Go 一样，计数为 0 且有协程在等待时调用 add 属于误用
+class wait_group {
+ public:
+  explicit wait_group(std::ptrdiff_t count = 0) noexcept
+      : state_(static_cast<uint64_t>(count)) {
+    assert(count >= 0 && static_cast<uint64_t>(count) <= kCountMask);
+  }
+
+  wait_group(const wait_group&) = delete;
+  wait_group& operator=(const wait_group&) = delete;
+
+  // 把计数减到 0 的一方在摘下等待链表之前还会访问成员，等它离开后才能释放内存。
+  // 这段时间只有几条指令，不会真正阻塞
+  ~wait_group() {
+    while ((state_.load(std::memory_order_acquire) & ~kCountMask) != 0) {
+      std::this_thread::yield();
+    }
+  }
+
+  // n 可以为负数；计数减到 0 时唤醒所有等待者
+  void add(std::ptrdiff_t n = 1) noexcept {
+    uint64_t state = state_.load(std::memory_order_relaxed);
+    bool reaches_zero = false;
+    for (;;) {
+      const auto count = static_cast<std::ptrdiff_t>(state & kCountMask);
+      assert(count + n >= 0 && "wait_group counter went negative");
+      reaches_zero = n != 0 && count + n == 0;
+      // 归零的同一次原子操作里登记“正在唤醒”，之后等待者和析构函数都能看到还有人在访问
+      const uint64_t next = (state & ~kCountMask) | static_cast<uint64_t>(count + n) |
+                            (reaches_zero ? kWaking : 0);
+      if (state_.compare_exchange_weak(state, next, std::memory_order_seq_cst,
+                                       std::memory_order_relaxed)) {
+        break;
+      }
+    }
+    if (!reaches_zero) {
+      return;
+    }
+
+    awaiter* waiters = waiters_.exchange(nullptr, std::memory_order_seq_cst);
+    state_.fetch_sub(kWaking, std::memory_order_release);
+    // 从这里开始不再访问 wait_group
+    resume_all(waiters, nullptr);
+  }
+
+  void done() noexcept { add(-1); }
+
+  std::ptrdiff_t count() const noexcept {
+    return static_cast<std::ptrdiff_t>(state_.load(std::memory_order_acquire) & kCountMask);
+  }
+
+  class awaiter {
+   public:
+    explicit awaiter(wait_group& group) noexcept : group_(group) {}
+
+    // 只能在开始等待之前移动，此时节点还没有入队
+    awaiter(awaiter&& other) noexcept : group_(other.group_) {}
+    awaiter& operator=(awaiter&&) = delete;
+
+    // 计数为 0 且没有 done() 正在唤醒时才能直接返回
+    bool await_ready() const noexcept {
+      return group_.state_.load(std::memory_order_acquire) == 0;
+    }
+
+    bool await_suspend(std::coroutine_handle<> handle) noexcept {
+      handle_ = handle;
+      wait_group& group = group_;
+      awaiter* head = group.waiters_.load(std::memory_order_relaxed);
+      do {
+        next_ = head;
+      } while (!group.waiters_.compare_exchange_weak(head, this, std::memory_order_seq_cst,
+                                                     std::memory_order_relaxed));
+
+      // 与 add 里的 CAS + exchange 配对：要么这里看到计数已经归零，
+      // 要么把计数减到 0 的一方一定能摘到本节点
+      if ((group.state_.load(std::memory_order_seq_cst) & kCountMask) == 0) {
+        // 计数已经归零，唤醒可能发生在入队之前；自己把链表取下，本节点还在就不挂起
+        awaiter* waiters = group.waiters_.exchange(nullptr, std::memory_order_seq_cst);
+        if (resume_all(waiters, this)) {
+          return false;
+        }
+      }
+      // 被摘走的节点在 await_suspend 返回之前不会被恢复，失败说明已经被唤醒，直接继续执行
+      return try_mark_suspended();
+    }
+
+    void await_resume() const noexcept {}
+
+   private:
+    enum class suspend_state : std::uint8_t {
+      waiting_await_suspend,
+      suspended,
+      wake_requested,
+    };
+
+    bool try_mark_suspended() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      return suspend_phase_.compare_exchange_strong(expected, suspend_state::suspended,
+                                                    std::memory_order_acq_rel,
+                                                    std::memory_order_acquire);
+    }
+
+    bool should_resume_now() noexcept {
+      auto expected = suspend_state::waiting_await_suspend;
+      if (suspend_phase_.compare_exchange_strong(expected, suspend_state::wake_requested,
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_acquire)) {
+        return false;
+      }
+      return expected == suspend_state::suspended;
+    }
+
+    wait_group& group_;
+    std::coroutine_handle<> handle_{};
+    awaiter* next_ = nullptr;
+    std::atomic<suspend_state> suspend_phase_{suspend_state::waiting_await_suspend};
+
+    friend class wait_group;
+  };
+
+  awaiter wait() noexcept { return awaiter{*this}; }
+
+ private:
+  // 低 48 位是计数，高位记录正在唤醒等待者的 add 调用数
+  static constexpr uint64_t kCountMask = (uint64_t{1} << 48) - 1;
+  static constexpr uint64_t kWaking = uint64_t{1} << 48;
+
+  // 恢复链表里除 self 以外的等待者，返回链表里是否有 self
+  static bool resume_all(awaiter* waiter, awaiter* self) noexcept {
+    bool found = false;
+    while (waiter != nullptr) {
+      awaiter* next = waiter->next_;
+      if (waiter == self) {
+        found = true;
+      } else if (waiter->should_resume_now()) {
+        waiter->handle_.resume();
+      }
+      waiter = next;
+    }
+    return found;
+  }
+
+  std::atomic<uint64_t> state_;
+  std::atomic<awaiter*> waiters_{nullptr};
+};
+
+}  // namespace xcoro
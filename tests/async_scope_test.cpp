@@ -0,0 +1,131 @@
+#include "xcoro/async_scope.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "xcoro/channel.hpp"
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+
+using namespace xcoro;
+
+TEST(AsyncScopeTest, JoinWaitsForEverySpawnedTask) {
+  thread_pool pool(4);
+  async_scope scope;
+  std::atomic<int> finished{0};
+
+  auto child = [&]() -> task<> {
+    co_await pool.schedule();
+    finished.fetch_add(1, std::memory_order_relaxed);
+  };
+  for (int i = 0; i < 100; ++i) {
+    scope.spawn(child());
+  }
+
+  sync_wait(scope.join());
+  EXPECT_EQ(finished.load(), 100);
+  EXPECT_EQ(scope.active(), 0u);
+}
+
+TEST(AsyncScopeTest, JoinRethrowsFirstErrorOnce) {
+  async_scope scope;
+  auto failing = [](int id) -> task<> {
+    throw std::runtime_error("child " + std::to_string(id));
+    co_return;
+  };
+  scope.spawn(failing(1));
+  scope.spawn(failing(2));
+
+  try {
+    sync_wait(scope.join());
+    FAIL() << "expected runtime_error";
+  } catch (const std::runtime_error& e) {
+    EXPECT_STREQ(e.what(), "child 1");
+  }
+  // 异常已经被取走，再次 join 正常返回
+  EXPECT_NO_THROW(sync_wait(scope.join()));
+}
+
+TEST(AsyncScopeTest, RequestStopCancelsWaitingChildren) {
+  async_scope scope;
+  channel<int> never;
+  std::atomic<int> cancelled{0};
+
+  auto child = [&]() -> task<> {
+    try {
+      co_await never.recv(scope.token());
+    } catch (const operation_cancelled&) {
+      cancelled.fetch_add(1, std::memory_order_relaxed);
+    }
+  };
+  for (int i = 0; i < 10; ++i) {
+    scope.spawn(child());
+  }
+  EXPECT_EQ(scope.active(), 10u);
+
+  scope.request_stop();
+  sync_wait(scope.join());
+  EXPECT_EQ(cancelled.load(), 10);
+}
+
+namespace {
+
+// 拷贝时抛出，用来模拟启动子任务时（分配协程帧、拷贝参数）失败
+struct throwing_copy_awaitable {
+  throwing_copy_awaitable() = default;
+  throwing_copy_awaitable(const throwing_copy_awaitable&) { throw std::runtime_error("copy"); }
+  throwing_copy_awaitable(throwing_copy_awaitable&&) noexcept = default;
+
+  bool await_ready() const noexcept { return true; }
+  void await_suspend(std::coroutine_handle<>) const noexcept {}
+  void await_resume() const noexcept {}
+};
+
+}  // namespace
+
+TEST(AsyncScopeTest, FailedSpawnDoesNotLeaveChildCounted) {
+  async_scope scope;
+  throwing_copy_awaitable awaitable;
+  EXPECT_THROW(scope.spawn(awaitable), std::runtime_error);
+  EXPECT_EQ(scope.active(), 0u);
+  EXPECT_NO_THROW(sync_wait(scope.join()));
+}
+
+TEST(AsyncScopeTest, AsyncSpawnBoundsRunningChildren) {
+  thread_pool pool(4);
+  async_scope scope(2);
+  EXPECT_THROW(async_scope{0}, std::invalid_argument);
+
+  std::atomic<int> running{0};
+  std::atomic<int> peak{0};
+  std::atomic<int> finished{0};
+  auto child = [&]() -> task<> {
+    co_await pool.schedule();
+    const int now = running.fetch_add(1, std::memory_order_acq_rel) + 1;
+    int seen = peak.load(std::memory_order_relaxed);
+    while (seen < now && !peak.compare_exchange_weak(seen, now, std::memory_order_relaxed)) {
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    running.fetch_sub(1, std::memory_order_acq_rel);
+    finished.fetch_add(1, std::memory_order_relaxed);
+  };
+
+  sync_wait([&]() -> task<> {
+    for (int i = 0; i < 16; ++i) {
+      co_await scope.async_spawn(child());
+    }
+    co_await scope.join();
+  }());
+
+  EXPECT_EQ(finished.load(), 16);
+  EXPECT_GE(peak.load(), 1);
+  EXPECT_LE(peak.load(), 2);
+  EXPECT_EQ(scope.active(), 0u);
+}
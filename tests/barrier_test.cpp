@@ -0,0 +1,64 @@
+#include "xcoro/barrier.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <future>
+#include <vector>
+
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+
+using namespace xcoro;
+
+TEST(BarrierTest, CompletionRunsOncePerPhaseBeforeRelease) {
+  constexpr int kParticipants = 4;
+  constexpr int kPhases = 100;
+  std::atomic<int> arrived{0};
+  std::atomic<int> completions{0};
+  std::atomic<bool> mismatch{false};
+
+  async_barrier barrier(kParticipants, [&] {
+    // 回调执行时这一轮的参与者都已到达，且还没有人被放行
+    if (arrived.load(std::memory_order_relaxed) != (completions.load() + 1) * kParticipants) {
+      mismatch.store(true);
+    }
+    completions.fetch_add(1);
+  });
+
+  auto participant = [&]() -> task<std::vector<uint64_t>> {
+    std::vector<uint64_t> phases;
+    for (int i = 0; i < kPhases; ++i) {
+      arrived.fetch_add(1, std::memory_order_relaxed);
+      const uint64_t phase = co_await barrier.arrive_and_wait();
+      phases.push_back(phase);
+    }
+    co_return phases;
+  };
+
+  std::vector<std::future<std::vector<uint64_t>>> results;
+  for (int i = 0; i < kParticipants; ++i) {
+    results.push_back(std::async(std::launch::async, [&] { return sync_wait(participant()); }));
+  }
+  for (auto& result : results) {
+    const auto phases = result.get();
+    ASSERT_EQ(phases.size(), static_cast<size_t>(kPhases));
+    for (int i = 0; i < kPhases; ++i) {
+      EXPECT_EQ(phases[i], static_cast<uint64_t>(i));
+    }
+  }
+  EXPECT_EQ(completions.load(), kPhases);
+  EXPECT_FALSE(mismatch.load());
+}
+
+TEST(BarrierTest, SingleParticipantNeverSuspends) {
+  int completions = 0;
+  async_barrier barrier(1, [&] { ++completions; });
+  auto run = [&]() -> task<uint64_t> {
+    co_await barrier.arrive_and_wait();
+    co_return co_await barrier.arrive_and_wait();
+  };
+  EXPECT_EQ(sync_wait(run()), 1u);
+  EXPECT_EQ(completions, 2);
+}
@@ -0,0 +1,228 @@
+#include "xcoro/broadcast.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xcoro/cancellation_source.hpp"
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+#include "xcoro/when_all.hpp"
+
+using namespace xcoro;
+
+TEST(WatchTest, ReceiverSeesOnlyTheLatestValue) {
+  watch<std::string> config("v0");
+  auto rx = config.subscribe();
+  EXPECT_FALSE(rx.has_changed());
+  EXPECT_EQ(*rx.borrow(), "v0");
+
+  config.publish("v1");
+  config.publish("v2");
+  config.publish("v3");
+  EXPECT_TRUE(rx.has_changed());
+  EXPECT_EQ(config.version(), 3u);
+
+  // 中间版本被跳过，直接拿到最新值
+  auto value = sync_wait(rx.changed());
+  ASSERT_NE(value, nullptr);
+  EXPECT_EQ(*value, "v3");
+  EXPECT_FALSE(rx.has_changed());
+}
+
+TEST(WatchTest, PublishWakesEveryWaitingReceiver) {
+  constexpr int kReceivers = 8;
+  watch<int> w(0);
+  std::atomic<int> started{0};
+
+  std::vector<std::future<int>> results;
+  for (int i = 0; i < kReceivers; ++i) {
+    results.push_back(std::async(std::launch::async, [&] {
+      auto rx = w.subscribe();
+      started.fetch_add(1, std::memory_order_release);
+      auto value = sync_wait(rx.changed());
+      return value ? *value : -1;
+    }));
+  }
+  while (started.load(std::memory_order_acquire) < kReceivers) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  w.publish(42);
+
+  for (auto& result : results) {
+    EXPECT_EQ(result.get(), 42);
+  }
+}
+
+TEST(WatchTest, CloseAndCancellationWakeWaiters) {
+  watch<int> w(0);
+  cancellation_source source;
+  std::atomic<int> started{0};
+
+  auto cancelled = std::async(std::launch::async, [&] {
+    auto rx = w.subscribe();
+    started.fetch_add(1, std::memory_order_release);
+    try {
+      sync_wait(rx.changed(source.token()));
+    } catch (const operation_cancelled&) {
+      return true;
+    }
+    return false;
+  });
+  auto closed = std::async(std::launch::async, [&] {
+    auto rx = w.subscribe();
+    started.fetch_add(1, std::memory_order_release);
+    return sync_wait(rx.changed()) == nullptr;
+  });
+
+  while (started.load(std::memory_order_acquire) < 2) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  source.request_cancellation();
+  EXPECT_TRUE(cancelled.get());
+
+  w.close();
+  EXPECT_TRUE(closed.get());
+  EXPECT_THROW(w.publish(1), channel_closed);
+}
+
+TEST(BroadcastTest, EveryReceiverGetsEveryMessage) {
+  broadcast<int> b(16);
+  auto first = b.subscribe();
+  auto second = b.subscribe();
+
+  auto consume = [](broadcast<int>::receiver rx) -> task<std::vector<int>> {
+    std::vector<int> got;
+    for (;;) {
+      auto value = co_await rx.recv();
+      if (!value) {
+        break;
+      }
+      got.push_back(*value);
+    }
+    co_return got;
+  };
+  auto a = std::async(std::launch::async, [&] { return sync_wait(consume(first)); });
+  auto c = std::async(std::launch::async, [&] { return sync_wait(consume(second)); });
+
+  // 容量足够，两个接收者都不会落后
+  for (int i = 0; i < 10; ++i) {
+    b.send(i);
+  }
+  b.close();
+
+  const std::vector<int> expected{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+  EXPECT_EQ(a.get(), expected);
+  EXPECT_EQ(c.get(), expected);
+}
+
+TEST(BroadcastTest, LaggedReceiverSkipsToOldestRetainedMessage) {
+  broadcast<int> b(2);
+  auto rx = b.subscribe();
+  for (int i = 0; i < 5; ++i) {
+    b.send(i);
+  }
+
+  try {
+    rx.try_recv();
+    FAIL() << "expected broadcast_lagged";
+  } catch (const broadcast_lagged& e) {
+    EXPECT_EQ(e.skipped(), 3u);
+  }
+  EXPECT_EQ(rx.try_recv(), 3);
+  EXPECT_EQ(sync_wait(rx.recv()), 4);
+  EXPECT_EQ(rx.try_recv(), std::nullopt);
+
+  // 新订阅的接收者只看到之后的消息
+  auto late = b.subscribe();
+  b.send(5);
+  EXPECT_EQ(late.try_recv(), 5);
+}
+
+TEST(BroadcastTest, SendResumesEachReceiverOnItsOwnExecutor) {
+  broadcast<int> b(4);
+  thread_pool first_pool{1};
+  thread_pool second_pool{1};
+  std::atomic<int> waiting{0};
+
+  auto receive_on = [&](thread_pool& pool, broadcast<int>::receiver rx) -> task<bool> {
+    co_await pool.schedule();
+    waiting.fetch_add(1, std::memory_order_release);
+    const std::optional<int> value = co_await rx.recv();
+    co_return value == 7 && pool.running_in_this_pool();
+  };
+  auto first = std::async(std::launch::async,
+                          [&] { return sync_wait(receive_on(first_pool, b.subscribe())); });
+  auto second = std::async(std::launch::async,
+                           [&] { return sync_wait(receive_on(second_pool, b.subscribe())); });
+  while (waiting.load(std::memory_order_acquire) < 2) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  // 发送者不在自己的线程上依次执行接收者的后续代码，而是投递回各自的线程池
+  b.send(7);
+  EXPECT_TRUE(first.get());
+  EXPECT_TRUE(second.get());
+}
+
+TEST(BroadcastTest, CancellableReceiversRaceWithSendWithoutMissingMessages) {
+  constexpr int kMessages = 2000;
+  broadcast<int> b(kMessages);
+  thread_pool pool{4};
+  std::vector<cancellation_source> sources(kMessages);
+  std::atomic<int> next_attempt{0};
+
+  auto consumer = [&](broadcast<int>::receiver rx) -> task<long> {
+    co_await pool.schedule();
+    long sum = 0;
+    for (;;) {
+      const int attempt = next_attempt.fetch_add(1, std::memory_order_relaxed);
+      cancellation_token token;
+      if (attempt < kMessages) {
+        token = sources[attempt].token();
+      }
+      try {
+        const auto value = co_await rx.recv(std::move(token));
+        if (!value) {
+          break;
+        }
+        sum += *value;
+      } catch (const operation_cancelled&) {
+      }
+    }
+    co_return sum;
+  };
+  auto producer = [&]() -> task<long> {
+    co_await pool.schedule();
+    for (int i = 0; i < kMessages; ++i) {
+      b.send(i);
+    }
+    b.close();
+    co_return 0;
+  };
+  auto canceller = std::async(std::launch::async, [&] {
+    for (int i = 0; i < kMessages; i += 3) {
+      sources[i].request_cancellation();
+    }
+  });
+
+  auto [first, second, ignored] = sync_wait(when_all(consumer(b.subscribe()),
+                                                     consumer(b.subscribe()), producer()));
+  (void)ignored;
+  canceller.get();
+  // 被取消的等待不会让接收者错过消息，每个接收者都收到全部消息
+  const long expected = static_cast<long>(kMessages) * (kMessages - 1) / 2;
+  EXPECT_EQ(first, expected);
+  EXPECT_EQ(second, expected);
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <future>
+#include <memory>
 #include <thread>
 
 #include "xcoro/cancellation_registration.hpp"
@@ -184,3 +187,61 @@ TEST(CancellationTokenTest, ThreadSafetyMultipleRegistrations) {
   // 每个回调应该恰好被调用一次
   EXPECT_EQ(total_callbacks.load(), kThreadCount * kRegistrationsPerThread);
 }
+
+TEST(CancellationTokenTest, CallbackMayDeregisterItself) {
+  cancellation_source source;
+  auto token = source.token();
+  int calls = 0;
+  auto reg = std::make_unique<cancellation_registration>();
+  *reg = cancellation_registration(token, [&] {
+    ++calls;
+    reg.reset();  // 回调里销毁自己的注册对象，不能死锁
+  });
+  cancellation_registration later(token, [&calls] { ++calls; });
+
+  source.request_cancellation();
+  EXPECT_EQ(calls, 2);
+  EXPECT_FALSE(reg);
+}
+
+TEST(CancellationTokenTest, DeregisterWaitsForRunningCallback) {
+  cancellation_source source;
+  auto token = source.token();
+  std::atomic<bool> entered{false};
+  std::atomic<bool> finished{false};
+
+  cancellation_registration reg(token, [&] {
+    entered.store(true);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    finished.store(true);
+  });
+  std::thread canceller([&] { source.request_cancellation(); });
+  while (!entered.load()) {
+    std::this_thread::yield();
+  }
+  // 回调正在另一个线程上执行，注销要等它返回之后才能继续
+  reg.deregister();
+  EXPECT_TRUE(finished.load());
+  canceller.join();
+}
+
+TEST(CancellationTokenTest, MovedRegistrationKeepsLargeCallback) {
+  cancellation_source source;
+  auto token = source.token();
+  std::array<int, 32> payload{};
+  payload.fill(1);
+  int sum = 0;
+
+  // 捕获超过内联缓冲区大小，退回到堆上保存
+  cancellation_registration first(token, [payload, &sum] {
+    for (int value : payload) {
+      sum += value;
+    }
+  });
+  cancellation_registration second(std::move(first));
+  cancellation_registration third;
+  third = std::move(second);
+
+  source.request_cancellation();
+  EXPECT_EQ(sum, 32);
+}
@@ -0,0 +1,305 @@
+#include "xcoro/channel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xcoro/cancellation_source.hpp"
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+#include "xcoro/when_all.hpp"
+
+using namespace xcoro;
+
+TEST(ChannelTest, BoundedTrySendAndTryRecvKeepFifoOrder) {
+  channel<std::string> ch(2);
+  EXPECT_TRUE(ch.try_send("a"));
+  EXPECT_TRUE(ch.try_send("b"));
+
+  std::string rejected = "c";
+  EXPECT_FALSE(ch.try_send(std::move(rejected)));
+  EXPECT_EQ(rejected, "c");  // 失败时值没有被移走
+  EXPECT_EQ(ch.size(), 2u);
+
+  EXPECT_EQ(ch.try_recv(), "a");
+  EXPECT_EQ(ch.try_recv(), "b");
+  EXPECT_EQ(ch.try_recv(), std::nullopt);
+}
+
+TEST(ChannelTest, SenderWaitsWhenBufferIsFull) {
+  channel<int> ch(1);
+  std::atomic<int> sent{0};
+
+  auto producer = [&]() -> task<> {
+    for (int i = 0; i < 3; ++i) {
+      co_await ch.send(i);
+      sent.fetch_add(1, std::memory_order_release);
+    }
+  };
+  auto fut = std::async(std::launch::async, [&] { sync_wait(producer()); });
+
+  while (sent.load(std::memory_order_acquire) < 1) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  // 第二个值放不进缓冲区，生产者停在第二次 send 上
+  EXPECT_EQ(sent.load(std::memory_order_acquire), 1);
+
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(sync_wait(ch.recv()), i);
+  }
+  fut.get();
+  EXPECT_EQ(sent.load(), 3);
+}
+
+TEST(ChannelTest, RecvManyDrainsUpToLimit) {
+  channel<int> ch;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(ch.try_send(i));
+  }
+
+  std::vector<int> out;
+  EXPECT_EQ(sync_wait(ch.recv_many(out, 3)), 3u);
+  EXPECT_EQ(sync_wait(ch.recv_many(out, 8)), 2u);
+  EXPECT_EQ(out, (std::vector<int>{0, 1, 2, 3, 4}));
+}
+
+TEST(ChannelTest, CloseDrainsBufferThenReportsEnd) {
+  channel<int> ch(4);
+  ASSERT_TRUE(ch.try_send(7));
+  ch.close();
+
+  EXPECT_TRUE(ch.is_closed());
+  EXPECT_FALSE(ch.try_send(8));
+  EXPECT_THROW(sync_wait(ch.send(9)), channel_closed);
+  EXPECT_EQ(sync_wait(ch.recv()), 7);
+  EXPECT_EQ(sync_wait(ch.recv()), std::nullopt);
+}
+
+TEST(ChannelTest, CloseWakesWaitingReceiversAndSenders) {
+  channel<int> empty(1);
+  channel<int> full(0);
+  std::atomic<int> waiting{0};
+
+  auto receiver = [&]() -> task<std::optional<int>> {
+    waiting.fetch_add(1, std::memory_order_release);
+    co_return co_await empty.recv();
+  };
+  auto sender = [&]() -> task<bool> {
+    waiting.fetch_add(1, std::memory_order_release);
+    try {
+      co_await full.send(1);
+    } catch (const channel_closed&) {
+      co_return true;
+    }
+    co_return false;
+  };
+
+  auto received = std::async(std::launch::async, [&] { return sync_wait(receiver()); });
+  auto rejected = std::async(std::launch::async, [&] { return sync_wait(sender()); });
+  while (waiting.load(std::memory_order_acquire) < 2) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  empty.close();
+  full.close();
+  EXPECT_EQ(received.get(), std::nullopt);
+  EXPECT_TRUE(rejected.get());
+}
+
+TEST(ChannelTest, WaitingRecvCanBeCancelled) {
+  channel<int> ch;
+  cancellation_source source;
+  std::atomic<bool> waiting{false};
+
+  auto receiver = [&]() -> task<bool> {
+    waiting.store(true, std::memory_order_release);
+    try {
+      co_await ch.recv(source.token());
+    } catch (const operation_cancelled&) {
+      co_return true;
+    }
+    co_return false;
+  };
+  auto fut = std::async(std::launch::async, [&] { return sync_wait(receiver()); });
+  while (!waiting.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  source.request_cancellation();
+  EXPECT_TRUE(fut.get());
+
+  // 被取消的接收者已经离开队列，之后发送的值留在缓冲区里
+  ASSERT_TRUE(ch.try_send(3));
+  EXPECT_EQ(ch.try_recv(), 3);
+}
+
+TEST(ChannelTest, MultipleProducersAndConsumersDeliverEveryValueOnce) {
+  for (size_t capacity : {size_t{0}, size_t{8}, channel<int>::unbounded}) {
+    channel<int> ch(capacity);
+    thread_pool pool{4};
+    constexpr int kPerProducer = 2000;
+    std::atomic<long> sum{0};
+    std::atomic<int> count{0};
+
+    auto producer = [&](int base) -> task<> {
+      co_await pool.schedule();
+      for (int i = 0; i < kPerProducer; ++i) {
+        co_await ch.send(base + i);
+      }
+    };
+    auto producers = [&]() -> task<> {
+      co_await when_all(producer(0), producer(kPerProducer), producer(2 * kPerProducer));
+      ch.close();
+    };
+    auto consumer = [&]() -> task<> {
+      co_await pool.schedule();
+      std::vector<int> batch;
+      for (;;) {
+        batch.clear();
+        const size_t n = co_await ch.recv_many(batch, 16);
+        if (n == 0) {
+          break;
+        }
+        for (int value : batch) {
+          sum.fetch_add(value, std::memory_order_relaxed);
+        }
+        count.fetch_add(static_cast<int>(n), std::memory_order_relaxed);
+      }
+    };
+    auto single_consumer = [&]() -> task<> {
+      co_await pool.schedule();
+      for (;;) {
+        const std::optional<int> value = co_await ch.recv();
+        if (!value) {
+          break;
+        }
+        sum.fetch_add(*value, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+      }
+    };
+
+    sync_wait(when_all(producers(), consumer(), single_consumer()));
+
+    constexpr int kTotal = 3 * kPerProducer;
+    EXPECT_EQ(count.load(), kTotal) << "capacity " << capacity;
+    EXPECT_EQ(sum.load(), static_cast<long>(kTotal) * (kTotal - 1) / 2) << "capacity " << capacity;
+  }
+}
+
+TEST(ChannelTest, SendResumesReceiverOnItsOwnExecutor) {
+  channel<int> ch;
+  thread_pool pool{1};
+  std::atomic<bool> waiting{false};
+
+  auto receiver = [&]() -> task<bool> {
+    co_await pool.schedule();
+    waiting.store(true, std::memory_order_release);
+    const std::optional<int> value = co_await ch.recv();
+    co_return value == 5 && pool.running_in_this_pool();
+  };
+  auto fut = std::async(std::launch::async, [&] { return sync_wait(receiver()); });
+  while (!waiting.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  // 发送方不在自己的线程上执行接收者的后续代码，而是投递回接收者所在的线程池
+  ASSERT_TRUE(ch.try_send(5));
+  EXPECT_TRUE(fut.get());
+}
+
+TEST(ChannelTest, RecvManyWakesBlockedSendersInArrivalOrder) {
+  channel<int> ch(0);
+  std::mutex order_mutex;
+  std::vector<int> resumed;
+
+  auto sender = [&](int id) -> task<> {
+    co_await ch.send(id);
+    std::lock_guard<std::mutex> guard(order_mutex);
+    resumed.push_back(id);
+  };
+  std::vector<std::future<void>> senders;
+  for (int id = 0; id < 3; ++id) {
+    senders.push_back(std::async(std::launch::async, [&, id] { sync_wait(sender(id)); }));
+    // 保证按 id 顺序排进发送队列
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // 一次 recv_many 取走三个发送者的值；没有调度器的发送者在这里按排队顺序直接恢复
+  std::vector<int> out;
+  EXPECT_EQ(sync_wait(ch.recv_many(out, 3)), 3u);
+  for (auto& done : senders) {
+    done.get();
+  }
+  EXPECT_EQ(out, (std::vector<int>{0, 1, 2}));
+  EXPECT_EQ(resumed, (std::vector<int>{0, 1, 2}));
+}
+
+TEST(ChannelTest, RecvManyRejectsZeroLimit) {
+  channel<int> ch;
+  std::vector<int> out;
+  EXPECT_THROW((void)ch.recv_many(out, 0), std::invalid_argument);
+}
+
+TEST(ChannelTest, CancellableReceiversRaceWithSendersWithoutLosingValues) {
+  channel<int> ch(0);
+  thread_pool pool{4};
+  constexpr int kValues = 2000;
+  constexpr int kAttempts = 4 * kValues;
+  std::vector<cancellation_source> sources(kAttempts);
+  std::atomic<int> next_attempt{0};
+  std::atomic<long> sum{0};
+  std::atomic<int> received{0};
+
+  auto producer = [&]() -> task<> {
+    co_await pool.schedule();
+    for (int i = 0; i < kValues; ++i) {
+      co_await ch.send(i);
+    }
+    ch.close();
+  };
+  auto consumer = [&]() -> task<> {
+    co_await pool.schedule();
+    for (;;) {
+      const int attempt = next_attempt.fetch_add(1, std::memory_order_relaxed);
+      cancellation_token token;
+      if (attempt < kAttempts) {
+        token = sources[attempt].token();
+      }
+      try {
+        const auto value = co_await ch.recv(std::move(token));
+        if (!value) {
+          break;
+        }
+        sum.fetch_add(*value, std::memory_order_relaxed);
+        received.fetch_add(1, std::memory_order_relaxed);
+      } catch (const operation_cancelled&) {
+      }
+    }
+  };
+  auto canceller = std::async(std::launch::async, [&] {
+    for (int i = 0; i < kAttempts; ++i) {
+      if (i % 3 == 0) {
+        sources[i].request_cancellation();
+      }
+    }
+  });
+
+  sync_wait(when_all(producer(), consumer(), consumer()));
+  canceller.get();
+  // 被取消的接收不会吞掉值，每个值恰好被收到一次
+  EXPECT_EQ(received.load(), kValues);
+  EXPECT_EQ(sum.load(), static_cast<long>(kValues) * (kValues - 1) / 2);
+}
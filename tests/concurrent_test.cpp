@@ -0,0 +1,187 @@
+#include "xcoro/concurrent.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <numeric>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+
+using namespace xcoro;
+
+TEST(ConcurrentTest, ForEachKeepsAtMostLimitInFlight) {
+  thread_pool pool(4);
+  std::vector<int> keys(200);
+  std::iota(keys.begin(), keys.end(), 0);
+  std::atomic<int> in_flight{0};
+  std::atomic<int> peak{0};
+  std::atomic<int> sum{0};
+
+  sync_wait(for_each_concurrent(pool, keys, 3, [&](int key) -> task<> {
+    const int now = in_flight.fetch_add(1) + 1;
+    int observed = peak.load();
+    while (now > observed && !peak.compare_exchange_weak(observed, now)) {
+    }
+    co_await pool.schedule();
+    sum.fetch_add(key, std::memory_order_relaxed);
+    in_flight.fetch_sub(1);
+  }));
+
+  EXPECT_EQ(sum.load(), 199 * 200 / 2);
+  EXPECT_LE(peak.load(), 3);
+  EXPECT_GE(peak.load(), 1);
+}
+
+TEST(ConcurrentTest, MapConcurrentReturnsResultsInInputOrder) {
+  thread_pool pool(4);
+  // take_while 之后的 range 没有大小，元素按值产生
+  auto keys = std::views::iota(0) | std::views::take_while([](int i) { return i < 50; });
+
+  auto squares = sync_wait(map_concurrent(pool, keys, 8, [&](int key) -> task<std::string> {
+    co_await pool.schedule();
+    co_return std::to_string(key * key);
+  }));
+
+  ASSERT_EQ(squares.size(), 50u);
+  for (int i = 0; i < 50; ++i) {
+    EXPECT_EQ(squares[i], std::to_string(i * i));
+  }
+}
+
+TEST(ConcurrentTest, MapConcurrentUnorderedStreamsEveryResult) {
+  thread_pool pool(4);
+  std::vector<bool> seen(100, false);
+  long long total = 0;
+
+  sync_wait(map_concurrent_unordered(
+      pool, std::views::iota(0, 100), 5,
+      [&](int key) -> task<long long> {
+        co_await pool.schedule();
+        co_return static_cast<long long>(key) * 2;
+      },
+      [&](size_t index, long long value) {
+        seen[index] = true;
+        total += value;
+      }));
+
+  EXPECT_EQ(total, 99 * 100);
+  EXPECT_EQ(std::count(seen.begin(), seen.end(), true), 100);
+}
+
+TEST(ConcurrentTest, ErrorStopsLaunchingNewItems) {
+  std::vector<int> keys(100);
+  std::iota(keys.begin(), keys.end(), 0);
+  int started = 0;
+
+  auto run = for_each_concurrent(keys, 2, [&](int key) -> task<> {
+    ++started;
+    if (key == 5) {
+      throw std::runtime_error("bad key");
+    }
+    co_return;
+  });
+  EXPECT_THROW(sync_wait(std::move(run)), std::runtime_error);
+  EXPECT_LT(started, 10);
+}
+
+TEST(ConcurrentTest, ZeroLimitIsRejected) {
+  std::vector<int> keys{1, 2, 3};
+  auto noop = [](int) -> task<> { co_return; };
+  EXPECT_THROW((void)for_each_concurrent(keys, 0, noop), std::invalid_argument);
+  EXPECT_THROW((void)map_concurrent(keys, 0, [](int key) -> task<int> { co_return key; }),
+               std::invalid_argument);
+}
+
+TEST(ConcurrentTest, MapConcurrentOrderedStreamsInInputOrderWithinWindow) {
+  thread_pool pool(4);
+  constexpr size_t kLimit = 4;
+  std::atomic<bool> first_released{false};
+  std::atomic<int> completed_before_first{0};
+  std::vector<size_t> order;
+
+  sync_wait(map_concurrent_ordered(
+      pool, std::views::iota(0, 200), kLimit,
+      [&](int key) -> task<int> {
+        co_await pool.schedule();
+        if (key == 0) {
+          // 第一个元素最慢，后面的元素最多只能超前一个窗口
+          while (completed_before_first.load() < static_cast<int>(kLimit) - 1) {
+            std::this_thread::yield();
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(20));
+          first_released = true;
+        } else if (!first_released.load()) {
+          completed_before_first.fetch_add(1);
+        }
+        co_return key * 3;
+      },
+      [&](size_t index, int value) {
+        EXPECT_EQ(value, static_cast<int>(index) * 3);
+        order.push_back(index);
+      }));
+
+  ASSERT_EQ(order.size(), 200u);
+  for (size_t i = 0; i < order.size(); ++i) {
+    EXPECT_EQ(order[i], i);
+  }
+  // 元素 0 完成之前，窗口里最多放 limit - 1 个结果，其余 limit - 1 个 worker
+  // 各自拿着一个进不了窗口的结果等待，不再取新元素
+  EXPECT_LE(completed_before_first.load(), static_cast<int>(kLimit) * 2 - 2);
+}
+
+TEST(ConcurrentTest, MapConcurrentOrderedStopsAfterFailure) {
+  std::vector<size_t> order;
+  auto run = map_concurrent_ordered(
+      std::views::iota(0, 50), 3,
+      [](int key) -> task<int> {
+        if (key == 10) {
+          throw std::runtime_error("bad key");
+        }
+        co_return key;
+      },
+      [&](size_t index, int) { order.push_back(index); });
+  EXPECT_THROW(sync_wait(std::move(run)), std::runtime_error);
+  ASSERT_EQ(order.size(), 10u);
+  for (size_t i = 0; i < order.size(); ++i) {
+    EXPECT_EQ(order[i], i);
+  }
+}
+
+TEST(ConcurrentTest, MapConcurrentOrderedKeepsEarlierResultsThatFinishAfterFailure) {
+  thread_pool pool(4);
+  std::atomic<bool> later_failed{false};
+  std::vector<size_t> order;
+
+  auto run = map_concurrent_ordered(
+      pool, std::views::iota(0, 50), 4,
+      [&](int key) -> task<int> {
+        co_await pool.schedule();
+        if (key == 10) {
+          later_failed = true;
+          throw std::runtime_error("bad key");
+        }
+        if (key == 9) {
+          // 元素 9 在元素 10 失败之后才完成，它的结果仍然要交出
+          while (!later_failed.load()) {
+            std::this_thread::yield();
+          }
+          std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        co_return key;
+      },
+      [&](size_t index, int) { order.push_back(index); });
+  EXPECT_THROW(sync_wait(std::move(run)), std::runtime_error);
+  ASSERT_EQ(order.size(), 10u);
+  for (size_t i = 0; i < order.size(); ++i) {
+    EXPECT_EQ(order[i], i);
+  }
+}
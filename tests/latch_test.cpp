@@ -0,0 +1,53 @@
+#include "xcoro/latch.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+
+using namespace xcoro;
+
+TEST(LatchTest, WaitersResumeWhenCountReachesZero) {
+  constexpr int kShards = 16;
+  thread_pool pool(4);
+  async_latch latch(kShards);
+  std::atomic<int> finished{0};
+
+  auto shard = [&]() -> task<> {
+    co_await pool.schedule();
+    finished.fetch_add(1, std::memory_order_relaxed);
+    latch.count_down();
+  };
+  std::vector<std::future<void>> shards;
+  for (int i = 0; i < kShards; ++i) {
+    shards.push_back(std::async(std::launch::async, [&] { sync_wait(shard()); }));
+  }
+
+  auto gather = [&]() -> task<int> {
+    co_await latch;
+    co_return finished.load(std::memory_order_relaxed);
+  };
+  EXPECT_EQ(sync_wait(gather()), kShards);
+  EXPECT_TRUE(latch.try_wait());
+  for (auto& f : shards) {
+    f.get();
+  }
+}
+
+TEST(LatchTest, ZeroCountAndArriveAndWaitDoNotSuspend) {
+  async_latch ready(0);
+  EXPECT_TRUE(ready.try_wait());
+  sync_wait([&]() -> task<> { co_await ready; }());
+
+  async_latch last(2);
+  last.count_down();
+  EXPECT_FALSE(last.try_wait());
+  sync_wait([&]() -> task<> { co_await last.arrive_and_wait(); }());
+  EXPECT_TRUE(last.try_wait());
+}
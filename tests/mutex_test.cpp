@@ -3,12 +3,16 @@
 #include <gtest/gtest.h>
 
 #include <atomic>
+#include <chrono>
 #include <future>
 #include <thread>
+#include <vector>
 
 #include "xcoro/cancellation_source.hpp"
 #include "xcoro/sync_wait.hpp"
 #include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+#include "xcoro/when_all.hpp"
 
 using namespace xcoro;
 
@@ -84,3 +88,150 @@ TEST(MutexTest, WaitingCoroutineResumedByCancellation) {
   EXPECT_TRUE(m.try_lock());
   m.unlock();
 }
+
+TEST(MutexTest, ContendedLockIsMutuallyExclusiveAcrossThreads) {
+  mutex m;
+  thread_pool pool{4};
+  constexpr int kTasks = 8;
+  constexpr int kIterations = 2000;
+  int counter = 0;
+
+  auto worker = [&]() -> task<> {
+    co_await pool.schedule();
+    for (int i = 0; i < kIterations; ++i) {
+      co_await m.lock();
+      ++counter;
+      m.unlock();
+    }
+  };
+
+  sync_wait(when_all(worker(), worker(), worker(), worker(), worker(), worker(), worker(),
+                     worker()));
+
+  EXPECT_EQ(counter, kTasks * kIterations);
+  EXPECT_TRUE(m.try_lock());
+  m.unlock();
+}
+
+TEST(MutexTest, CancelledWaiterIsSkippedAndOthersAcquireInOrder) {
+  mutex m;
+  ASSERT_TRUE(m.try_lock());
+
+  cancellation_source source;
+  std::atomic<int> waiting{0};
+  std::vector<int> order;
+  bool cancelled = false;
+
+  auto waiter = [&](int id, cancellation_token token) -> task<> {
+    waiting.fetch_add(1, std::memory_order_release);
+    try {
+      co_await m.lock(std::move(token));
+    } catch (const operation_cancelled&) {
+      cancelled = true;
+      co_return;
+    }
+    order.push_back(id);
+    m.unlock();
+  };
+
+  auto fut = std::async(std::launch::async, [&] {
+    sync_wait(when_all(waiter(1, {}), waiter(2, source.token()), waiter(3, {})));
+  });
+
+  while (waiting.load(std::memory_order_acquire) < 3) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  source.request_cancellation();
+  m.unlock();
+  fut.get();
+
+  EXPECT_TRUE(cancelled);
+  EXPECT_EQ(order, (std::vector<int>{1, 3}));
+  EXPECT_TRUE(m.try_lock());
+  m.unlock();
+}
+
+TEST(MutexTest, LockAwaiterCanBePassedToSyncWait) {
+  mutex m;
+  sync_wait(m.lock());
+  EXPECT_FALSE(m.try_lock());
+  m.unlock();
+}
+
+TEST(MutexTest, UnlockHandsLockToWaiterOnItsOwnExecutor) {
+  mutex m;
+  thread_pool pool{1};
+  ASSERT_TRUE(m.try_lock());
+
+  std::atomic<bool> waiting{false};
+  auto waiter = [&]() -> task<bool> {
+    co_await pool.schedule();
+    waiting.store(true, std::memory_order_release);
+    co_await m.lock();
+    const bool on_pool = pool.running_in_this_pool();
+    m.unlock();
+    co_return on_pool;
+  };
+
+  auto fut = std::async(std::launch::async, [&] { return sync_wait(waiter()); });
+  while (!waiting.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  // unlock 不在本线程上执行等待者的临界区，而是投递回它所在的线程池
+  m.unlock();
+  EXPECT_TRUE(fut.get());
+}
+
+TEST(MutexTest, CancellableWaitersStayMutuallyExclusiveUnderContention) {
+  mutex m;
+  thread_pool pool{4};
+  constexpr int kTasks = 8;
+  constexpr int kIterations = 300;
+
+  std::vector<cancellation_source> sources(kTasks * kIterations);
+  std::atomic<bool> inside{false};
+  std::atomic<int> acquired{0};
+  std::atomic<int> cancelled{0};
+  std::atomic<bool> overlapped{false};
+
+  auto worker = [&](int id) -> task<> {
+    co_await pool.schedule();
+    for (int i = 0; i < kIterations; ++i) {
+      try {
+        co_await m.lock(sources[id * kIterations + i].token());
+      } catch (const operation_cancelled&) {
+        cancelled.fetch_add(1, std::memory_order_relaxed);
+        continue;
+      }
+      if (inside.exchange(true, std::memory_order_acq_rel)) {
+        overlapped.store(true, std::memory_order_relaxed);
+      }
+      acquired.fetch_add(1, std::memory_order_relaxed);
+      inside.store(false, std::memory_order_release);
+      m.unlock();
+    }
+  };
+
+  // 另一个线程不断取消等待，被取消的节点要从等待链表里摘掉，不能影响其它等待者
+  std::atomic<bool> stop{false};
+  std::thread canceller([&] {
+    for (size_t i = 0; !stop.load(std::memory_order_acquire); i = (i + 7) % sources.size()) {
+      sources[i].request_cancellation();
+      std::this_thread::yield();
+    }
+  });
+
+  sync_wait(when_all(worker(0), worker(1), worker(2), worker(3), worker(4), worker(5),
+                     worker(6), worker(7)));
+  stop.store(true, std::memory_order_release);
+  canceller.join();
+
+  EXPECT_FALSE(overlapped.load());
+  EXPECT_EQ(acquired.load() + cancelled.load(), kTasks * kIterations);
+  EXPECT_TRUE(m.try_lock());
+  m.unlock();
+}
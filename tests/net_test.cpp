@@ -1,24 +1,40 @@
 #include "xcoro/net/acceptor.hpp"
+#include "xcoro/net/buffered_stream.hpp"
+#include "xcoro/net/file.hpp"
 #include "xcoro/net/io_context.hpp"
+#include "xcoro/net/iobuf.hpp"
+#include "xcoro/net/mirrored_buffer.hpp"
 #include "xcoro/net/resolver.hpp"
+#include "xcoro/net/sharded_acceptor.hpp"
 #include "xcoro/net/socket.hpp"
+#include "xcoro/net/write_queue.hpp"
 
 #include <gtest/gtest.h>
 
 #include <array>
+#include <atomic>
 #include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <future>
 #include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 #include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
 #include <sys/socket.h>
 #include <unistd.h>
 
 #include "xcoro/cancellation_source.hpp"
 #include "xcoro/sync_wait.hpp"
+#include "xcoro/thread_pool.hpp"
 
 using namespace xcoro;
 using namespace xcoro::net;
@@ -120,6 +136,123 @@ TEST(NetTest, SocketMoveAssignmentClosesOldFd) {
   EXPECT_EQ(errno, EBADF);
 }
 
+TEST(NetTest, SocketRejectsSecondOwnerOfSameDescriptor) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  scoped_fd right{fds[1]};
+
+  io_context ctx;
+  xcoro_socket owner(ctx, fds[0]);
+  EXPECT_THROW(xcoro_socket(ctx, fds[0]), std::logic_error);
+
+  owner.close();
+  EXPECT_FALSE(owner.is_open());
+
+  // 槽位归还后，复用同一个fd号的新连接可以重新占用它
+  int again[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, again), 0);
+  scoped_fd peer{again[1]};
+  xcoro_socket reused(ctx, again[0]);
+  EXPECT_TRUE(reused.is_open());
+}
+
+TEST(NetTest, SocketCloseWakesPendingReaderWithError) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  scoped_fd right{fds[1]};
+
+  io_context ctx;
+  xcoro_socket left(ctx, fds[0]);
+  ctx.run();
+
+  std::array<std::byte, 8> buffer{};
+  auto reader = std::async(std::launch::async, [&] {
+    try {
+      (void)sync_wait(left.async_read_some({std::span<std::byte>{buffer}}));
+      return 0;
+    } catch (const std::system_error& e) {
+      return e.code().value();
+    }
+  });
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  left.close();
+  EXPECT_EQ(reader.get(), EBADF);
+
+  ctx.stop();
+}
+
+TEST(NetTest, RawFdWaitDoesNotStealSocketRegistration) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  scoped_fd right{fds[1]};
+
+  io_context ctx;
+  xcoro_socket left(ctx, fds[0]);
+  ctx.run();
+
+  std::array<std::byte, 4> buffer{};
+  auto reader = std::async(std::launch::async, [&] {
+    return sync_wait(left.async_read_some({std::span<std::byte>{buffer}}));
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  // socket 已经把 fd 注册进 epoll，原始fd接口不能把注册改指向自己的临时状态
+  std::array<char, 4> raw{};
+  try {
+    (void)sync_wait(ctx.async_read_some(fds[0], raw.data(), raw.size()));
+    ADD_FAILURE() << "expected EEXIST";
+  } catch (const std::system_error& e) {
+    EXPECT_EQ(e.code().value(), EEXIST);
+  }
+
+  // 临时状态注销之后，socket 的注册仍然有效
+  ASSERT_EQ(::write(right.get(), "ping", 4), 4);
+  EXPECT_EQ(reader.get(), 4u);
+
+  ctx.stop();
+}
+
+TEST(NetTest, EdgeTriggeredWaitsSurviveManyRoundTrips) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+  io_context ctx;
+  xcoro_socket left(ctx, fds[0]);
+  xcoro_socket right(ctx, fds[1]);
+  ctx.run();
+
+  // 描述符只注册一次（边沿触发），每轮都要重新挂起等待，不能丢失唤醒
+  constexpr int kRounds = 200;
+  auto client = [&]() -> task<int> {
+    int count = 0;
+    for (int i = 0; i < kRounds; ++i) {
+      std::array<std::byte, 4> out{};
+      std::memcpy(out.data(), &i, sizeof(i));
+      co_await left.async_write_all({std::span<const std::byte>{out}});
+      std::array<std::byte, 4> in{};
+      co_await left.async_read_exact({std::span<std::byte>{in}});
+      int echoed = 0;
+      std::memcpy(&echoed, in.data(), sizeof(echoed));
+      count += echoed == i ? 1 : 0;
+    }
+    co_return count;
+  };
+  auto server = [&]() -> task<> {
+    for (int i = 0; i < kRounds; ++i) {
+      std::array<std::byte, 4> in{};
+      co_await right.async_read_exact({std::span<std::byte>{in}});
+      co_await right.async_write_all({std::span<const std::byte>{in}});
+    }
+  };
+
+  auto echo = std::async(std::launch::async, [&] { sync_wait(server()); });
+  EXPECT_EQ(sync_wait(client()), kRounds);
+  echo.get();
+
+  ctx.stop();
+}
+
 TEST(NetTest, AsyncReadExactAndWriteAllOverSocketPair) {
   int fds[2] = {-1, -1};
   ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
@@ -171,6 +304,457 @@ TEST(NetTest, AsyncReadSomeCanBeCancelled) {
   ctx.stop();
 }
 
+TEST(NetTest, ReadCompletionResumesOnAwaitingThreadPool) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+  io_context ctx;
+  thread_pool pool(2);
+  xcoro_socket left(ctx, fds[0]);
+  xcoro_socket right(ctx, fds[1]);
+  ctx.run();
+
+  std::atomic<bool> waiting{false};
+  auto reader = std::async(std::launch::async, [&] {
+    return sync_wait([&]() -> task<bool> {
+      co_await pool.schedule();
+      std::array<std::byte, 4> buffer{};
+      waiting.store(true, std::memory_order_release);
+      (void)co_await right.async_read_some({std::span<std::byte>{buffer}});
+      co_return pool.running_in_this_pool();
+    }());
+  });
+
+  while (!waiting.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  constexpr std::array<std::byte, 4> message{std::byte{'p'}, std::byte{'i'}, std::byte{'n'}, std::byte{'g'}};
+  sync_wait(left.async_write_all({std::span<const std::byte>{message}}));
+
+  EXPECT_TRUE(reader.get());
+  ctx.stop();
+}
+
+TEST(NetTest, ResumeInlineKeepsCompletionOnLoopThread) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+  io_context ctx;
+  thread_pool pool(2);
+  xcoro_socket left(ctx, fds[0]);
+  xcoro_socket right(ctx, fds[1]);
+  right.set_resume_inline(true);
+  ctx.run();
+
+  std::atomic<bool> waiting{false};
+  auto reader = std::async(std::launch::async, [&] {
+    return sync_wait([&]() -> task<bool> {
+      co_await pool.schedule();
+      std::array<std::byte, 4> buffer{};
+      waiting.store(true, std::memory_order_release);
+      (void)co_await right.async_read_some({std::span<std::byte>{buffer}});
+      co_return pool.running_in_this_pool();
+    }());
+  });
+
+  while (!waiting.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  constexpr std::array<std::byte, 4> message{std::byte{'p'}, std::byte{'o'}, std::byte{'n'}, std::byte{'g'}};
+  sync_wait(left.async_write_all({std::span<const std::byte>{message}}));
+
+  EXPECT_FALSE(reader.get());
+  ctx.stop();
+}
+
+TEST(NetTest, GatherWriteAndScatterReadAcrossBufferSequences) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+  io_context ctx;
+  xcoro_socket left(ctx, fds[0]);
+  xcoro_socket right(ctx, fds[1]);
+  ctx.run();
+
+  // 环形缓冲区回绕后可读数据分成两段，应当一次写出而不需要先拼成连续内存
+  byte_buffer body(8);
+  auto head = body.prepare(6);
+  std::memcpy(head.data(), "xxxxbo", 6);
+  body.commit(6);
+  body.consume(4);
+  auto tail = body.prepare_regions(3);
+  ASSERT_EQ(tail[1].size(), 1u);
+  std::memcpy(tail[0].data(), "dy", 2);
+  std::memcpy(tail[1].data(), "!", 1);
+  body.commit(3);
+
+  const std::string header = "head:";
+  const auto body_buffers = body.readable_buffers();
+  const std::array<const_buffer, 3> out = {
+      const_buffer{std::as_bytes(std::span{header})}, body_buffers[0], body_buffers[1]};
+  EXPECT_EQ(sync_wait(left.async_write_all(out)), 10u);
+
+  std::array<char, 4> first{};
+  std::array<char, 16> second{};
+  const std::array<mutable_buffer, 2> in = {
+      mutable_buffer{std::as_writable_bytes(std::span{first})},
+      mutable_buffer{std::as_writable_bytes(std::span{second})}};
+  EXPECT_EQ(sync_wait(right.async_read_some(in)), 10u);
+  EXPECT_EQ(std::string(first.data(), first.size()) + std::string(second.data(), 6),
+            "head:body!");
+
+  ctx.stop();
+}
+
+TEST(NetTest, ByteScanMatchesScalarSearch) {
+  std::vector<std::byte> data(200, std::byte{'a'});
+  for (size_t position : {size_t{0}, size_t{15}, size_t{16}, size_t{31}, size_t{32},
+                          size_t{47}, size_t{130}, size_t{199}}) {
+    std::fill(data.begin(), data.end(), std::byte{'a'});
+    data[position] = std::byte{'\n'};
+    EXPECT_EQ(net::detail::find_byte(data.data(), data.size(), std::byte{'\n'}), position);
+  }
+  std::fill(data.begin(), data.end(), std::byte{'a'});
+  EXPECT_EQ(net::detail::find_byte(data.data(), data.size(), std::byte{'\n'}), net::detail::npos);
+
+  const std::string_view haystack = "ab\r\nc\r\n\r\nrest";
+  EXPECT_EQ(net::detail::find_sequence(std::as_bytes(std::span{haystack}),
+                                  std::as_bytes(std::span{std::string_view{"\r\n\r\n"}})),
+            5u);
+}
+
+TEST(NetTest, ByteScanFindsDelimiterAcrossRingBufferSeam) {
+  const auto bytes = [](std::string_view text) { return std::as_bytes(std::span{text}); };
+  const auto crlfcrlf = bytes("\r\n\r\n");
+  using regions = std::array<std::span<const std::byte>, 2>;
+
+  // 分隔符横跨两段之间的接缝，返回逻辑下标
+  EXPECT_EQ(net::detail::find_sequence(regions{bytes("head\r\n"), bytes("\r\nrest")}, 0,
+                                       crlfcrlf),
+            4u);
+  // 完整落在第二段
+  EXPECT_EQ(net::detail::find_sequence(regions{bytes("head"), bytes("x\r\n\r\n")}, 0, crlfcrlf),
+            5u);
+  // 起点之前的匹配不算
+  EXPECT_EQ(net::detail::find_sequence(regions{bytes("\r\n\r\nab"), bytes("\r\n\r\n")}, 1,
+                                       crlfcrlf),
+            6u);
+  // 第二段太短，接缝处只有部分匹配
+  EXPECT_EQ(net::detail::find_sequence(regions{bytes("ab\r\n\r"), bytes("x")}, 0, crlfcrlf),
+            net::detail::npos);
+  EXPECT_EQ(net::detail::find_sequence(regions{bytes("abc"), bytes("d\n")}, 0, bytes("\n")),
+            4u);
+}
+
+TEST(NetTest, BufferedStreamReadsLinesAcrossPartialWrites) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  scoped_fd writer{fds[1]};
+
+  io_context ctx;
+  buffered_stream<xcoro_socket> reader{xcoro_socket(ctx, fds[0])};
+  ctx.run();
+
+  auto produce = std::async(std::launch::async, [&] {
+    for (std::string_view part : {"GET / HT", "TP/1.1\r\nHost: ex", "ample\r\n", "\r\nbody"}) {
+      EXPECT_EQ(::write(writer.get(), part.data(), part.size()),
+                static_cast<ssize_t>(part.size()));
+      std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    writer.reset();
+  });
+
+  EXPECT_EQ(sync_wait(reader.async_read_line()), std::optional<std::string>{"GET / HTTP/1.1"});
+
+  const size_t header_end = sync_wait(reader.async_read_until("\r\n\r\n"));
+  ASSERT_EQ(header_end, std::string_view{"Host: example\r\n\r\n"}.size());
+  reader.consume(header_end);
+
+  const auto rest = sync_wait(reader.async_peek(4));
+  EXPECT_EQ(std::string(reinterpret_cast<const char*>(rest.data()), rest.size()), "body");
+  produce.get();
+
+  // 对端关闭后没有完整的一行
+  EXPECT_EQ(sync_wait(reader.async_read_line()), std::nullopt);
+  EXPECT_EQ(reader.buffered_size(), 4u);
+
+  ctx.stop();
+}
+
+TEST(NetTest, BufferedStreamReadsLinesFromWrappedBuffer) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  scoped_fd writer{fds[1]};
+
+  // 8 字节的读缓冲区：消费前面的行后新数据写回开头，行和分隔符都会横跨回绕处
+  io_context ctx;
+  buffered_stream<xcoro_socket> reader{xcoro_socket(ctx, fds[0]),
+                                       buffered_stream<xcoro_socket>::kDefaultMaxBufferSize, 8};
+  ctx.run();
+
+  const std::string_view text = "one\ntwo\r\nthree\nab\r\nfour\n";
+  ASSERT_EQ(::write(writer.get(), text.data(), text.size()), static_cast<ssize_t>(text.size()));
+  writer.reset();
+
+  for (std::string_view expected : {"one", "two", "three", "ab", "four"}) {
+    EXPECT_EQ(sync_wait(reader.async_read_line()), std::optional<std::string>{expected});
+  }
+  EXPECT_EQ(sync_wait(reader.async_read_line()), std::nullopt);
+
+  ctx.stop();
+}
+
+TEST(NetTest, BufferedStreamBoundsBufferByDefault) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+  scoped_fd writer{fds[1]};
+
+  io_context ctx;
+  buffered_stream<xcoro_socket> reader{xcoro_socket(ctx, fds[0])};
+  ctx.run();
+
+  // 对端持续发送却一直没有分隔符，默认上限让读取失败而不是无限缓冲
+  std::atomic<bool> stop{false};
+  auto produce = std::async(std::launch::async, [&] {
+    const std::string chunk(4096, 'x');
+    for (size_t sent = 0;
+         !stop.load() && sent <= 2 * buffered_stream<xcoro_socket>::kDefaultMaxBufferSize;) {
+      const ssize_t n = ::write(writer.get(), chunk.data(), chunk.size());
+      if (n < 0) {
+        if (errno == EAGAIN) {
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+          continue;
+        }
+        break;
+      }
+      sent += static_cast<size_t>(n);
+    }
+  });
+
+  EXPECT_THROW(sync_wait(reader.async_read_line()), std::length_error);
+  EXPECT_EQ(reader.buffered_size(), buffered_stream<xcoro_socket>::kDefaultMaxBufferSize);
+  stop = true;
+  produce.get();
+
+  ctx.stop();
+}
+
+TEST(NetTest, WriteQueueCoalescesConcurrentWritersInOrder) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+  io_context ctx;
+  xcoro_socket left(ctx, fds[0]);
+  xcoro_socket right(ctx, fds[1]);
+  write_queue queue{left};
+  ctx.run();
+
+  constexpr int kWriters = 32;
+  std::array<std::array<char, 4>, kWriters> messages{};
+  for (int i = 0; i < kWriters; ++i) {
+    std::snprintf(messages[i].data(), messages[i].size(), "%03d", i);
+    messages[i][3] = ';';
+  }
+
+  auto writer = [&](int i) -> task<> {
+    co_await queue.async_write({std::as_bytes(std::span{messages[i]})});
+  };
+  auto writers = [&]() -> task<> {
+    std::vector<task<>> pending;
+    for (int i = 0; i < kWriters; ++i) {
+      pending.push_back(writer(i));
+    }
+    for (auto& t : pending) {
+      ctx.spawn(std::move(t));
+    }
+    co_return;
+  };
+  sync_wait(writers());
+
+  std::string received(kWriters * 4, '\0');
+  EXPECT_EQ(sync_wait(right.async_read_exact({std::as_writable_bytes(std::span{received})})),
+            received.size());
+
+  // 按入队顺序写出
+  std::string expected;
+  for (const auto& message : messages) {
+    expected.append(message.data(), message.size());
+  }
+  EXPECT_EQ(received, expected);
+
+  ctx.stop();
+}
+
+TEST(NetTest, WriteQueueLeaderStaysOnItsThreadPool) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+  io_context ctx;
+  thread_pool pool(2);
+  xcoro_socket left(ctx, fds[0]);
+  xcoro_socket right(ctx, fds[1]);
+  write_queue queue{left};
+  ctx.run();
+
+  // 发送批次的 leader 不能被迁移到 io_context 线程上
+  constexpr std::array<char, 4> message{'p', 'i', 'n', 'g'};
+  const bool on_pool = sync_wait([&]() -> task<bool> {
+    co_await pool.schedule();
+    co_await queue.async_write({std::as_bytes(std::span{message})});
+    co_return pool.running_in_this_pool();
+  }());
+  EXPECT_TRUE(on_pool);
+
+  std::array<char, 4> received{};
+  EXPECT_EQ(sync_wait(right.async_read_exact({std::as_writable_bytes(std::span{received})})),
+            received.size());
+  EXPECT_EQ(received, message);
+
+  ctx.stop();
+}
+
+TEST(NetTest, SendfileAndSpliceTransferWithoutUserBuffers) {
+  int source_fds[2] = {-1, -1};
+  int sink_fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, source_fds), 0);
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sink_fds), 0);
+
+  std::string content(200000, '\0');
+  for (size_t i = 0; i < content.size(); ++i) {
+    content[i] = static_cast<char>('A' + i % 23);
+  }
+  scoped_fd file{::memfd_create("xcoro-sendfile", MFD_CLOEXEC)};
+  ASSERT_NE(file.get(), -1);
+  ASSERT_EQ(::write(file.get(), content.data(), content.size()),
+            static_cast<ssize_t>(content.size()));
+
+  io_context ctx;
+  xcoro_socket origin(ctx, source_fds[0]);
+  xcoro_socket proxy_in(ctx, source_fds[1]);
+  xcoro_socket proxy_out(ctx, sink_fds[0]);
+  xcoro_socket destination(ctx, sink_fds[1]);
+  ctx.run();
+
+  // 文件 -> origin -> proxy_in ==splice==> proxy_out -> destination
+  constexpr off_t kOffset = 100;
+  const size_t length = content.size() - kOffset;
+  auto send = std::async(std::launch::async, [&] {
+    return sync_wait(origin.async_sendfile(file.get(), kOffset, length + 50));
+  });
+  auto forward = std::async(std::launch::async, [&] {
+    return sync_wait(proxy_in.async_splice(proxy_out, length));
+  });
+
+  std::string received(length, '\0');
+  EXPECT_EQ(sync_wait(destination.async_read_exact({std::as_writable_bytes(std::span{received})})),
+            length);
+  EXPECT_EQ(send.get(), length);
+  EXPECT_EQ(forward.get(), length);
+  EXPECT_EQ(received, content.substr(kOffset));
+
+  ctx.stop();
+}
+
+TEST(NetTest, SpliceMovesBetweenSocketsAndPipes) {
+  int source_fds[2] = {-1, -1};
+  int sink_fds[2] = {-1, -1};
+  int pipe_fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, source_fds), 0);
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sink_fds), 0);
+  ASSERT_EQ(::pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC), 0);
+  scoped_fd pipe_read{pipe_fds[0]};
+  scoped_fd pipe_write{pipe_fds[1]};
+
+  std::string content(300000, '\0');
+  for (size_t i = 0; i < content.size(); ++i) {
+    content[i] = static_cast<char>('a' + i % 19);
+  }
+
+  io_context ctx;
+  xcoro_socket origin(ctx, source_fds[0]);
+  xcoro_socket proxy_in(ctx, source_fds[1]);
+  xcoro_socket proxy_out(ctx, sink_fds[0]);
+  xcoro_socket destination(ctx, sink_fds[1]);
+  ctx.run();
+
+  // origin -> proxy_in ==splice==> 管道 ==splice==> proxy_out -> destination，
+  // 数据量大于管道容量，两端都会遇到 EAGAIN
+  auto send = std::async(std::launch::async, [&] {
+    return sync_wait(origin.async_write_all({std::as_bytes(std::span{content})}));
+  });
+  auto into_pipe = std::async(std::launch::async, [&] {
+    return sync_wait(proxy_in.async_splice(pipe_write.get(), content.size()));
+  });
+  auto out_of_pipe = std::async(std::launch::async, [&] {
+    return sync_wait(proxy_out.async_splice_from(pipe_read.get(), content.size()));
+  });
+
+  std::string received(content.size(), '\0');
+  EXPECT_EQ(sync_wait(destination.async_read_exact({std::as_writable_bytes(std::span{received})})),
+            content.size());
+  EXPECT_EQ(send.get(), content.size());
+  EXPECT_EQ(into_pipe.get(), content.size());
+  EXPECT_EQ(out_of_pipe.get(), content.size());
+  EXPECT_EQ(received, content);
+
+  ctx.stop();
+}
+
+TEST(NetTest, SpliceReportsBytesStrandedByFailedDestination) {
+  int source_fds[2] = {-1, -1};
+  int sink_fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, source_fds), 0);
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, sink_fds), 0);
+  scoped_fd origin{source_fds[0]};
+  scoped_fd destination{sink_fds[1]};
+
+  io_context ctx;
+  xcoro_socket proxy_in(ctx, source_fds[1]);
+  xcoro_socket proxy_out(ctx, sink_fds[0]);
+  ctx.run();
+
+  ASSERT_EQ(::write(origin.get(), "hello", 5), 5);
+  destination.reset();
+
+  // 数据已经从 proxy_in 读进中转管道，写给已关闭的对端失败时报告丢失的字节数
+  try {
+    (void)sync_wait(proxy_in.async_splice(proxy_out, 5));
+    ADD_FAILURE() << "expected splice_error";
+  } catch (const splice_error& e) {
+    EXPECT_EQ(e.code().value(), EPIPE);
+    EXPECT_EQ(e.transferred(), 0u);
+    EXPECT_EQ(e.stranded(), 5u);
+  }
+
+  ctx.stop();
+}
+
+TEST(NetTest, CallWithoutSigpipeRestoresThreadSignalMask) {
+  int pipe_fds[2] = {-1, -1};
+  ASSERT_EQ(::pipe2(pipe_fds, O_CLOEXEC), 0);
+  scoped_fd write_end{pipe_fds[1]};
+  ::close(pipe_fds[0]);
+
+  sigset_t before;
+  ASSERT_EQ(pthread_sigmask(SIG_SETMASK, nullptr, &before), 0);
+  ASSERT_EQ(sigismember(&before, SIGPIPE), 0);
+
+  // 写已关闭的管道：不能终止进程，返回后线程的屏蔽字不变，也没有遗留挂起的 SIGPIPE
+  const ssize_t n = xcoro::net::detail::call_without_sigpipe(
+      [&] { return ::write(write_end.get(), "x", 1); });
+  EXPECT_EQ(n, -1);
+  EXPECT_EQ(errno, EPIPE);
+
+  sigset_t after;
+  ASSERT_EQ(pthread_sigmask(SIG_SETMASK, nullptr, &after), 0);
+  EXPECT_EQ(sigismember(&after, SIGPIPE), 0);
+  sigset_t pending;
+  ASSERT_EQ(::sigpending(&pending), 0);
+  EXPECT_EQ(sigismember(&pending, SIGPIPE), 0);
+}
+
 TEST(NetTest, AsyncWriteAllFallsBackToWriteForPipeFd) {
   int pipe_fds[2] = {-1, -1};
   ASSERT_EQ(::pipe2(pipe_fds, O_NONBLOCK | O_CLOEXEC), 0);
@@ -260,6 +844,143 @@ TEST(NetTest, ByteBufferPrepareKeepsContiguousContract) {
   EXPECT_EQ(collect_bytes(buf), "fghij");
 }
 
+TEST(NetTest, MirroredByteBufferKeepsWrappedDataContiguous) {
+  mirrored_byte_buffer buf(1);
+  const size_t capacity = buf.capacity();
+  ASSERT_GE(capacity, 4u);
+
+  // 留下末尾前 3 个字节中的第一个不消费（全部消费会 clear() 把读位置归零），
+  // 再写入 8 个字节，使可读区域跨越 capacity
+  auto filler = buf.prepare(capacity - 2);
+  const std::byte* base = filler.data();
+  std::memset(filler.data(), 'x', filler.size());
+  buf.commit(filler.size());
+  buf.consume(capacity - 3);
+  ASSERT_EQ(buf.size(), 1u);
+
+  auto writable = buf.prepare(8);
+  ASSERT_EQ(writable.size(), 8u);
+  EXPECT_EQ(writable.data(), base + capacity - 2);
+  std::memcpy(writable.data(), "abcdefgh", 8);
+  buf.commit(8);
+
+  const auto readable = buf.readable();
+  ASSERT_EQ(readable.size(), 9u);
+  EXPECT_EQ(readable.data(), base + capacity - 3);
+  EXPECT_GT(readable.data() + readable.size(), base + capacity);
+  EXPECT_EQ(std::memcmp(readable.data(), "xabcdefgh", 9), 0);
+  EXPECT_TRUE(buf.readable_regions()[1].empty());
+  // 越过 capacity 写入的字节落在了缓冲区开头的同一物理页上
+  EXPECT_EQ(std::memcmp(base, "cdefgh", 6), 0);
+
+  // 扩容后数据保持不变且仍然连续
+  auto grown = buf.prepare(capacity);
+  std::memset(grown.data(), 'z', grown.size());
+  buf.commit(grown.size());
+  EXPECT_GT(buf.capacity(), capacity);
+  EXPECT_EQ(buf.size(), capacity + 9);
+  EXPECT_EQ(std::memcmp(buf.readable().data(), "xabcdefgh", 9), 0);
+  EXPECT_EQ(static_cast<char>(buf.readable().back()), 'z');
+}
+
+TEST(NetTest, MovedFromMirroredByteBufferStaysUsable) {
+  mirrored_byte_buffer source;
+  mirrored_byte_buffer target(std::move(source));
+
+  // 被移走的缓冲区没有映射，查询可写区域得到空区域，之后还能重新分配
+  EXPECT_EQ(source.capacity(), 0u);
+  EXPECT_TRUE(source.writable_regions()[0].empty());
+  EXPECT_TRUE(source.writable_buffers()[0].bytes.empty());
+  source.consume(0);
+
+  auto space = source.prepare(4);
+  ASSERT_EQ(space.size(), 4u);
+  std::memcpy(space.data(), "abcd", 4);
+  source.commit(4);
+  source.consume(2);
+  EXPECT_EQ(std::memcmp(source.readable().data(), "cd", 2), 0);
+}
+
+TEST(NetTest, IobufSliceAndCloneShareBlocks) {
+  std::string payload(40000, '\0');
+  for (size_t i = 0; i < payload.size(); ++i) {
+    payload[i] = static_cast<char>('a' + i % 26);
+  }
+
+  iobuf chain(std::as_bytes(std::span{payload}));
+  ASSERT_EQ(chain.size(), payload.size());
+  EXPECT_GT(chain.segment_count(), 1u);
+
+  // 切片跨越块边界，内容与原数据一致
+  iobuf middle = chain.slice(16000, 1000);
+  std::string sliced(middle.size(), '\0');
+  middle.copy_to(std::as_writable_bytes(std::span{sliced}));
+  EXPECT_EQ(sliced, payload.substr(16000, 1000));
+
+  // 共享块之后追加不能覆盖对方已经可见的数据
+  iobuf copy = chain.clone();
+  copy.append(std::as_bytes(std::span{std::string_view{"tail"}}));
+  EXPECT_EQ(chain.size(), payload.size());
+  EXPECT_EQ(copy.size(), payload.size() + 4);
+
+  iobuf frame = chain.split_front(10);
+  EXPECT_EQ(frame.size(), 10u);
+  EXPECT_EQ(chain.size(), payload.size() - 10);
+
+  const std::string prefix = "len:";
+  frame.prepend(std::as_bytes(std::span{prefix}));
+  std::string framed(frame.size(), '\0');
+  frame.copy_to(std::as_writable_bytes(std::span{framed}));
+  EXPECT_EQ(framed, "len:" + payload.substr(0, 10));
+}
+
+TEST(NetTest, IobufBlocksAreCacheAlignedAndReturnToAllocatingThread) {
+  // 在新线程上分配，缓存一开始是空的；块交给另一个线程释放后应当回到分配线程
+  std::thread owner([] {
+    iobuf chain;
+    auto space = chain.prepare(1);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(space.data()) % 64, 0u);
+    chain.commit(1);
+    const std::byte* first = space.data();
+
+    std::promise<void> released;
+    std::promise<void> done;
+    std::thread other([&, moved = std::move(chain)]() mutable {
+      moved.clear();
+      released.set_value();
+      // 在分配线程再次取块之前保持存活，块不能只是留在这个线程的缓存里
+      done.get_future().wait();
+    });
+    released.get_future().wait();
+
+    iobuf again;
+    EXPECT_EQ(again.prepare(1).data(), first);
+    done.set_value();
+    other.join();
+  });
+  owner.join();
+}
+
+TEST(NetTest, IobufExportsBuffersForGatherWrite) {
+  int fds[2] = {-1, -1};
+  ASSERT_EQ(::socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0, fds), 0);
+
+  io_context ctx;
+  xcoro_socket left(ctx, fds[0]);
+  xcoro_socket right(ctx, fds[1]);
+  ctx.run();
+
+  iobuf message(std::as_bytes(std::span{std::string_view{"world"}}));
+  message.prepend(std::as_bytes(std::span{std::string_view{"hello "}}));
+  EXPECT_EQ(sync_wait(left.async_write_all(message.buffers())), 11u);
+
+  std::array<char, 11> in{};
+  sync_wait(right.async_read_exact({std::as_writable_bytes(std::span{in})}));
+  EXPECT_EQ(std::string(in.data(), in.size()), "hello world");
+
+  ctx.stop();
+}
+
 TEST(NetTest, AcceptorAcceptsIncomingConnection) {
   io_context ctx;
   std::optional<acceptor> listener;
@@ -301,6 +1022,480 @@ TEST(NetTest, AcceptorAcceptsIncomingConnection) {
   ctx.stop();
 }
 
+TEST(NetTest, AcceptorBatchDrainsBacklogUpToLimit) {
+  io_context ctx;
+  std::optional<acceptor> listener;
+  try {
+    listener.emplace(acceptor::listen(ctx, endpoint::ipv4_any(0)));
+  } catch (const std::system_error& e) {
+    if (e.code().value() == EPERM || e.code().value() == EACCES ||
+        e.code().value() == EAFNOSUPPORT) {
+      GTEST_SKIP() << "listening sockets are not permitted in this environment";
+    }
+    throw;
+  }
+
+  ctx.run();
+
+  const endpoint listen_ep = listener->native_socket().local_endpoint();
+  std::vector<xcoro_socket> clients;
+  for (int i = 0; i < 3; ++i) {
+    clients.push_back(xcoro_socket::open_tcp(ctx));
+    sync_wait(clients.back().async_connect(listen_ep));
+  }
+
+  std::array<xcoro_socket, 2> first{};
+  EXPECT_EQ(sync_wait(listener->async_accept_batch(first)), 2u);
+  EXPECT_TRUE(first[0].is_open());
+  EXPECT_TRUE(first[1].is_open());
+
+  std::array<xcoro_socket, 8> rest{};
+  EXPECT_EQ(sync_wait(listener->async_accept_batch(rest)), 1u);
+  EXPECT_TRUE(rest[0].is_open());
+  EXPECT_FALSE(rest[1].is_open());
+
+  ctx.stop();
+}
+
+TEST(NetTest, AcceptorBatchKeepsAcceptedSocketsWhenAdoptFails) {
+  io_context ctx;
+  std::optional<acceptor> listener;
+  try {
+    listener.emplace(acceptor::listen(ctx, endpoint::ipv4_any(0)));
+  } catch (const std::system_error& e) {
+    if (e.code().value() == EPERM || e.code().value() == EACCES ||
+        e.code().value() == EAFNOSUPPORT) {
+      GTEST_SKIP() << "listening sockets are not permitted in this environment";
+    }
+    throw;
+  }
+
+  ctx.run();
+
+  const endpoint listen_ep = listener->native_socket().local_endpoint();
+  std::vector<xcoro_socket> clients;
+  for (int i = 0; i < 3; ++i) {
+    clients.push_back(xcoro_socket::open_tcp(ctx));
+    sync_wait(clients.back().async_connect(listen_ep));
+  }
+
+  // 占住两个最小的空闲 fd 号，让第二个 fd 号的槽位被一个 socket 持有后再把两个号都释放：
+  // 第一个接入的连接拿到 free_fd，第二个拿到 owned_fd，adopt 时抛出 logic_error
+  const int free_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+  const int owned_fd = ::open("/dev/null", O_RDONLY | O_CLOEXEC);
+  ASSERT_GE(free_fd, 0);
+  ASSERT_GT(owned_fd, free_fd);
+  xcoro_socket stale(ctx, owned_fd);
+  ::close(free_fd);
+  ::close(owned_fd);
+
+  std::array<xcoro_socket, 8> out{};
+  EXPECT_EQ(sync_wait(listener->async_accept_batch(out)), 1u);
+  EXPECT_TRUE(out[0].is_open());
+  EXPECT_EQ(out[0].native_handle(), free_fd);
+  EXPECT_FALSE(out[1].is_open());
+
+  // 归还槽位（fd 已经关闭，这里的 close 只会得到 EBADF），剩下的连接照常接入
+  stale.close();
+  std::array<xcoro_socket, 8> rest{};
+  EXPECT_EQ(sync_wait(listener->async_accept_batch(rest)), 1u);
+  EXPECT_TRUE(rest[0].is_open());
+
+  ctx.stop();
+}
+
+TEST(NetTest, ShardedAcceptorSpreadsConnectionsAcrossShards) {
+  io_context first_ctx;
+  io_context second_ctx;
+  std::array<io_context*, 2> contexts{&first_ctx, &second_ctx};
+
+  sharded_acceptor listener;
+  try {
+    listener = sharded_acceptor::listen(contexts, endpoint::ipv4_any(0),
+                                        sharded_listen_options{.steer_by_cpu = true});
+  } catch (const std::system_error& e) {
+    if (e.code().value() == EPERM || e.code().value() == EACCES ||
+        e.code().value() == EAFNOSUPPORT || e.code().value() == ENOPROTOOPT) {
+      GTEST_SKIP() << "reuseport listeners are not permitted in this environment";
+    }
+    throw;
+  }
+
+  ASSERT_EQ(listener.size(), 2u);
+  const endpoint listen_ep = listener.local_endpoint();
+  EXPECT_NE(listen_ep.port(), 0);
+  EXPECT_EQ(listener.shard(1).native_socket().local_endpoint().port(), listen_ep.port());
+
+  first_ctx.run();
+  second_ctx.run();
+
+  constexpr int kClients = 8;
+  std::vector<xcoro_socket> clients;
+  for (int i = 0; i < kClients; ++i) {
+    clients.push_back(xcoro_socket::open_tcp(first_ctx));
+    sync_wait(clients.back().async_connect(listen_ep));
+  }
+
+  // 每个连接只会进入某一个分片的 backlog，各分片取空后总数应等于客户端数
+  int accepted = 0;
+  for (auto& shard : listener) {
+    for (;;) {
+      const int fd = ::accept4(shard.native_socket().native_handle(), nullptr,
+                               nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd == -1) {
+        break;
+      }
+      ::close(fd);
+      ++accepted;
+    }
+  }
+  EXPECT_EQ(accepted, kClients);
+
+  first_ctx.stop();
+  second_ctx.stop();
+}
+
+TEST(NetTest, ZerocopyWriteCompletesAfterKernelReleasesPages) {
+  io_context ctx;
+  std::optional<acceptor> listener;
+  std::optional<xcoro_socket> client;
+  try {
+    listener.emplace(acceptor::listen(ctx, endpoint::from_ip_port("127.0.0.1", 0)));
+    client.emplace(xcoro_socket::open_tcp(ctx));
+  } catch (const std::system_error& e) {
+    if (e.code().value() == EPERM || e.code().value() == EACCES ||
+        e.code().value() == EAFNOSUPPORT) {
+      GTEST_SKIP() << "tcp sockets are not permitted in this environment";
+    }
+    throw;
+  }
+
+  try {
+    client->set_zerocopy();
+  } catch (const std::system_error& e) {
+    GTEST_SKIP() << "SO_ZEROCOPY is not supported: " << e.what();
+  }
+
+  ctx.run();
+
+  const endpoint listen_ep = listener->native_socket().local_endpoint();
+  auto accepted = std::async(std::launch::async, [&] {
+    return sync_wait(listener->async_accept());
+  });
+  sync_wait(client->async_connect(listen_ep));
+  xcoro_socket server = accepted.get();
+
+  std::vector<std::byte> payload(4 * 1024 * 1024);
+  for (size_t i = 0; i < payload.size(); ++i) {
+    payload[i] = static_cast<std::byte>(i * 7);
+  }
+
+  std::vector<std::byte> received(payload.size());
+  auto reader = std::async(std::launch::async, [&] {
+    return sync_wait(server.async_read_exact({std::span<std::byte>{received}}));
+  });
+
+  EXPECT_EQ(sync_wait(client->async_write_all_zerocopy({std::span<const std::byte>{payload}})),
+            payload.size());
+  EXPECT_EQ(reader.get(), payload.size());
+  EXPECT_EQ(received, payload);
+
+  ctx.stop();
+}
+
+TEST(NetTest, UdpBatchSendAndReceive) {
+  io_context ctx;
+  std::optional<xcoro_socket> sender;
+  std::optional<xcoro_socket> receiver;
+  try {
+    sender.emplace(xcoro_socket::open_udp(ctx));
+    receiver.emplace(xcoro_socket::open_udp(ctx));
+    receiver->bind(endpoint::from_ip_port("127.0.0.1", 0));
+    sender->bind(endpoint::from_ip_port("127.0.0.1", 0));
+  } catch (const std::system_error& e) {
+    if (e.code().value() == EPERM || e.code().value() == EACCES ||
+        e.code().value() == EAFNOSUPPORT) {
+      GTEST_SKIP() << "udp sockets are not permitted in this environment";
+    }
+    throw;
+  }
+  ctx.run();
+
+  const endpoint to = receiver->local_endpoint();
+  const endpoint from = sender->local_endpoint();
+
+  constexpr int kMessages = 10;
+  std::array<std::array<char, 8>, kMessages> payloads{};
+  std::vector<outgoing_datagram> outgoing;
+  for (int i = 0; i < kMessages; ++i) {
+    std::snprintf(payloads[i].data(), payloads[i].size(), "dgram%02d", i);
+    outgoing.push_back({const_buffer{std::as_bytes(std::span{payloads[i]}).first(7)}, to});
+  }
+  EXPECT_EQ(sync_wait(sender->async_send_batch(outgoing)), static_cast<size_t>(kMessages));
+
+  std::array<std::array<std::byte, 64>, 16> storage{};
+  std::array<datagram, 16> slots{};
+  for (size_t i = 0; i < slots.size(); ++i) {
+    slots[i].buffer = mutable_buffer{storage[i]};
+  }
+
+  std::vector<std::string> received;
+  while (received.size() < kMessages) {
+    const size_t n = sync_wait(receiver->async_recv_batch(slots));
+    ASSERT_GE(n, 1u);
+    for (size_t i = 0; i < n; ++i) {
+      EXPECT_EQ(slots[i].peer.port(), from.port());
+      EXPECT_FALSE(slots[i].truncated);
+      received.emplace_back(reinterpret_cast<const char*>(storage[i].data()), slots[i].size);
+    }
+  }
+  for (int i = 0; i < kMessages; ++i) {
+    EXPECT_EQ(received[i], std::string(payloads[i].data(), 7));
+  }
+
+  // 单个数据报的收发
+  const std::string_view ping = "ping";
+  EXPECT_EQ(sync_wait(sender->async_send_to({std::as_bytes(std::span{ping})}, to)), 4u);
+  endpoint peer;
+  std::array<std::byte, 16> buffer{};
+  EXPECT_EQ(sync_wait(receiver->async_recv_from({buffer}, peer)), 4u);
+  EXPECT_EQ(peer.port(), from.port());
+
+  ctx.stop();
+}
+
+TEST(NetTest, UdpSegmentationSplitsOneSendIntoDatagrams) {
+  io_context ctx;
+  xcoro_socket sender = xcoro_socket::open_udp(ctx);
+  xcoro_socket receiver = xcoro_socket::open_udp(ctx);
+  receiver.bind(endpoint::from_ip_port("127.0.0.1", 0));
+  ctx.run();
+
+  std::vector<std::byte> payload(300);
+  for (size_t i = 0; i < payload.size(); ++i) {
+    payload[i] = static_cast<std::byte>(i / 100);
+  }
+  const std::array<outgoing_datagram, 1> message = {
+      outgoing_datagram{const_buffer{payload}, receiver.local_endpoint(), 100}};
+  try {
+    sync_wait(sender.async_send_batch(message));
+  } catch (const std::system_error& e) {
+    GTEST_SKIP() << "UDP_SEGMENT is not supported: " << e.what();
+  }
+
+  // 没有开启 GRO 的接收端看到的是三个独立的数据报
+  std::array<std::byte, 512> buffer{};
+  endpoint peer;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_EQ(sync_wait(receiver.async_recv_from({buffer}, peer)), 100u);
+    EXPECT_EQ(buffer[0], static_cast<std::byte>(i));
+  }
+
+  ctx.stop();
+}
+
+TEST(NetTest, UdpBatchRejectsSegmentSizesBeyondGsoLimits) {
+  io_context ctx;
+  xcoro_socket sender = xcoro_socket::open_udp(ctx);
+  xcoro_socket receiver = xcoro_socket::open_udp(ctx);
+  receiver.bind(endpoint::from_ip_port("127.0.0.1", 0));
+  ctx.run();
+
+  const endpoint target = receiver.local_endpoint();
+  std::vector<std::byte> payload(70000);
+  const std::array<outgoing_datagram, 2> oversized = {
+      outgoing_datagram{const_buffer{std::span{payload}.first(10)}, target, 0},
+      outgoing_datagram{const_buffer{payload}, target, 70000}};
+  EXPECT_THROW(sync_wait(sender.async_send_batch(oversized)), std::invalid_argument);
+
+  const std::array<outgoing_datagram, 1> too_many = {outgoing_datagram{
+      const_buffer{std::span{payload}.first(10 * (kMaxGsoSegments + 1))}, target, 10}};
+  EXPECT_THROW(sync_wait(sender.async_send_batch(too_many)), std::invalid_argument);
+
+  // 整批在发送之前就被拒绝，前面合法的消息也没有发出去
+  std::array<std::byte, 16> buffer{};
+  EXPECT_EQ(::recv(receiver.native_handle(), buffer.data(), buffer.size(), MSG_DONTWAIT), -1);
+  EXPECT_EQ(errno, EAGAIN);
+
+  ctx.stop();
+}
+
+TEST(NetTest, UdpBatchReceiveKeepsGroAndOtherControlMessages) {
+  io_context ctx;
+  xcoro_socket sender = xcoro_socket::open_udp(ctx);
+  xcoro_socket receiver = xcoro_socket::open_udp(ctx);
+  receiver.bind(endpoint::from_ip_port("127.0.0.1", 0));
+  try {
+    receiver.set_udp_gro();
+  } catch (const std::system_error& e) {
+    GTEST_SKIP() << "UDP_GRO is not supported: " << e.what();
+  }
+  // GRO 之外再开启包信息和时间戳，每个数据报都会带上多条辅助数据
+  const int on = 1;
+  ASSERT_EQ(::setsockopt(receiver.native_handle(), IPPROTO_IP, IP_PKTINFO, &on, sizeof(on)), 0);
+  ASSERT_EQ(::setsockopt(receiver.native_handle(), SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)),
+            0);
+  ctx.run();
+
+  const std::string_view message = "control";
+  EXPECT_EQ(sync_wait(sender.async_send_to({std::as_bytes(std::span{message})},
+                                           receiver.local_endpoint())),
+            message.size());
+
+  std::array<std::byte, 64> buffer{};
+  std::array<datagram, 1> slots{datagram{.buffer = mutable_buffer{buffer}}};
+  ASSERT_EQ(sync_wait(receiver.async_recv_batch(slots)), 1u);
+  EXPECT_EQ(slots[0].size, message.size());
+  EXPECT_FALSE(slots[0].control_truncated);
+
+  ctx.stop();
+}
+
+TEST(NetTest, UnixEndpointFormatsPathAndAbstractNames) {
+  const endpoint path = endpoint::unix_path("/tmp/xcoro.sock");
+  EXPECT_TRUE(path.is_unix());
+  EXPECT_FALSE(path.is_abstract());
+  EXPECT_EQ(path.path(), "/tmp/xcoro.sock");
+  EXPECT_EQ(path.to_string(), "/tmp/xcoro.sock");
+
+  const endpoint abstract = endpoint::unix_abstract("xcoro");
+  EXPECT_TRUE(abstract.is_abstract());
+  EXPECT_EQ(abstract.path(), "@xcoro");
+
+  EXPECT_THROW(endpoint::unix_path(std::string(200, 'x')), std::invalid_argument);
+  EXPECT_FALSE(endpoint::ipv4_any(0).is_unix());
+}
+
+TEST(NetTest, UnixAcceptorServesAbstractAddress) {
+  io_context ctx;
+  const endpoint ep =
+      endpoint::unix_abstract("xcoro-test-" + std::to_string(::getpid()));
+  acceptor listener = acceptor::listen(ctx, ep);
+  EXPECT_EQ(listener.native_socket().local_endpoint().path(), ep.path());
+  ctx.run();
+
+  xcoro_socket client = xcoro_socket::open_unix(ctx);
+  sync_wait(client.async_connect(ep));
+  xcoro_socket server = sync_wait(listener.async_accept());
+
+  const std::string_view message = "local";
+  sync_wait(client.async_write_all({std::as_bytes(std::span{message})}));
+  std::array<std::byte, 5> buffer{};
+  EXPECT_EQ(sync_wait(server.async_read_exact({buffer})), buffer.size());
+  EXPECT_EQ(std::memcmp(buffer.data(), message.data(), message.size()), 0);
+
+  ctx.stop();
+}
+
+TEST(NetTest, UnixDatagramSocketsExchangeOverPath) {
+  io_context ctx;
+  const std::string path = "/tmp/xcoro-dgram-" + std::to_string(::getpid());
+  ::unlink(path.c_str());
+  xcoro_socket receiver = xcoro_socket::open_unix(ctx, SOCK_DGRAM);
+  receiver.bind(endpoint::unix_path(path));
+  xcoro_socket sender = xcoro_socket::open_unix(ctx, SOCK_DGRAM);
+  ctx.run();
+
+  const std::string_view message = "datagram";
+  EXPECT_EQ(sync_wait(sender.async_send_to({std::as_bytes(std::span{message})},
+                                           endpoint::unix_path(path))),
+            message.size());
+  std::array<std::byte, 32> buffer{};
+  endpoint peer;
+  EXPECT_EQ(sync_wait(receiver.async_recv_from({buffer}, peer)), message.size());
+  // 发送方没有 bind，对端地址是未命名的 AF_UNIX 地址
+  EXPECT_TRUE(peer.is_unix());
+  EXPECT_EQ(peer.path(), "");
+
+  ::unlink(path.c_str());
+  ctx.stop();
+}
+
+TEST(NetTest, SocketPairPassesFileDescriptors) {
+  io_context ctx;
+  auto [left, right] = xcoro_socket::pair(ctx);
+  ctx.run();
+
+  int pipe_fds[2] = {-1, -1};
+  ASSERT_EQ(::pipe(pipe_fds), 0);
+  scoped_fd pipe_read(pipe_fds[0]);
+  scoped_fd pipe_write(pipe_fds[1]);
+
+  const std::string_view tag = "fd";
+  const int passed[1] = {pipe_read.get()};
+  EXPECT_EQ(sync_wait(left.async_send_fds({std::as_bytes(std::span{tag})}, passed)), 2u);
+
+  std::vector<int> received;
+  std::array<std::byte, 8> buffer{};
+  EXPECT_EQ(sync_wait(right.async_recv_fds({buffer}, received)), 2u);
+  ASSERT_EQ(received.size(), 1u);
+  scoped_fd duplicate(received[0]);
+  EXPECT_NE(duplicate.get(), pipe_read.get());
+  EXPECT_NE(::fcntl(duplicate.get(), F_GETFD) & FD_CLOEXEC, 0);
+
+  // 收到的 fd 指向同一个管道
+  ASSERT_EQ(::write(pipe_write.get(), "z", 1), 1);
+  char c = 0;
+  ASSERT_EQ(::read(duplicate.get(), &c, 1), 1);
+  EXPECT_EQ(c, 'z');
+
+  ctx.stop();
+}
+
+TEST(NetTest, AsyncFileReadsAndWritesAtOffsets) {
+  io_context ctx;
+  const std::string path = "/tmp/xcoro-file-" + std::to_string(::getpid());
+  async_file file = async_file::open(ctx, path, O_RDWR | O_CREAT | O_TRUNC);
+  ctx.run();
+
+  const std::string_view head = "hello ";
+  const std::string_view tail = "file";
+  EXPECT_EQ(sync_wait(file.async_write_at(6, {std::as_bytes(std::span{tail})})), 4u);
+  EXPECT_EQ(sync_wait(file.async_write_at(0, {std::as_bytes(std::span{head})})), 6u);
+  sync_wait(file.async_fsync(true));
+  EXPECT_EQ(file.size(), 10u);
+
+  // 读到文件末尾时返回实际读到的字节数
+  std::array<char, 16> buffer{};
+  EXPECT_EQ(sync_wait(file.async_read_at(2, {std::as_writable_bytes(std::span{buffer})})), 8u);
+  EXPECT_EQ(std::string_view(buffer.data(), 8), "llo file");
+
+  ::unlink(path.c_str());
+  ctx.stop();
+}
+
+TEST(NetTest, AsyncFileDirectIoRequiresAlignment) {
+  io_context ctx;
+  const std::string path = "/tmp/xcoro-direct-" + std::to_string(::getpid());
+  std::optional<async_file> file;
+  try {
+    file.emplace(async_file::open(ctx, path, O_RDWR | O_CREAT | O_TRUNC | O_DIRECT));
+  } catch (const std::system_error& e) {
+    ::unlink(path.c_str());
+    if (e.code().value() == EINVAL) {
+      GTEST_SKIP() << "O_DIRECT is not supported by this filesystem";
+    }
+    throw;
+  }
+  EXPECT_TRUE(file->is_direct());
+  ctx.run();
+
+  aligned_buffer block(async_file::direct_alignment());
+  std::memset(block.data(), 'd', block.size());
+  EXPECT_EQ(sync_wait(file->async_write_at(0, {block.bytes()})), block.size());
+
+  aligned_buffer readback(block.size());
+  EXPECT_EQ(sync_wait(file->async_read_at(0, {readback.bytes()})), block.size());
+  EXPECT_EQ(std::memcmp(readback.data(), block.data(), block.size()), 0);
+
+  EXPECT_THROW(sync_wait(file->async_read_at(1, {readback.bytes()})), std::invalid_argument);
+  EXPECT_THROW(sync_wait(file->async_read_at(0, {readback.bytes().subspan(1)})),
+               std::invalid_argument);
+
+  ::unlink(path.c_str());
+  ctx.stop();
+}
+
 TEST(NetTest, ResolverAsyncResolveNumericAddress) {
   io_context ctx;
   ctx.run();
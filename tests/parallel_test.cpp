@@ -0,0 +1,99 @@
+#include "xcoro/parallel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+
+using namespace xcoro;
+
+TEST(ParallelTest, ForVisitsEveryIndexOnce) {
+  thread_pool pool(4);
+  std::vector<std::atomic<int>> hits(10000);
+
+  sync_wait(parallel_for(pool, 0, hits.size(), [&](size_t i) {
+    hits[i].fetch_add(1, std::memory_order_relaxed);
+  }));
+  for (auto& hit : hits) {
+    ASSERT_EQ(hit.load(), 1);
+  }
+
+  // 逐元素版本，粒度为 1 时每个元素都是单独的一块
+  std::vector<int> values(257, 1);
+  sync_wait(parallel_for(pool, values, [](int& value) { value *= 3; }, 1));
+  EXPECT_EQ(std::count(values.begin(), values.end(), 3), 257);
+}
+
+TEST(ParallelTest, ReduceKeepsLeftToRightOrder) {
+  thread_pool pool(4);
+  std::vector<std::string> words;
+  std::string expected = ">";
+  for (int i = 0; i < 300; ++i) {
+    words.push_back(std::to_string(i % 10));
+    expected += words.back();
+  }
+
+  // 字符串拼接满足结合律但不满足交换律，结果能看出合并顺序
+  auto joined = sync_wait(parallel_reduce(pool, words, std::string(">"), std::plus<>{}, 7));
+  EXPECT_EQ(joined, expected);
+
+  std::vector<int64_t> numbers(100000);
+  std::iota(numbers.begin(), numbers.end(), 1);
+  EXPECT_EQ(sync_wait(parallel_reduce(pool, numbers, int64_t{0})), int64_t{100000} * 100001 / 2);
+  EXPECT_EQ(sync_wait(parallel_reduce(pool, std::vector<int>{}, 42)), 42);
+}
+
+TEST(ParallelTest, TransformWritesEveryOutput) {
+  thread_pool pool(4);
+  std::vector<int> input(5000);
+  std::iota(input.begin(), input.end(), 0);
+  std::vector<double> scores(input.size());
+
+  sync_wait(parallel_transform(pool, input, scores.begin(),
+                               [](int x) { return static_cast<double>(x) * 0.5; }));
+  for (size_t i = 0; i < input.size(); ++i) {
+    ASSERT_EQ(scores[i], static_cast<double>(i) * 0.5);
+  }
+}
+
+TEST(ParallelTest, SortMatchesStdSort) {
+  thread_pool pool(4);
+  std::mt19937 rng(12345);
+  std::vector<uint32_t> data(200000);
+  for (auto& value : data) {
+    value = rng() % 1000;
+  }
+  auto expected = data;
+  std::sort(expected.begin(), expected.end(), std::greater<>{});
+
+  sync_wait(parallel_sort(pool, data, std::greater<>{}));
+  EXPECT_EQ(data, expected);
+}
+
+TEST(ParallelTest, ExceptionPropagatesAfterAllChunksFinish) {
+  thread_pool pool(4);
+  std::atomic<int> visited{0};
+
+  auto run = parallel_for(
+      pool, 0, 1000,
+      [&](size_t i) {
+        visited.fetch_add(1, std::memory_order_relaxed);
+        if (i == 500) {
+          throw std::runtime_error("bad item");
+        }
+      },
+      10);
+  EXPECT_THROW(sync_wait(std::move(run)), std::runtime_error);
+  // 出错的那一块停在 500，其余块照常执行完
+  EXPECT_GE(visited.load(), 991);
+}
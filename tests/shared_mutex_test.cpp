@@ -0,0 +1,229 @@
+#include "xcoro/shared_mutex.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "xcoro/cancellation_source.hpp"
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+#include "xcoro/when_all.hpp"
+
+using namespace xcoro;
+
+TEST(SharedMutexTest, ReadersShareAndWriterExcludes) {
+  shared_mutex m;
+  EXPECT_TRUE(m.try_lock_shared());
+  EXPECT_TRUE(m.try_lock_shared());
+  EXPECT_FALSE(m.try_lock());
+  m.unlock_shared();
+  m.unlock_shared();
+
+  EXPECT_TRUE(m.try_lock());
+  EXPECT_FALSE(m.try_lock_shared());
+  EXPECT_FALSE(m.try_lock());
+  m.unlock();
+  EXPECT_TRUE(m.try_lock_shared());
+  m.unlock_shared();
+}
+
+TEST(SharedMutexTest, WaitingWriterBlocksNewReadersAndReadersWakeTogether) {
+  shared_mutex m;
+  ASSERT_TRUE(m.try_lock_shared());
+
+  std::atomic<int> waiting{0};
+  std::vector<int> order;
+  std::atomic<int> active_readers{0};
+  std::atomic<int> max_active_readers{0};
+
+  auto writer = [&]() -> task<> {
+    waiting.fetch_add(1, std::memory_order_release);
+    co_await m.lock();
+    order.push_back(0);
+    m.unlock();
+  };
+  auto reader = [&](int id) -> task<> {
+    waiting.fetch_add(1, std::memory_order_release);
+    co_await m.lock_shared();
+    order.push_back(id);
+    const int active = active_readers.fetch_add(1) + 1;
+    max_active_readers.store(std::max(max_active_readers.load(), active));
+    co_return;
+  };
+
+  auto fut = std::async(std::launch::async, [&] {
+    // 写者排队后，读者即使与现有读者兼容也不能插队
+    sync_wait(when_all(writer(), reader(1), reader(2)));
+  });
+
+  while (waiting.load(std::memory_order_acquire) < 3) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_TRUE(order.empty());
+
+  m.unlock_shared();
+  fut.get();
+
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+  // 写者释放后两个读者在同一批里被唤醒，同时持有共享锁
+  EXPECT_EQ(max_active_readers.load(), 2);
+  m.unlock_shared();
+  m.unlock_shared();
+  EXPECT_TRUE(m.try_lock());
+  m.unlock();
+}
+
+TEST(SharedMutexTest, CancelledWriterLetsQueuedReadersProceed) {
+  shared_mutex m;
+  ASSERT_TRUE(m.try_lock_shared());
+
+  cancellation_source source;
+  std::atomic<int> waiting{0};
+  std::atomic<bool> writer_cancelled{false};
+  std::atomic<bool> reader_acquired{false};
+
+  auto writer = [&]() -> task<> {
+    waiting.fetch_add(1, std::memory_order_release);
+    try {
+      co_await m.lock(source.token());
+    } catch (const operation_cancelled&) {
+      writer_cancelled.store(true, std::memory_order_release);
+    }
+  };
+  auto reader = [&]() -> task<> {
+    waiting.fetch_add(1, std::memory_order_release);
+    co_await m.lock_shared();
+    reader_acquired.store(true, std::memory_order_release);
+    m.unlock_shared();
+  };
+
+  auto fut = std::async(std::launch::async, [&] { sync_wait(when_all(writer(), reader())); });
+
+  while (waiting.load(std::memory_order_acquire) < 2) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_FALSE(reader_acquired.load(std::memory_order_acquire));
+
+  source.request_cancellation();
+  fut.get();
+
+  EXPECT_TRUE(writer_cancelled.load(std::memory_order_acquire));
+  EXPECT_TRUE(reader_acquired.load(std::memory_order_acquire));
+  m.unlock_shared();
+  EXPECT_TRUE(m.try_lock());
+  m.unlock();
+}
+
+TEST(SharedMutexTest, ConcurrentReadersAndWritersKeepInvariant) {
+  shared_mutex m;
+  thread_pool pool{4};
+  constexpr int kIterations = 1000;
+  int value = 0;
+  std::atomic<int> torn_reads{0};
+
+  auto writer = [&]() -> task<> {
+    co_await pool.schedule();
+    for (int i = 0; i < kIterations; ++i) {
+      co_await m.lock();
+      ++value;
+      ++value;
+      m.unlock();
+    }
+  };
+  auto reader = [&]() -> task<> {
+    co_await pool.schedule();
+    for (int i = 0; i < kIterations; ++i) {
+      co_await m.lock_shared();
+      if (value % 2 != 0) {
+        torn_reads.fetch_add(1, std::memory_order_relaxed);
+      }
+      m.unlock_shared();
+    }
+  };
+
+  sync_wait(when_all(writer(), reader(), reader(), writer(), reader(), reader()));
+
+  EXPECT_EQ(value, 4 * kIterations);
+  EXPECT_EQ(torn_reads.load(), 0);
+}
+
+TEST(SharedMutexTest, UnlockResumesWaiterOnItsOwnExecutor) {
+  shared_mutex m;
+  thread_pool pool{1};
+  std::atomic<bool> waiting{false};
+  ASSERT_TRUE(m.try_lock());
+
+  auto reader = [&]() -> task<bool> {
+    co_await pool.schedule();
+    waiting.store(true, std::memory_order_release);
+    co_await m.lock_shared();
+    const bool on_pool = pool.running_in_this_pool();
+    m.unlock_shared();
+    co_return on_pool;
+  };
+  auto fut = std::async(std::launch::async, [&] { return sync_wait(reader()); });
+  while (!waiting.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+  // 释放锁的线程不执行读者的后续代码，而是投递回读者所在的线程池
+  m.unlock();
+  EXPECT_TRUE(fut.get());
+}
+
+TEST(SharedMutexTest, CancellableWaitersRaceWithUnlockWithoutLosingTheLock) {
+  shared_mutex m;
+  thread_pool pool{4};
+  constexpr int kAttempts = 2000;
+  std::vector<cancellation_source> sources(kAttempts);
+  std::atomic<int> next_attempt{0};
+  std::atomic<int> acquired{0};
+  std::atomic<int> cancelled{0};
+  int value = 0;
+
+  auto worker = [&](bool exclusive) -> task<> {
+    co_await pool.schedule();
+    for (;;) {
+      const int attempt = next_attempt.fetch_add(1, std::memory_order_relaxed);
+      if (attempt >= kAttempts) {
+        break;
+      }
+      try {
+        if (exclusive) {
+          co_await m.lock(sources[attempt].token());
+          ++value;
+          m.unlock();
+        } else {
+          co_await m.lock_shared(sources[attempt].token());
+          (void)value;
+          m.unlock_shared();
+        }
+        acquired.fetch_add(1, std::memory_order_relaxed);
+      } catch (const operation_cancelled&) {
+        cancelled.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  };
+  auto canceller = std::async(std::launch::async, [&] {
+    for (int i = 0; i < kAttempts; ++i) {
+      if (i % 3 == 0) {
+        sources[i].request_cancellation();
+      }
+    }
+  });
+
+  sync_wait(when_all(worker(true), worker(false), worker(true), worker(false)));
+  canceller.get();
+  // 每次等待要么拿到锁要么被取消，被取消的等待者不会带走锁
+  EXPECT_EQ(acquired.load() + cancelled.load(), kAttempts);
+  EXPECT_TRUE(m.try_lock());
+  m.unlock();
+}
@@ -0,0 +1,133 @@
+#include "xcoro/spsc_channel.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+#include "xcoro/thread_pool.hpp"
+
+using namespace xcoro;
+
+TEST(SpscChannelTest, CapacityIsRoundedUpAndTryPushStopsWhenFull) {
+  spsc_channel<std::string> ch(3);
+  EXPECT_EQ(ch.capacity(), 4u);
+
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(ch.try_push(std::to_string(i)));
+  }
+  std::string rejected = "x";
+  EXPECT_FALSE(ch.try_push(std::move(rejected)));
+  EXPECT_EQ(rejected, "x");  // 失败时值没有被移走
+
+  EXPECT_EQ(ch.try_pop(), "0");
+  EXPECT_TRUE(ch.try_push(rejected));
+  EXPECT_EQ(rejected, "x");  // 左值按拷贝放入
+  EXPECT_EQ(ch.try_pop(), "1");
+  EXPECT_EQ(ch.try_pop(), "2");
+  EXPECT_EQ(ch.try_pop(), "3");
+  EXPECT_EQ(ch.try_pop(), "x");
+  EXPECT_EQ(ch.try_pop(), std::nullopt);
+}
+
+TEST(SpscChannelTest, BatchPushAndPopWrapAroundTheRing) {
+  spsc_channel<int> ch(8);
+  std::vector<int> in{0, 1, 2, 3, 4, 5};
+  EXPECT_EQ(ch.try_push_many(in), 6u);
+
+  std::vector<int> out;
+  EXPECT_EQ(ch.try_pop_many(out, 4), 4u);
+
+  // 只剩 6 个空位，多出来的留在输入里
+  std::vector<int> more{6, 7, 8, 9, 10, 11, 12};
+  EXPECT_EQ(ch.try_push_many(more), 6u);
+  EXPECT_EQ(more[6], 12);
+
+  EXPECT_EQ(ch.try_pop_many(out, 100), 8u);
+  EXPECT_EQ(out, (std::vector<int>{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}));
+}
+
+TEST(SpscChannelTest, CloseWakesWaitingConsumerAndRejectsSend) {
+  spsc_channel<int> ch(2);
+  std::atomic<bool> started{false};
+
+  auto consumer = [&]() -> task<std::optional<int>> {
+    started.store(true, std::memory_order_release);
+    co_return co_await ch.recv();
+  };
+  auto fut = std::async(std::launch::async, [&] { return sync_wait(consumer()); });
+
+  while (!started.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  ch.close();
+
+  EXPECT_EQ(fut.get(), std::nullopt);
+  EXPECT_THROW(sync_wait(ch.send(1)), channel_closed);
+}
+
+TEST(SpscChannelTest, StreamsBetweenTwoThreadsInOrder) {
+  constexpr int kCount = 200000;
+  spsc_channel<int> ch(64);
+
+  auto producer = [&]() -> task<> {
+    for (int i = 0; i < kCount; ++i) {
+      co_await ch.send(i);
+    }
+    ch.close();
+  };
+  auto consumer = [&]() -> task<long long> {
+    long long sum = 0;
+    int expected = 0;
+    std::vector<int> batch;
+    for (;;) {
+      batch.clear();
+      const size_t n = co_await ch.recv_many(batch, 32);
+      if (n == 0) {
+        break;
+      }
+      for (int value : batch) {
+        EXPECT_EQ(value, expected++);
+        sum += value;
+      }
+    }
+    EXPECT_EQ(expected, kCount);
+    co_return sum;
+  };
+
+  auto fut = std::async(std::launch::async, [&] { sync_wait(producer()); });
+  const long long sum = sync_wait(consumer());
+  fut.get();
+  EXPECT_EQ(sum, static_cast<long long>(kCount) * (kCount - 1) / 2);
+}
+
+TEST(SpscChannelTest, WokenConsumerResumesOnItsOwnExecutor) {
+  thread_pool pool(1);
+  spsc_channel<int> ch(2);
+  std::atomic<bool> started{false};
+
+  auto consumer = [&]() -> task<bool> {
+    co_await pool.schedule();
+    started.store(true, std::memory_order_release);
+    auto value = co_await ch.recv();
+    EXPECT_EQ(value, 7);
+    co_return pool.running_in_this_pool();
+  };
+  auto fut = std::async(std::launch::async, [&] { return sync_wait(consumer()); });
+
+  while (!started.load(std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  // 生产者不在任何调度器上，消费者仍然回到线程池上继续执行
+  EXPECT_TRUE(ch.try_push(7));
+  EXPECT_TRUE(fut.get());
+}
@@ -0,0 +1,65 @@
+#include "xcoro/wait_group.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "xcoro/sync_wait.hpp"
+#include "xcoro/task.hpp"
+
+using namespace xcoro;
+
+TEST(WaitGroupTest, WaitReturnsAfterDynamicallyAddedWorkIsDone) {
+  wait_group wg;
+  std::atomic<int> finished{0};
+  std::vector<std::thread> workers;
+
+  // 任务数在运行时才确定，每启动一个任务 add 一次
+  for (int i = 0; i < 10; ++i) {
+    wg.add();
+    workers.emplace_back([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      finished.fetch_add(1, std::memory_order_relaxed);
+      wg.done();
+    });
+  }
+
+  auto gather = [&]() -> task<int> {
+    co_await wg.wait();
+    co_return finished.load(std::memory_order_relaxed);
+  };
+  EXPECT_EQ(sync_wait(gather()), 10);
+  EXPECT_EQ(wg.count(), 0);
+  for (auto& t : workers) {
+    t.join();
+  }
+}
+
+TEST(WaitGroupTest, CanBeReusedAcrossRoundsWithManyWaiters) {
+  wait_group wg;
+  for (int round = 0; round < 200; ++round) {
+    wg.add(2);
+    std::atomic<int> started{0};
+    std::vector<std::future<void>> waiters;
+    for (int i = 0; i < 3; ++i) {
+      waiters.push_back(std::async(std::launch::async, [&] {
+        started.fetch_add(1, std::memory_order_release);
+        sync_wait(wg.wait());
+      }));
+    }
+    std::thread a([&] { wg.done(); });
+    while (started.load(std::memory_order_acquire) < 3) {
+      std::this_thread::yield();
+    }
+    wg.done();
+    a.join();
+    for (auto& w : waiters) {
+      w.get();
+    }
+    ASSERT_EQ(wg.count(), 0);
+  }
+}